@@ -0,0 +1,127 @@
+/** Brief: Immutable reference-counted byte buffer
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BUFFER__HPP_
+#define BUFFER__HPP_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+// Usage example:
+// '''
+//  (...)
+//
+//  Buffer content(std::move(data));      // Takes over the string, no copy
+//  Buffer copy = content;                // Shares the same bytes
+//  Buffer chunk = content.slice(0, 1024); // View of the first 1024 bytes
+//
+//  write(fd, chunk.data(), chunk.size());
+//
+//  (...)
+// '''
+//
+// Copies and slices of a Buffer are views over the same immutable bytes,
+// which are released once the last view is gone.
+//
+class Buffer
+{
+private:
+  std::shared_ptr<const std::string> _data;
+  size_t _offset;
+  size_t _size;
+
+public:
+  Buffer()
+    : _offset(0), _size(0)
+  { }
+
+  Buffer(std::string data)
+    : _data(std::make_shared<const std::string>(std::move(data))),
+      _offset(0), _size(_data->size())
+  { }
+
+  Buffer(const char* data, const size_t size)
+    : Buffer(std::string(data, size))
+  { }
+
+  // Shares bytes held elsewhere
+  Buffer(std::shared_ptr<const std::string> data)
+    : _data(std::move(data)),
+      _offset(0), _size(_data ? _data->size() : 0)
+  { }
+
+  const char* data() const
+  {
+    return _data ? _data->data() + _offset : "";
+  }
+
+  size_t size() const
+  {
+    return _size;
+  }
+
+  bool empty() const
+  {
+    return _size == 0;
+  }
+
+  const char* begin() const
+  {
+    return data();
+  }
+
+  const char* end() const
+  {
+    return data() + _size;
+  }
+
+  // View of (at most) size bytes starting at offset, sharing the same bytes
+  Buffer slice(size_t offset, size_t size = std::string::npos) const
+  {
+    if(offset > _size) {
+      offset = _size;
+    }
+    if(size > _size - offset) {
+      size = _size - offset;
+    }
+
+    Buffer ret(*this);
+    ret._offset += offset;
+    ret._size = size;
+    return ret;
+  }
+
+  // Bytes shared by this buffer, its copies and its slices (which start
+  // at offset() within them)
+  const std::shared_ptr<const std::string>& storage() const
+  {
+    return _data;
+  }
+
+  size_t offset() const
+  {
+    return _offset;
+  }
+
+  std::string toString() const
+  {
+    return std::string(data(), _size);
+  }
+};
+
+#endif /* BUFFER__HPP_ */
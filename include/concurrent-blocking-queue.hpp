@@ -19,24 +19,115 @@
 #define CONCURRENT_BLOCKING_QUEUE__HPP_
 
 #include <atomic>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <utility>
 
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Default number of elements a queue can hold
+#define DEFAULT_QUEUE_CAPACITY 65536
+
+// Default queue depths at which the queue becomes (and stops being) overloaded
+#define DEFAULT_QUEUE_HIGH_WATERMARK 4096
+#define DEFAULT_QUEUE_LOW_WATERMARK 1024
+
+// Number of attempts before a blocked consumer (or producer) sleeps
+#define QUEUE_SPIN_COUNT 128
+
+#define CACHE_LINE_SIZE 64
+
+// Usage example:
+// '''
+//  (...)
+//
+//  ConcurrentBlockingQueue<int> queue(1024);
+//
+//  // Producer
+//  queue.push(1);             // Blocks while the queue is full
+//  if(!queue.try_push(2)) {   // Fails if the queue is full
+//    (...)
+//  }
+//
+//  // Admission control
+//  queue.setWatermarks(512, 128);
+//  if(queue.isOverloaded()) {   // Until the depth drops to 128 again
+//    (...)
+//  }
+//
+//  // Consumer
+//  try {
+//    int v = queue.pop();     // Blocks while the queue is empty
+//  } catch(...) {
+//    // Queue was stopped
+//  }
+//
+//  (...)
+// '''
+//
+// Bounded lock-free ring buffer with multiple producers and consumers
+// (D. Vyukov's algorithm). Every cell carries a sequence number telling
+// whether it is ready to be written or read in the current lap. Threads
+// that find the queue empty (or full) spin for a while and then sleep on
+// a futex.
+//
 template<typename T>
 class ConcurrentBlockingQueue
 {
 private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  std::unique_ptr<Cell[]> _cells;
+  size_t _mask;
+  char _pad0[CACHE_LINE_SIZE];
+
+  std::atomic<size_t> _enqueue_pos;
+  char _pad1[CACHE_LINE_SIZE];
+
+  std::atomic<size_t> _dequeue_pos;
+  char _pad2[CACHE_LINE_SIZE];
+
+  // Futex words, bumped whenever an element is pushed (or popped), and
+  // the number of threads sleeping on them
+  std::atomic<uint32_t> _pushed;
+  std::atomic<uint32_t> _pop_waiters;
+  std::atomic<uint32_t> _popped;
+  std::atomic<uint32_t> _push_waiters;
+
   std::atomic<bool> _interrupted;
 
-  std::queue<T> _queue;
-  mutable std::mutex _mutex;
-  std::condition_variable _notifier;
+  size_t _high_watermark;
+  size_t _low_watermark;
+  mutable std::atomic<bool> _overloaded;
 
 public:
-  ConcurrentBlockingQueue()
-    : _interrupted(false)
-  { }
+  ConcurrentBlockingQueue(size_t capacity = DEFAULT_QUEUE_CAPACITY)
+    : _enqueue_pos(0), _dequeue_pos(0),
+      _pushed(0), _pop_waiters(0), _popped(0), _push_waiters(0),
+      _interrupted(false),
+      _high_watermark(DEFAULT_QUEUE_HIGH_WATERMARK),
+      _low_watermark(DEFAULT_QUEUE_LOW_WATERMARK),
+      _overloaded(false)
+  {
+    // Capacity is rounded up to a power of two (at least 2)
+    size_t size = 2;
+    while(size < capacity) {
+      size <<= 1;
+    }
+
+    _cells.reset(new Cell[size]);
+    _mask = size - 1;
+    for(size_t i = 0; i < size; ++i) {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
 
   ~ConcurrentBlockingQueue()
   { }
@@ -44,44 +135,223 @@ public:
   void stop()
   {
     _interrupted = true;
-    _notifier.notify_all();
+
+    _pushed.fetch_add(1);
+    _popped.fetch_add(1);
+    wake(_pushed, INT32_MAX);
+    wake(_popped, INT32_MAX);
   }
 
   bool empty() const
   {
-    std::unique_lock<std::mutex> lock(_mutex);
-    return _queue.empty();
+    return size() == 0;
   }
 
   size_t size() const
   {
-    std::unique_lock<std::mutex> lock(_mutex);
-    return _queue.size();
+    size_t dequeue = _dequeue_pos.load(std::memory_order_relaxed);
+    size_t enqueue = _enqueue_pos.load(std::memory_order_relaxed);
+
+    return enqueue > dequeue ? enqueue - dequeue : 0;
   }
 
-  void push(const T& v)
+  size_t capacity() const
   {
-    std::unique_lock<std::mutex> lock(_mutex);
-    _queue.push(v);
+    return _mask + 1;
+  }
 
-    lock.unlock();
-    _notifier.notify_one();
+  void setWatermarks(const size_t high, const size_t low)
+  {
+    _high_watermark = high < capacity() ? high : capacity();
+    _low_watermark = low < _high_watermark ? low : _high_watermark;
+  }
+
+  size_t getHighWatermark() const
+  {
+    return _high_watermark;
+  }
+
+  size_t getLowWatermark() const
+  {
+    return _low_watermark;
   }
 
-  const T& pop()
+  // Becomes true once the depth reaches the high watermark and stays so
+  // until it drops back to the low watermark
+  bool isOverloaded() const
   {
-    std::unique_lock<std::mutex> lock(_mutex);
-    _notifier.wait(lock, [this](){return !_queue.empty() || _interrupted;});
-    if(_interrupted) {
-      throw std::exception();
+    size_t depth = size();
+    if(_overloaded) {
+      if(depth <= _low_watermark) {
+        _overloaded = false;
+      }
+    } else if(depth >= _high_watermark) {
+      _overloaded = true;
     }
 
-    T& v = _queue.front();
-    _queue.pop();
+    return _overloaded;
+  }
 
-    return v;
+  bool try_push(const T& v)
+  {
+    T copy(v);
+    return try_push(std::move(copy));
+  }
+
+  bool try_push(T&& v)
+  {
+    if(!enqueue(v)) {
+      return false;
+    }
+
+    notify(_pushed, _pop_waiters);
+    return true;
+  }
+
+  // Blocks while the queue is full. Returns false if the queue was stopped
+  // before the element could be pushed
+  bool push(const T& v)
+  {
+    T copy(v);
+    return push(std::move(copy));
+  }
+
+  bool push(T&& v)
+  {
+    for(;;) {
+      for(int i = 0; i < QUEUE_SPIN_COUNT; ++i) {
+        if(try_push(std::move(v))) {
+          return true;
+        }
+      }
+
+      uint32_t popped = _popped.load();
+      _push_waiters.fetch_add(1);
+      if(try_push(std::move(v))) {
+        _push_waiters.fetch_sub(1);
+        return true;
+      }
+      if(_interrupted) {
+        _push_waiters.fetch_sub(1);
+        return false;
+      }
+
+      wait(_popped, popped);
+      _push_waiters.fetch_sub(1);
+    }
+  }
+
+  bool try_pop(T& v)
+  {
+    if(!dequeue(v)) {
+      return false;
+    }
+
+    notify(_popped, _push_waiters);
+    return true;
+  }
+
+  // Blocks while the queue is empty. Throws if the queue is stopped
+  T pop()
+  {
+    T v;
+    for(;;) {
+      if(_interrupted) {
+        throw std::exception();
+      }
+
+      for(int i = 0; i < QUEUE_SPIN_COUNT; ++i) {
+        if(try_pop(v)) {
+          return v;
+        }
+      }
+
+      uint32_t pushed = _pushed.load();
+      _pop_waiters.fetch_add(1);
+      if(try_pop(v)) {
+        _pop_waiters.fetch_sub(1);
+        return v;
+      }
+      if(_interrupted) {
+        _pop_waiters.fetch_sub(1);
+        throw std::exception();
+      }
+
+      wait(_pushed, pushed);
+      _pop_waiters.fetch_sub(1);
+    }
+  }
+
+private:
+  bool enqueue(T& v)
+  {
+    Cell* cell;
+    size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+    for(;;) {
+      cell = &_cells[pos & _mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+      if(diff == 0) {
+        if(_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if(diff < 0) {
+        // Queue is full
+        return false;
+      } else {
+        pos = _enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->data = std::move(v);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool dequeue(T& v)
+  {
+    Cell* cell;
+    size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+    for(;;) {
+      cell = &_cells[pos & _mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+      if(diff == 0) {
+        if(_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if(diff < 0) {
+        // Queue is empty
+        return false;
+      } else {
+        pos = _dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+
+    v = std::move(cell->data);
+    cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  static void notify(std::atomic<uint32_t>& word, std::atomic<uint32_t>& waiters)
+  {
+    word.fetch_add(1);
+    if(waiters.load() > 0) {
+      wake(word, 1);
+    }
+  }
+
+  static void wait(std::atomic<uint32_t>& word, const uint32_t value)
+  {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE,
+            value, nullptr, nullptr, 0);
+  }
+
+  static void wake(std::atomic<uint32_t>& word, const int count)
+  {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE,
+            count, nullptr, nullptr, 0);
   }
 };
 
 #endif /* CONCURRENT_BLOCKING_QUEUE__HPP_ */
-
@@ -0,0 +1,206 @@
+/** Brief: Concurrent Hash Map
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONCURRENT_HASH_MAP__HPP_
+#define CONCURRENT_HASH_MAP__HPP_
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+// Hash map split into independently locked shards. The hash of a key is
+// computed once and selects the shard, so threads working on different keys
+// seldom contend on the same lock.
+//
+// Usage example:
+// '''
+//  (...)
+//
+//  ConcurrentHashMap<std::string, int> map;
+//  map.insert("a", 1);
+//
+//  // Modify (or create) an entry while holding its shard lock
+//  map.upsert("a", [](int& value, bool inserted){ ++value; });
+//
+//  // Modify an existing entry and erase it by returning true
+//  map.apply("a", [](int& value){ return value == 2; });
+//
+//  (...)
+// '''
+//
+template<typename K, typename V,
+         typename Hash = std::hash<K>,
+         size_t NumShards = 64>
+class ConcurrentHashMap
+{
+private:
+  struct Shard
+  {
+    mutable std::shared_timed_mutex mutex;
+    std::unordered_map<K, V, Hash> map;
+  };
+
+  Hash _hasher;
+  std::array<Shard, NumShards> _shards;
+
+public:
+  ConcurrentHashMap()
+  { }
+
+  ~ConcurrentHashMap()
+  { }
+
+  ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+  void operator=(const ConcurrentHashMap&) = delete;
+
+  bool find(const K& key, V& value) const
+  {
+    const Shard& shard = getShard(key);
+    std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+    auto it = shard.map.find(key);
+    if(it == shard.map.end()) {
+      return false;
+    }
+
+    value = it->second;
+    return true;
+  }
+
+  bool contains(const K& key) const
+  {
+    const Shard& shard = getShard(key);
+    std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+    return shard.map.find(key) != shard.map.end();
+  }
+
+  // Insert a new entry (existing entries are not overwritten)
+  bool insert(const K& key, const V& value)
+  {
+    Shard& shard = getShard(key);
+    std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+    return shard.map.emplace(key, value).second;
+  }
+
+  bool erase(const K& key)
+  {
+    Shard& shard = getShard(key);
+    std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+    return shard.map.erase(key) != 0;
+  }
+
+  // Call f(const V&) on an existing entry while holding a shared lock
+  template<typename F>
+  bool visit(const K& key, F&& f) const
+  {
+    const Shard& shard = getShard(key);
+    std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+    auto it = shard.map.find(key);
+    if(it == shard.map.end()) {
+      return false;
+    }
+
+    f(it->second);
+    return true;
+  }
+
+  // Call f(V&, bool inserted) on the entry, creating it if it does not exist
+  template<typename F>
+  void upsert(const K& key, F&& f)
+  {
+    Shard& shard = getShard(key);
+    std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+    auto ret = shard.map.emplace(std::piecewise_construct,
+                                 std::forward_as_tuple(key),
+                                 std::forward_as_tuple());
+    f(ret.first->second, ret.second);
+  }
+
+  // Call f(V&) on an existing entry; the entry is erased if f returns true
+  template<typename F>
+  bool apply(const K& key, F&& f)
+  {
+    Shard& shard = getShard(key);
+    std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+    auto it = shard.map.find(key);
+    if(it == shard.map.end()) {
+      return false;
+    }
+
+    if(f(it->second)) {
+      shard.map.erase(it);
+    }
+    return true;
+  }
+
+  // Call f(const K&, V&) on every entry, one shard at a time; entries are
+  // erased if f returns true
+  template<typename F>
+  void applyAll(F&& f)
+  {
+    for(Shard& shard : _shards) {
+      std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+      for(auto it = shard.map.begin(); it != shard.map.end(); ) {
+        if(f(it->first, it->second)) {
+          it = shard.map.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+  }
+
+  size_t size() const
+  {
+    size_t ret = 0;
+    for(const Shard& shard : _shards) {
+      std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+      ret += shard.map.size();
+    }
+
+    return ret;
+  }
+
+private:
+  size_t getShardIndex(const K& key) const
+  {
+    // Mix the high bits in, as the low bits also select the bucket
+    // inside the shard
+    size_t hash = _hasher(key);
+    return (hash ^ (hash >> 17) ^ (hash >> 31)) % NumShards;
+  }
+
+  Shard& getShard(const K& key)
+  {
+    return _shards[getShardIndex(key)];
+  }
+
+  const Shard& getShard(const K& key) const
+  {
+    return _shards[getShardIndex(key)];
+  }
+};
+
+#endif /* CONCURRENT_HASH_MAP__HPP_ */
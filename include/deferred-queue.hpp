@@ -0,0 +1,123 @@
+/** Brief: Queue of requests held back while the Core is overloaded
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DEFERRED_QUEUE__HPP_
+#define DEFERRED_QUEUE__HPP_
+
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <utility>
+
+enum Admission {
+  ADMISSION_ADMITTED = 0,
+  ADMISSION_DEFERRED = 1,
+  ADMISSION_DROPPED  = 2
+};
+
+// Usage example:
+// '''
+//  (...)
+//
+//  DeferredQueue<MetaMessagePtr> deferred(4096, std::chrono::seconds(30));
+//  auto admit = [this](MetaMessagePtr& msg) {
+//    return !isOverloaded() && tryReceivedMessage(msg);   // Keeps msg on failure
+//  };
+//
+//  // On each new request
+//  if(deferred.admit(std::move(msg), admit) == ADMISSION_DROPPED) {
+//    (...)
+//  }
+//
+//  // Periodically, and whenever there is a chance the load went down
+//  deferred.flush(admit, [](MetaMessagePtr& msg) { (...) });   // Expired
+//
+//  (...)
+// '''
+//
+// Values are admitted in their arrival order: a new value is only admitted
+// straight away when no other is deferred. Deferred values are kept for a
+// limited time and no more than the given number of them is kept, so that
+// an overload that lasts does not exhaust the memory.
+//
+template<typename T>
+class DeferredQueue
+{
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Entry
+  {
+    T value;
+    Clock::time_point deadline;
+  };
+
+  const size_t _max_size;
+  const Clock::duration _timeout;
+
+  std::list<Entry> _entries;
+  mutable std::mutex _mutex;
+
+public:
+  DeferredQueue(const size_t maxSize, const Clock::duration timeout)
+    : _max_size(maxSize), _timeout(timeout)
+  { }
+
+  // The admit function returns false, leaving the value untouched, if the
+  // value cannot be admitted yet
+  template<typename Admit>
+  Admission admit(T value, Admit&& admit, const Clock::time_point now = Clock::now())
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_entries.empty() && admit(value)) {
+      return ADMISSION_ADMITTED;
+    }
+
+    if(_entries.size() >= _max_size) {
+      return ADMISSION_DROPPED;
+    }
+
+    _entries.push_back({std::move(value), now + _timeout});
+    return ADMISSION_DEFERRED;
+  }
+
+  // Admits the deferred values in order, until one cannot be admitted.
+  // Values past their deadline are handed to the expired function instead
+  template<typename Admit, typename Expired>
+  void flush(Admit&& admit, Expired&& expired, const Clock::time_point now = Clock::now())
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    while(!_entries.empty()) {
+      Entry& front = _entries.front();
+      if(front.deadline <= now) {
+        expired(front.value);
+      } else if(!admit(front.value)) {
+        break;
+      }
+
+      _entries.pop_front();
+    }
+  }
+
+  size_t size() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+  }
+};
+
+#endif /* DEFERRED_QUEUE__HPP_ */
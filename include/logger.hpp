@@ -18,9 +18,17 @@
 #ifndef LOGGER__HPP_
 #define LOGGER__HPP_
 
-#include <mutex>
-#include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 enum Level {
   LOG_LEVEL_FATAL = 0,
@@ -32,11 +40,115 @@ enum Level {
   LOG_LEVEL_ALL   = 255
 };
 
+// Least severe level compiled in. Messages of less severe levels (and the
+// building of their text) are removed at compile time, e.g., by building
+// with -DFIFU_LOG_MIN_LEVEL=LOG_LEVEL_WARN
+#ifndef FIFU_LOG_MIN_LEVEL
+#define FIFU_LOG_MIN_LEVEL LOG_LEVEL_ALL
+#endif
+
+// Number of messages each thread can have waiting to be written
+// (must be a power of two)
+#define LOGGER_RING_SIZE 4096
+
+// Time (in milliseconds) between two writes of the pending messages
+#define LOGGER_FLUSH_INTERVAL 50
+
+// Messages are written by a background thread. Each logging thread puts
+// its messages in a ring of its own (single producer, single consumer),
+// so logging takes no lock and makes no system call. The writer thread
+// drains all rings at once, sorts the messages by time and writes them in
+// a single batch. Fatal messages are written before log() returns.
 class Logger
 {
 private:
-  Level _level = LOG_LEVEL_INFO; // Default level: INFO
+  struct Entry
+  {
+    int64_t time;
+    const char* level;
+    std::string msg;
+  };
+
+  class Ring
+  {
+  private:
+    std::unique_ptr<Entry[]> _entries;
+    alignas(64) std::atomic<size_t> _head;
+    alignas(64) std::atomic<size_t> _tail;
+    std::atomic<bool> _closed;
+
+  public:
+    Ring()
+      : _entries(new Entry[LOGGER_RING_SIZE]), _head(0), _tail(0), _closed(false)
+    { }
+
+    // Called by the owner thread only
+    bool push(Entry& entry)
+    {
+      size_t tail = _tail.load(std::memory_order_relaxed);
+      if(tail - _head.load(std::memory_order_acquire) == LOGGER_RING_SIZE) {
+        return false;
+      }
+
+      _entries[tail & (LOGGER_RING_SIZE - 1)] = std::move(entry);
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    size_t size() const
+    {
+      return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+
+    // Called by the writer only
+    void drain(std::vector<Entry>& out)
+    {
+      size_t head = _head.load(std::memory_order_relaxed);
+      size_t tail = _tail.load(std::memory_order_acquire);
+      for(; head != tail; ++head) {
+        out.push_back(std::move(_entries[head & (LOGGER_RING_SIZE - 1)]));
+      }
+      _head.store(head, std::memory_order_release);
+    }
+
+    // The owner thread is gone
+    void close()
+    {
+      _closed = true;
+    }
+
+    bool isClosed() const
+    {
+      return _closed;
+    }
+  };
+
+  // Ring of the calling thread, closed when the thread exits
+  struct LocalRing
+  {
+    std::shared_ptr<Ring> ring;
+
+    ~LocalRing()
+    {
+      if(ring) {
+        ring->close();
+      }
+    }
+  };
+
+  std::atomic<Level> _level;
+
+  // Rings of all threads, and the buffers of the writer
   std::mutex _mutex;
+  std::vector<std::shared_ptr<Ring>> _rings;
+  std::vector<Entry> _batch;
+  std::string _out;
+
+  std::atomic<bool> _isRunning;
+  std::atomic<bool> _pending;
+  std::mutex _wait_mutex;
+  std::condition_variable _wait_cond;
+  std::thread _writer;
 
 public:
   static Logger& getInstance()
@@ -45,9 +157,21 @@ public:
     return instance;
   }
 
+  ~Logger()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_wait_mutex);
+      _isRunning = false;
+    }
+    _wait_cond.notify_one();
+
+    _writer.join();
+    flush();
+  }
+
   Level getLevel() const
   {
-    return _level;
+    return _level.load(std::memory_order_relaxed);
   }
 
   void setLevel(const Level level)
@@ -55,26 +179,107 @@ public:
     _level = level;
   }
 
-  void log(const std::string level, const std::string msg)
+  void log(const char* level, std::string msg)
   {
-    std::lock_guard<std::mutex> lock(_mutex);
-
     using namespace std::chrono;
     microseconds ms = duration_cast<microseconds>(system_clock::now().time_since_epoch());
 
-    std::clog << ms.count() << " [" << level << "] " << msg << std::endl << std::flush;
+    Entry entry = {ms.count(), level, std::move(msg)};
+
+    Ring& ring = localRing();
+    while(!ring.push(entry)) {
+      // Ring is full: wait for the writer to make room
+      wakeWriter();
+      std::this_thread::yield();
+    }
+
+    if(ring.size() > LOGGER_RING_SIZE / 2) {
+      wakeWriter();
+    }
+  }
+
+  // Writes all pending messages
+  void flush()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for(auto it = _rings.begin(); it != _rings.end();) {
+      // Closed rings get no more messages, so they are done once drained
+      bool closed = (*it)->isClosed();
+      (*it)->drain(_batch);
+      it = closed ? _rings.erase(it) : it + 1;
+    }
+
+    if(_batch.empty()) {
+      return;
+    }
+
+    std::stable_sort(_batch.begin(), _batch.end(),
+                     [](const Entry& a, const Entry& b) { return a.time < b.time; });
+
+    for(auto& entry : _batch) {
+      _out.append(std::to_string(entry.time)).append(" [").append(entry.level).append("] ")
+          .append(entry.msg).append("\n");
+    }
+
+    std::clog.write(_out.data(), _out.size());
+    std::clog.flush();
+
+    _batch.clear();
+    _out.clear();
   }
 
   Logger(Logger const&) = delete;
   void operator=(Logger const&) = delete;
 
 private:
-  Logger() {};
+  Logger()
+    : _level(LOG_LEVEL_INFO), // Default level: INFO
+      _isRunning(true), _pending(false)
+  {
+    _writer = std::thread(&Logger::run, this);
+  }
+
+  Ring& localRing()
+  {
+    static thread_local LocalRing local;
+    if(!local.ring) {
+      local.ring = std::make_shared<Ring>();
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      _rings.push_back(local.ring);
+    }
+
+    return *local.ring;
+  }
+
+  void wakeWriter()
+  {
+    _pending = true;
+    _wait_cond.notify_one();
+  }
+
+  void run()
+  {
+    while(_isRunning) {
+      {
+        std::unique_lock<std::mutex> lock(_wait_mutex);
+        _wait_cond.wait_for(lock, std::chrono::milliseconds(LOGGER_FLUSH_INTERVAL),
+                            [this]() { return _pending.load() || !_isRunning; });
+        _pending = false;
+      }
+
+      flush();
+    }
+  }
 };
 
-#define FIFU_LOG(level, type, msg)                 \
-  if(Logger::getInstance().getLevel() >= level) {  \
-    Logger::getInstance().log(#type, msg);         \
+#define FIFU_LOG(level, type, msg)                                                \
+  if(level <= FIFU_LOG_MIN_LEVEL && Logger::getInstance().getLevel() >= level) {  \
+    Logger::getInstance().log(#type, msg);                                        \
+    if(level == LOG_LEVEL_FATAL) {                                                \
+      Logger::getInstance().flush();                                              \
+    }                                                                             \
   }
 
 #define FIFU_LOG_FATAL(msg) FIFU_LOG(LOG_LEVEL_FATAL, FATAL, msg)
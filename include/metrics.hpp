@@ -0,0 +1,108 @@
+/** Brief: Metrics
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef METRICS__HPP_
+#define METRICS__HPP_
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+// Registry of named counters and gauges.
+//
+// Counters are plain atomics: look them up once and keep the reference, as
+// the lookup itself takes a lock. Gauges are sampled only when exported.
+//
+// Usage example:
+// '''
+//  (...)
+//
+//  std::atomic<uint64_t>& hits = Metrics::getInstance().getCounter("cache.hits");
+//  ++hits;
+//
+//  Metrics::getInstance().setGauge("queue.depth", [&queue](){ return queue.size(); });
+//
+//  (...)
+// '''
+//
+class Metrics
+{
+private:
+  std::mutex _mutex;
+  std::map<std::string, std::unique_ptr<std::atomic<uint64_t>>> _counters;
+  std::map<std::string, std::function<double()>> _gauges;
+
+public:
+  static Metrics& getInstance()
+  {
+    static Metrics instance;
+    return instance;
+  }
+
+  std::atomic<uint64_t>& getCounter(const std::string name)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto it = _counters.find(name);
+    if(it == _counters.end()) {
+      it = _counters.emplace(name, std::unique_ptr<std::atomic<uint64_t>>(
+                                     new std::atomic<uint64_t>(0))).first;
+    }
+
+    return *(it->second);
+  }
+
+  void setGauge(const std::string name, std::function<double()> gauge)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _gauges[name] = gauge;
+  }
+
+  void removeGauge(const std::string name)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _gauges.erase(name);
+  }
+
+  std::string toString()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::ostringstream ret;
+    for(auto& item : _counters) {
+      ret << item.first << "=" << item.second->load() << " ";
+    }
+
+    for(auto& item : _gauges) {
+      ret << item.first << "=" << item.second() << " ";
+    }
+
+    return ret.str();
+  }
+
+  Metrics(Metrics const&) = delete;
+  void operator=(Metrics const&) = delete;
+
+private:
+  Metrics() {};
+};
+
+#endif /* METRICS__HPP_ */
@@ -0,0 +1,176 @@
+/** Brief: Object pool with per-thread caches
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBJECT_POOL__HPP_
+#define OBJECT_POOL__HPP_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Number of free objects each thread keeps for itself
+#define OBJECT_POOL_LOCAL_CAPACITY 64
+
+// Number of free objects kept in the pool shared by all threads
+#define OBJECT_POOL_GLOBAL_CAPACITY 4096
+
+// Usage example:
+// '''
+//  (...)
+//
+//  ObjectPool<Foo>::Ptr foo = ObjectPool<Foo>::acquire();
+//  foo->bar();
+//
+//  // Handles are moved around as any std::unique_ptr and give their
+//  // object back to the pool once destroyed
+//  queue.push(std::move(foo));
+//
+//  (...)
+// '''
+//
+// Objects are taken from (and given back to) a cache owned by the calling
+// thread, so most acquisitions take no lock and allocate nothing. Caches
+// exchange batches of objects with a pool shared by all threads when they
+// become empty (or full), since objects are often released by a thread
+// other than the one that acquired them. Released objects are reset to a
+// default-constructed state.
+//
+template<typename T>
+class ObjectPool
+{
+public:
+  struct Deleter
+  {
+    void operator()(T* object) const
+    {
+      ObjectPool<T>::release(object);
+    }
+  };
+
+  typedef std::unique_ptr<T, Deleter> Ptr;
+
+private:
+  class Depot
+  {
+  private:
+    std::mutex _mutex;
+    std::vector<T*> _objects;
+
+  public:
+    ~Depot()
+    {
+      for(auto object : _objects) {
+        delete object;
+      }
+    }
+
+    void take(std::vector<T*>& objects, const size_t count)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      while(!_objects.empty() && objects.size() < count) {
+        objects.push_back(_objects.back());
+        _objects.pop_back();
+      }
+    }
+
+    void give(std::vector<T*>& objects, const size_t count)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      for(size_t i = 0; i < count && !objects.empty(); ++i) {
+        if(_objects.size() < OBJECT_POOL_GLOBAL_CAPACITY) {
+          _objects.push_back(objects.back());
+        } else {
+          delete objects.back();
+        }
+        objects.pop_back();
+      }
+    }
+  };
+
+  class Cache
+  {
+  private:
+    Depot& _depot;
+    std::vector<T*> _objects;
+
+  public:
+    Cache()
+      : _depot(depot())
+    {
+      _objects.reserve(OBJECT_POOL_LOCAL_CAPACITY);
+    }
+
+    ~Cache()
+    {
+      _depot.give(_objects, _objects.size());
+    }
+
+    T* acquire()
+    {
+      if(_objects.empty()) {
+        _depot.take(_objects, OBJECT_POOL_LOCAL_CAPACITY / 2);
+      }
+
+      if(_objects.empty()) {
+        return new T();
+      }
+
+      T* object = _objects.back();
+      _objects.pop_back();
+      return object;
+    }
+
+    void release(T* object)
+    {
+      if(_objects.size() == OBJECT_POOL_LOCAL_CAPACITY) {
+        _depot.give(_objects, OBJECT_POOL_LOCAL_CAPACITY / 2);
+      }
+
+      _objects.push_back(object);
+    }
+  };
+
+  static Depot& depot()
+  {
+    static Depot depot;
+    return depot;
+  }
+
+  static Cache& cache()
+  {
+    static thread_local Cache cache;
+    return cache;
+  }
+
+public:
+  static Ptr acquire()
+  {
+    return Ptr(cache().acquire());
+  }
+
+  static void release(T* object)
+  {
+    if(object == nullptr) {
+      return;
+    }
+
+    *object = T();
+    cache().release(object);
+  }
+};
+
+#endif /* OBJECT_POOL__HPP_ */
@@ -0,0 +1,216 @@
+/** Brief: Move-only callable with inline storage
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TASK__HPP_
+#define TASK__HPP_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Size (in bytes) of the storage for callables kept inside the Task.
+// Bigger callables are still accepted, but are allocated in the heap
+#define TASK_INLINE_SIZE 48
+
+// Usage example:
+// '''
+//  (...)
+//
+//  Task t([this, msg](){ processMessage(msg); });
+//  Task u(std::move(t));
+//
+//  if(u) {
+//    u();
+//  }
+//
+//  (...)
+// '''
+//
+class Task
+{
+private:
+  struct Operations
+  {
+    void (*invoke)(void* storage);
+    void (*move)(void* dst, void* src);
+    void (*destroy)(void* storage);
+  };
+
+  template<typename F>
+  struct Inline
+  {
+    static void invoke(void* storage)
+    {
+      (*static_cast<F*>(storage))();
+    }
+
+    static void move(void* dst, void* src)
+    {
+      new (dst) F(std::move(*static_cast<F*>(src)));
+      static_cast<F*>(src)->~F();
+    }
+
+    static void destroy(void* storage)
+    {
+      static_cast<F*>(storage)->~F();
+    }
+
+    static const Operations* operations()
+    {
+      static const Operations ops = { &invoke, &move, &destroy };
+      return &ops;
+    }
+  };
+
+  template<typename F>
+  struct Heap
+  {
+    static void invoke(void* storage)
+    {
+      (**static_cast<F**>(storage))();
+    }
+
+    static void move(void* dst, void* src)
+    {
+      *static_cast<F**>(dst) = *static_cast<F**>(src);
+    }
+
+    static void destroy(void* storage)
+    {
+      delete *static_cast<F**>(storage);
+    }
+
+    static const Operations* operations()
+    {
+      static const Operations ops = { &invoke, &move, &destroy };
+      return &ops;
+    }
+  };
+
+  typename std::aligned_storage<TASK_INLINE_SIZE, alignof(std::max_align_t)>::type _storage;
+  const Operations* _ops;
+
+public:
+  Task()
+    : _ops(nullptr)
+  { }
+
+  Task(std::nullptr_t)
+    : _ops(nullptr)
+  { }
+
+  template<typename F,
+           typename = typename std::enable_if<
+             !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+  Task(F&& function)
+    : _ops(nullptr)
+  {
+    assign(std::forward<F>(function));
+  }
+
+  Task(Task&& other)
+    : _ops(other._ops)
+  {
+    if(_ops) {
+      _ops->move(&_storage, &other._storage);
+      other._ops = nullptr;
+    }
+  }
+
+  Task& operator=(Task&& other)
+  {
+    if(this != &other) {
+      reset();
+
+      _ops = other._ops;
+      if(_ops) {
+        _ops->move(&_storage, &other._storage);
+        other._ops = nullptr;
+      }
+    }
+
+    return *this;
+  }
+
+  Task& operator=(std::nullptr_t)
+  {
+    reset();
+    return *this;
+  }
+
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+  ~Task()
+  {
+    reset();
+  }
+
+  explicit operator bool() const
+  {
+    return _ops != nullptr;
+  }
+
+  void operator()()
+  {
+    _ops->invoke(&_storage);
+  }
+
+private:
+  // Only the branch for the given callable is compiled, as the other one
+  // may not fit it
+  template<typename F>
+  void assign(F&& function)
+  {
+    typedef typename std::decay<F>::type Function;
+
+    assign(std::forward<F>(function),
+           std::integral_constant<bool,
+                                  sizeof(Function) <= sizeof(_storage)
+                                  && alignof(Function) <= alignof(std::max_align_t)
+                                  && std::is_nothrow_move_constructible<Function>::value>());
+  }
+
+  template<typename F>
+  void assign(F&& function, std::true_type)
+  {
+    typedef typename std::decay<F>::type Function;
+
+    new (&_storage) Function(std::forward<F>(function));
+    _ops = Inline<Function>::operations();
+  }
+
+  template<typename F>
+  void assign(F&& function, std::false_type)
+  {
+    typedef typename std::decay<F>::type Function;
+
+    *reinterpret_cast<Function**>(&_storage) = new Function(std::forward<F>(function));
+    _ops = Heap<Function>::operations();
+  }
+
+  void reset()
+  {
+    if(_ops) {
+      _ops->destroy(&_storage);
+      _ops = nullptr;
+    }
+  }
+};
+
+#endif /* TASK__HPP_ */
@@ -18,11 +18,23 @@
 #ifndef THREAD_POOL__HPP_
 #define THREAD_POOL__HPP_
 
-#include "concurrent-blocking-queue.hpp"
+#include "task.hpp"
 
 #include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <utility>
+#include <vector>
+
+// Initial number of job slots of each worker (must be a power of two)
+#define THREAD_POOL_INITIAL_SLOTS 64
+
+// Jobs a worker runs before it looks at the oldest job scheduled from
+// outside the pool, even if it has more jobs of its own
+#define THREAD_POOL_FAIRNESS_INTERVAL 32
 
 // Usage example:
 // '''
@@ -34,68 +46,239 @@
 //  std::function<void()> a(std::bind(&function, object, args));
 //  tp.schedule(std::move(a));
 //
-//  // or using lambda functions
+//  // or using lambda functions (preferred, since small lambdas are stored
+//  // without any heap allocation)
 //  tp.schedule([](){std::cout << "Executing job" << std::endl << std::flush;});
 //
 //  (...)
 // '''
 //
+// Each worker owns two rings of jobs. Jobs scheduled from a worker go to
+// its local ring and are taken from the back (LIFO), as they are likely to
+// use what the worker just touched. Jobs scheduled from other threads
+// (e.g., the Core or the plugins) are spread among the injected rings of
+// the workers in round-robin and taken from the front (FIFO), so they run
+// in the order they arrived and none is left behind under sustained load.
+// Idle workers steal the oldest jobs of the others.
+//
 class ThreadPool
 {
 private:
+  // Growable ring of jobs. Its slots are reused, so no memory is allocated
+  // once it has grown to the usual load
+  class JobRing
+  {
+  private:
+    std::vector<Task> _slots;
+    size_t _head;
+    size_t _count;
+
+  public:
+    JobRing()
+      : _slots(THREAD_POOL_INITIAL_SLOTS), _head(0), _count(0)
+    { }
+
+    bool empty() const
+    {
+      return _count == 0;
+    }
+
+    void push_back(Task&& job)
+    {
+      if(_count == _slots.size()) {
+        grow();
+      }
+
+      _slots[(_head + _count) & (_slots.size() - 1)] = std::move(job);
+      ++_count;
+    }
+
+    Task pop_back()
+    {
+      --_count;
+      return std::move(_slots[(_head + _count) & (_slots.size() - 1)]);
+    }
+
+    Task pop_front()
+    {
+      Task job(std::move(_slots[_head]));
+      _head = (_head + 1) & (_slots.size() - 1);
+      --_count;
+      return job;
+    }
+
+  private:
+    void grow()
+    {
+      std::vector<Task> slots(_slots.size() * 2);
+      for(size_t i = 0; i < _count; ++i) {
+        slots[i] = std::move(_slots[(_head + i) & (_slots.size() - 1)]);
+      }
+
+      _slots.swap(slots);
+      _head = 0;
+    }
+  };
+
+  struct Worker
+  {
+    std::mutex mutex;
+    JobRing local;
+    JobRing injected;
+  };
+
   std::atomic<bool> _isRunning;
   std::vector<std::thread> _workers;
-  ConcurrentBlockingQueue<std::function<void()>*> _job_queue;
+  std::vector<std::unique_ptr<Worker>> _queues;
+
+  // Round-robin index for jobs scheduled outside of the workers
+  std::atomic<size_t> _next;
+
+  // Number of scheduled jobs not yet taken by a worker
+  std::atomic<size_t> _pending;
+
+  // Idle workers sleep here until new jobs are scheduled
+  std::mutex _sleep_mutex;
+  std::condition_variable _sleep_cond;
+  std::atomic<size_t> _sleeping;
 
 public:
   ThreadPool(int numWorkers = 0)
-    : _isRunning(true)
+    : _isRunning(true), _next(0), _pending(0), _sleeping(0)
   {
     if(numWorkers < 1) {
       numWorkers = std::thread::hardware_concurrency();
     }
+    if(numWorkers < 1) {
+      numWorkers = 1;
+    }
 
     for(int i = 0; i < numWorkers; ++i) {
-      _workers.push_back(std::thread(&ThreadPool::doSomething, this));
+      _queues.emplace_back(new Worker());
+    }
+
+    for(int i = 0; i < numWorkers; ++i) {
+      _workers.push_back(std::thread(&ThreadPool::doSomething, this, i));
     }
   }
 
   ~ThreadPool()
   {
-    _isRunning = false;
-    _job_queue.stop();
+    {
+      std::lock_guard<std::mutex> lock(_sleep_mutex);
+      _isRunning = false;
+    }
+    _sleep_cond.notify_all();
 
     clear();
   }
 
-  void schedule(const std::function<void()>&& function)
+  template<typename F>
+  void schedule(F&& function)
   {
-    _job_queue.push(new std::function<void()>(std::move(function)));
+    bool local = localWorker().first == this;
+    size_t i;
+    if(local) {
+      i = localWorker().second;
+    } else {
+      i = _next.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+    }
+
+    _pending.fetch_add(1);
+    {
+      std::lock_guard<std::mutex> lock(_queues[i]->mutex);
+      if(local) {
+        _queues[i]->local.push_back(Task(std::forward<F>(function)));
+      } else {
+        _queues[i]->injected.push_back(Task(std::forward<F>(function)));
+      }
+    }
+
+    // Wake up an idle worker, if any
+    if(_sleeping.load() > 0) {
+      std::lock_guard<std::mutex> lock(_sleep_mutex);
+      _sleep_cond.notify_one();
+    }
   }
 
 private:
-  void doSomething()
+  // Pool and index of the worker running on the calling thread
+  static std::pair<const ThreadPool*, size_t>& localWorker()
+  {
+    static thread_local std::pair<const ThreadPool*, size_t> worker(nullptr, 0);
+    return worker;
+  }
+
+  void doSomething(const size_t i)
   {
-    std::function<void()>* job;
+    localWorker() = std::make_pair(this, i);
 
+    Task job;
+    size_t taken = 0;
     while(_isRunning) {
-      try {
-        // Get next job on the queue
-        job = _job_queue.pop();
-      } catch(...) {
-        return;
+      bool fair = ++taken % THREAD_POOL_FAIRNESS_INTERVAL == 0;
+      if(!takeJob(i, fair, job) && !stealJob(i, job)) {
+        waitForJobs();
+        continue;
       }
 
       // Execute pending job
-      (*job)();
-      delete job;
+      job();
+      job = nullptr;
+    }
+  }
+
+  bool takeJob(const size_t i, const bool fair, Task& job)
+  {
+    Worker& own = *_queues[i];
+
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if(!own.injected.empty() && (fair || own.local.empty())) {
+      job = own.injected.pop_front();
+    } else if(!own.local.empty()) {
+      job = own.local.pop_back();
+    } else {
+      return false;
+    }
+
+    _pending.fetch_sub(1);
+    return true;
+  }
+
+  bool stealJob(const size_t i, Task& job)
+  {
+    for(size_t n = 1; n < _queues.size(); ++n) {
+      Worker& victim = *_queues[(i + n) % _queues.size()];
+
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if(!victim.injected.empty()) {
+        job = victim.injected.pop_front();
+      } else if(!victim.local.empty()) {
+        job = victim.local.pop_front();
+      } else {
+        continue;
+      }
+
+      _pending.fetch_sub(1);
+      return true;
     }
+
+    return false;
+  }
+
+  void waitForJobs()
+  {
+    std::unique_lock<std::mutex> lock(_sleep_mutex);
+    _sleeping.fetch_add(1);
+    _sleep_cond.wait(lock, [this](){ return _pending.load() > 0 || !_isRunning; });
+    _sleeping.fetch_sub(1);
   }
 
   void clear()
   {
     joinWorkers();
     _workers.clear();
+    _queues.clear();
   }
 
   void joinWorkers()
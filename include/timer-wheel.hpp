@@ -0,0 +1,136 @@
+/** Brief: Timer Wheel
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMER_WHEEL__HPP_
+#define TIMER_WHEEL__HPP_
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+// Hashed timing wheel: timers are stored in the slot of their deadline, so
+// that scheduling a timer and expiring it are both O(1). Timers further away
+// than a full turn of the wheel wait for the remaining turns in their slot.
+//
+// Timers cannot be cancelled: the owner of the expired values is expected to
+// ignore the ones that are no longer relevant.
+//
+// Usage example:
+// '''
+//  (...)
+//
+//  TimerWheel<int> wheel(std::chrono::milliseconds(100), 512);
+//  wheel.schedule(std::chrono::steady_clock::now() + std::chrono::seconds(5), 1);
+//
+//  // Periodically collect the expired timers
+//  for(auto& value : wheel.advance(std::chrono::steady_clock::now())) {
+//    (...)
+//  }
+//
+//  (...)
+// '''
+//
+template<typename T>
+class TimerWheel
+{
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Timer
+  {
+    size_t turns;
+    T value;
+  };
+
+  const Clock::duration _tick;
+  std::vector<std::vector<Timer>> _slots;
+
+  // Slot of the next tick to be processed and the time it expires
+  size_t _current;
+  Clock::time_point _current_time;
+
+  // Timers in the wheel
+  size_t _size;
+
+  mutable std::mutex _mutex;
+
+public:
+  TimerWheel(const Clock::duration tick, const size_t numSlots)
+    : _tick(tick),
+      _slots(numSlots),
+      _current(0),
+      _current_time(Clock::now() + tick),
+      _size(0)
+  { }
+
+  ~TimerWheel()
+  { }
+
+  void schedule(const Clock::time_point deadline, const T& value)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Number of ticks (after the current one) until the deadline
+    size_t ticks = 0;
+    if(deadline > _current_time) {
+      ticks = (deadline - _current_time + _tick - Clock::duration(1)) / _tick;
+    }
+
+    _slots[(_current + ticks) % _slots.size()].push_back({ticks / _slots.size(), value});
+    ++_size;
+  }
+
+  // Process all ticks up to the given time, returning the expired values
+  std::vector<T> advance(const Clock::time_point now)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::vector<T> expired;
+    while(_current_time <= now) {
+      std::vector<Timer>& slot = _slots[_current];
+
+      size_t pending = 0;
+      for(size_t i = 0; i < slot.size(); ++i) {
+        if(slot[i].turns == 0) {
+          expired.push_back(std::move(slot[i].value));
+          continue;
+        }
+
+        --slot[i].turns;
+        if(pending != i) {
+          slot[pending] = std::move(slot[i]);
+        }
+        ++pending;
+      }
+      slot.erase(slot.begin() + pending, slot.end());
+
+      _current = (_current + 1) % _slots.size();
+      _current_time += _tick;
+    }
+
+    _size -= expired.size();
+    return expired;
+  }
+
+  size_t size() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _size;
+  }
+};
+
+#endif /* TIMER_WHEEL__HPP_ */
@@ -0,0 +1,389 @@
+/** Brief: Table of interned URIs
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef URI_TABLE__HPP_
+#define URI_TABLE__HPP_
+
+#include "uri.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+typedef uint32_t UriId;
+
+// Identifier of no URI (e.g., invalid or not interned)
+#define INVALID_URI_ID 0
+
+// Number of independently locked shards (must be a power of two)
+#define URI_TABLE_SHARDS 64
+
+// Size (in bytes) of the blocks holding the URI strings
+#define URI_TABLE_BLOCK_SIZE 16 * 1024
+
+// Usage example:
+// '''
+//  (...)
+//
+//  UriId id = UriTable::getInstance().intern(uri);   // Same URI, same id
+//
+//  // Only look for URIs interned before
+//  if(UriTable::getInstance().find(other) == id) {
+//    (...)
+//  }
+//
+//  Uri copy = UriTable::getInstance().get(id);
+//
+//  (...)
+// '''
+//
+// Gives each distinct (canonical) URI a 32-bit identifier, so tables can
+// hold identifiers instead of full URIs. URIs are never removed from the
+// table, so identifiers stay valid for the whole run.
+//
+// The strings are packed in large blocks, each one preceded by its size and
+// the sizes of its components as variable-length integers (usually one
+// byte each). A shard only keeps a pointer per URI and an open addressing
+// index of 32-bit slots, so an interned URI costs little more than its
+// canonical string. The hash is not kept but computed again when needed.
+//
+// The low bits of an identifier select the shard holding the URI and the
+// remaining bits its position in the shard, starting at 1. Positions are
+// dense, so other tables may index arrays with them.
+//
+class UriTable
+{
+private:
+  // Number of positions each shard can hold (the bits left by the shard
+  // index in an identifier)
+  static const uint32_t POSITIONS = (UINT32_MAX / URI_TABLE_SHARDS) + 1;
+
+  struct Shard
+  {
+    mutable std::shared_timed_mutex mutex;
+
+    // Header and string of each URI, by position - 1
+    std::vector<const char*> records;
+
+    // Open addressing index of the records (0 if empty, the position
+    // otherwise, with a few bits of the hash above it to skip most other
+    // records without looking at them)
+    std::vector<uint32_t> slots;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* block = nullptr;
+    size_t block_used = 0;
+    size_t bytes = 0;
+  };
+
+  std::array<Shard, URI_TABLE_SHARDS> _shards;
+
+public:
+  static UriTable& getInstance()
+  {
+    static UriTable instance;
+    return instance;
+  }
+
+  // Identifier of the given URI, interning it if needed
+  UriId intern(const Uri& uri)
+  {
+    if(!uri.isValid()) {
+      return INVALID_URI_ID;
+    }
+
+    Shard& shard = getShard(uri.hash());
+    const std::string& str = uri.toString();
+
+    {
+      std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+      uint32_t pos = lookup(shard, uri.hash(), str);
+      if(pos != 0) {
+        return makeId(uri.hash(), pos);
+      }
+    }
+
+    std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+    // Someone else may have interned it in the meantime
+    uint32_t pos = lookup(shard, uri.hash(), str);
+    if(pos != 0) {
+      return makeId(uri.hash(), pos);
+    }
+
+    if(shard.records.size() >= POSITIONS - 1) {
+      return INVALID_URI_ID;
+    }
+
+    if((shard.records.size() + 1) * 2 > shard.slots.size()) {
+      grow(shard);
+    }
+
+    shard.records.push_back(store(shard, str, uri.getLayout()));
+    pos = shard.records.size();
+    shard.slots[probe(shard, uri.hash(), str)] = makeSlot(uri.hash(), pos);
+
+    return makeId(uri.hash(), pos);
+  }
+
+  // Identifier of the given URI, or INVALID_URI_ID if it was never interned
+  UriId find(const Uri& uri) const
+  {
+    if(!uri.isValid()) {
+      return INVALID_URI_ID;
+    }
+
+    const Shard& shard = getShard(uri.hash());
+    std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+    uint32_t pos = lookup(shard, uri.hash(), uri.toString());
+    return pos != 0 ? makeId(uri.hash(), pos) : INVALID_URI_ID;
+  }
+
+  // URI with the given identifier (an invalid URI if unknown)
+  Uri get(const UriId id) const
+  {
+    const char* record;
+    const Shard& shard = _shards[id & (URI_TABLE_SHARDS - 1)];
+    std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+    if((record = getRecord(shard, id)) == nullptr) {
+      return Uri();
+    }
+
+    uint32_t size;
+    Uri::Layout layout;
+    const char* data = readHeader(record, size, layout);
+    return Uri::fromCanonical(data, size, layout, Uri::hashString(data, size));
+  }
+
+  std::string getSchema(const UriId id) const
+  {
+    const char* record;
+    const Shard& shard = _shards[id & (URI_TABLE_SHARDS - 1)];
+    std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+    if((record = getRecord(shard, id)) == nullptr) {
+      return "";
+    }
+
+    uint32_t size;
+    Uri::Layout layout;
+    const char* data = readHeader(record, size, layout);
+    return std::string(data, layout.schema);
+  }
+
+  size_t size() const
+  {
+    size_t ret = 0;
+    for(const Shard& shard : _shards) {
+      std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+      ret += shard.records.size();
+    }
+
+    return ret;
+  }
+
+  // Memory (in bytes) held by the table
+  size_t bytes() const
+  {
+    size_t ret = 0;
+    for(const Shard& shard : _shards) {
+      std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+      ret += shard.bytes
+             + shard.records.capacity() * sizeof(const char*)
+             + shard.slots.capacity() * sizeof(uint32_t);
+    }
+
+    return ret;
+  }
+
+  UriTable(UriTable const&) = delete;
+  void operator=(UriTable const&) = delete;
+
+private:
+  UriTable() {};
+
+  static UriId makeId(const uint64_t hash, const uint32_t pos)
+  {
+    return (pos * URI_TABLE_SHARDS) | (hash & (URI_TABLE_SHARDS - 1));
+  }
+
+  // Slot of the given position, tagged with hash bits other than the ones
+  // selecting the shard and the slot
+  static uint32_t makeSlot(const uint64_t hash, const uint32_t pos)
+  {
+    return pos + uint32_t((hash >> 32) & (URI_TABLE_SHARDS - 1)) * POSITIONS;
+  }
+
+  Shard& getShard(const uint64_t hash)
+  {
+    return _shards[hash & (URI_TABLE_SHARDS - 1)];
+  }
+
+  const Shard& getShard(const uint64_t hash) const
+  {
+    return _shards[hash & (URI_TABLE_SHARDS - 1)];
+  }
+
+  static const char* getRecord(const Shard& shard, const UriId id)
+  {
+    size_t pos = id / URI_TABLE_SHARDS;
+    if(pos == 0 || pos > shard.records.size()) {
+      return nullptr;
+    }
+
+    return shard.records[pos - 1];
+  }
+
+  // Position of the record of the given string, or 0 if not found
+  static uint32_t lookup(const Shard& shard, const uint64_t hash, const std::string& str)
+  {
+    if(shard.slots.empty()) {
+      return 0;
+    }
+
+    return shard.slots[probe(shard, hash, str)] % POSITIONS;
+  }
+
+  // Slot holding the given string, or the empty slot where it would go
+  static size_t probe(const Shard& shard, const uint64_t hash, const std::string& str)
+  {
+    // The low bits of the hash already selected the shard
+    size_t mask = shard.slots.size() - 1;
+    size_t i = (hash / URI_TABLE_SHARDS) & mask;
+    uint32_t tag = makeSlot(hash, 0);
+    while(shard.slots[i] != 0) {
+      uint32_t pos = shard.slots[i] % POSITIONS;
+      if(shard.slots[i] - pos == tag) {
+        uint32_t size;
+        Uri::Layout layout;
+        const char* data = readHeader(shard.records[pos - 1], size, layout);
+        if(size == str.size() && memcmp(data, str.data(), size) == 0) {
+          break;
+        }
+      }
+      i = (i + 1) & mask;
+    }
+
+    return i;
+  }
+
+  static void grow(Shard& shard)
+  {
+    size_t size = shard.slots.empty() ? 64 : shard.slots.size() * 2;
+    shard.slots.assign(size, 0);
+
+    for(uint32_t pos = 1; pos <= shard.records.size(); ++pos) {
+      uint32_t len;
+      Uri::Layout layout;
+      const char* data = readHeader(shard.records[pos - 1], len, layout);
+      uint64_t hash = Uri::hashString(data, len);
+
+      size_t i = (hash / URI_TABLE_SHARDS) & (size - 1);
+      while(shard.slots[i] != 0) {
+        i = (i + 1) & (size - 1);
+      }
+      shard.slots[i] = makeSlot(hash, pos);
+    }
+  }
+
+  // Copies the header and the string into the blocks of the shard
+  static const char* store(Shard& shard, const std::string& str, const Uri::Layout& layout)
+  {
+    char header[30];
+    char* end = header;
+    end = writeNumber(end, str.size());
+    end = writeNumber(end, (layout.schema << 1) | (layout.isAbsolute ? 1 : 0));
+    end = writeNumber(end, layout.authority);
+    end = writeNumber(end, layout.path);
+    end = writeNumber(end, layout.query);
+    end = writeNumber(end, layout.fragment);
+
+    size_t size = (end - header) + str.size();
+
+    char* ret;
+    if(size > (URI_TABLE_BLOCK_SIZE) / 4) {
+      // Big strings get a block of their own
+      shard.blocks.emplace_back(new char[size]);
+      shard.bytes += size;
+      ret = shard.blocks.back().get();
+    } else {
+      if(shard.block == nullptr || shard.block_used + size > (URI_TABLE_BLOCK_SIZE)) {
+        shard.blocks.emplace_back(new char[URI_TABLE_BLOCK_SIZE]);
+        shard.bytes += URI_TABLE_BLOCK_SIZE;
+        shard.block = shard.blocks.back().get();
+        shard.block_used = 0;
+      }
+      ret = shard.block + shard.block_used;
+      shard.block_used += size;
+    }
+
+    memcpy(ret, header, end - header);
+    memcpy(ret + (end - header), str.data(), str.size());
+    return ret;
+  }
+
+  // Reads the header of a record, returning where its string starts
+  static const char* readHeader(const char* record, uint32_t& size, Uri::Layout& layout)
+  {
+    uint32_t schema;
+    record = readNumber(record, size);
+    record = readNumber(record, schema);
+    record = readNumber(record, layout.authority);
+    record = readNumber(record, layout.path);
+    record = readNumber(record, layout.query);
+    record = readNumber(record, layout.fragment);
+    layout.schema = schema >> 1;
+    layout.isAbsolute = (schema & 1) != 0;
+
+    return record;
+  }
+
+  // 7 bits per byte, with the highest bit set on all bytes but the last
+  static char* writeNumber(char* out, uint32_t value)
+  {
+    while(value >= 0x80) {
+      *out++ = char((value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+    *out++ = char(value);
+
+    return out;
+  }
+
+  static const char* readNumber(const char* in, uint32_t& value)
+  {
+    value = 0;
+    for(int shift = 0; ; shift += 7) {
+      unsigned char byte = *in++;
+      value |= uint32_t(byte & 0x7f) << shift;
+      if((byte & 0x80) == 0) {
+        break;
+      }
+    }
+
+    return in;
+  }
+};
+
+#endif /* URI_TABLE__HPP_ */
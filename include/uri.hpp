@@ -20,15 +20,51 @@
 
 #include "utils.hpp"
 
-#include <regex>
-
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+
+// A URI is kept as its canonical string (as returned by toString()) along
+// with the position of each of its components in that string and its hash,
+// so comparing and hashing URIs does not build any string.
+//
+// Parsing follows the generic syntax of RFC 3986 (appendix B), i.e.
+//   absolute: <schema>:[//<authority>]<path>[?<query>][#<fragment>]
+//   relative: [//<authority>]<path>[?<query>][#<fragment>]
+// where the schema is everything before the first ':', provided that it is
+// not empty and has no '/', '?' or '#'. Fragments cannot contain line
+// breaks.
+//
 class Uri {
+public:
+  // Sizes of the components of a URI, enough to rebuild it from its
+  // canonical string without parsing it again (see UriTable)
+  struct Layout
+  {
+    uint32_t schema;
+    uint32_t authority;
+    uint32_t path;
+    uint32_t query;
+    uint32_t fragment;
+    bool isAbsolute;
+  };
+
 private:
-  std::string _schema;
-  std::string _authority;
-  std::string _path;
-  std::string _query;
-  std::string _fragment;
+  struct Part
+  {
+    size_t pos;
+    size_t len;
+  };
+
+  std::string _uri;
+  uint64_t _hash = 0;
+
+  Part _schema    = {0, 0};
+  Part _authority = {0, 0};
+  Part _path      = {0, 0};
+  Part _query     = {0, 0};
+  Part _fragment  = {0, 0};
 
   bool _isValid = false;
   bool _isAbsolute = false;
@@ -41,13 +77,11 @@ public:
   Uri(std::string uri)
   {
     fromString(unescapeString(trimString(uri)));
-    normalize();
   }
 
   Uri(const char* uri)
   {
     fromString(unescapeString(trimString(uri)));
-    normalize();
   }
 
   Uri(Uri base, Uri ref)
@@ -56,59 +90,83 @@ public:
       return;
     }
 
+    std::string schema;
+    std::string authority;
+    std::string path;
+    std::string query;
+
     if(ref.isAbsolute()) {
-      _isValid    = true;
-      _isAbsolute = true;
-      _isRelative = false;
-
-      _schema    = ref.getSchema();
-      _authority = ref.getAuthority();
-      _path      = ref.getPath();
-      _query     = ref.getQuery();
-      _fragment  = ref.getFragment();
+      schema    = ref.getSchema();
+      authority = ref.getAuthority();
+      path      = ref.getPath();
+      query     = ref.getQuery();
     }
 
     if(ref.isRelative()) {
-      if(ref.getAuthority().size() != 0) {
-        _isValid    = true;
-        _isAbsolute = true;
-        _isRelative = false;
-
-        _schema    = base.getSchema();
-        _authority = ref.getAuthority();
-        _path      = ref.getPath();
-      } else if(ref.getPath().size() != 0) {
-        _isValid    = true;
-        _isAbsolute = true;
-        _isRelative = false;
-
-        _schema    = base.getSchema();
-        _authority = base.getAuthority();
-        if(ref.getPath().find('/') == 0) {
-          _path = ref.getPath();
+      if(ref._authority.len != 0) {
+        schema    = base.getSchema();
+        authority = ref.getAuthority();
+        path      = ref.getPath();
+      } else if(ref._path.len != 0) {
+        schema    = base.getSchema();
+        authority = base.getAuthority();
+        if(ref._uri[ref._path.pos] == '/') {
+          path = ref.getPath();
         } else {
           size_t pos;
-          if((pos = base.getPath().rfind('/')) != std::string::npos) {
-            _path = base.getPath().substr(0, pos) + '/' + ref.getPath();
+          std::string base_path = base.getPath();
+          if((pos = base_path.rfind('/')) != std::string::npos) {
+            path = base_path.substr(0, pos) + '/' + ref.getPath();
           } else {
-            _path = '/' + ref.getPath();
+            path = '/' + ref.getPath();
           }
         }
-        _query = ref.getQuery();
+        query = ref.getQuery();
       } else {
-        _isValid    = true;
-        _isAbsolute = true;
-        _isRelative = false;
-
-        _schema    = base.getSchema();
-        _authority = base.getAuthority();
-        _path      = base.getPath();
-        _query     = base.getQuery();
+        schema    = base.getSchema();
+        authority = base.getAuthority();
+        path      = base.getPath();
+        query     = base.getQuery();
       }
     }
-    _fragment  = ref.getFragment();
 
-    normalize();
+    assign(schema, authority, path, query, ref.getFragment(), true);
+  }
+
+  // Rebuilds a valid URI from its canonical string, as given by toString(),
+  // along with its layout and hash
+  static Uri fromCanonical(const char* data, const size_t size,
+                           const Layout& layout, const uint64_t hash)
+  {
+    Uri ret;
+    ret._uri.assign(data, size);
+    ret._hash = hash;
+
+    ret._isValid    = true;
+    ret._isAbsolute = layout.isAbsolute;
+    ret._isRelative = !layout.isAbsolute;
+
+    size_t pos = 0;
+    ret._schema = {pos, layout.schema};
+    pos += layout.schema + 1;
+    if(layout.authority != 0) {
+      pos += 2;
+    }
+    ret._authority = {pos, layout.authority};
+    pos += layout.authority;
+    ret._path = {pos, layout.path};
+    pos += layout.path;
+    if(layout.query != 0) {
+      pos += 1;
+    }
+    ret._query = {pos, layout.query};
+    pos += layout.query;
+    if(layout.fragment != 0) {
+      pos += 1;
+    }
+    ret._fragment = {pos, layout.fragment};
+
+    return ret;
   }
 
   void reset()
@@ -117,11 +175,13 @@ public:
     _isAbsolute = false;
     _isRelative = false;
 
-    _schema    = "";
-    _authority = "";
-    _path      = "";
-    _query     = "";
-    _fragment  = "";
+    _uri.clear();
+    _hash = 0;
+    _schema    = {0, 0};
+    _authority = {0, 0};
+    _path      = {0, 0};
+    _query     = {0, 0};
+    _fragment  = {0, 0};
   }
 
   bool isValid() const
@@ -141,219 +201,303 @@ public:
 
   std::string getSchema() const
   {
-    return _schema;
+    return get(_schema);
   }
 
   std::string getAuthority() const
   {
-    return _authority;
+    return get(_authority);
   }
 
   std::string getPath() const
   {
-    return _path;
+    return get(_path);
   }
 
   std::string getQuery() const
   {
-    return _query;
+    return get(_query);
   }
 
   std::string getUriEncodedQuery() const
   {
-    return escapeString(_query);
+    return escapeString(getQuery());
   }
 
   std::string getFragment() const
   {
-    return _fragment;
+    return get(_fragment);
   }
 
   std::string getUriEncodedFragment() const
   {
-    return escapeString(_fragment);
+    return escapeString(getFragment());
   }
 
   void setUri(const Uri uri)
   {
-    reset();
-
-    _isValid    = uri.isValid();
-    _isAbsolute = uri.isAbsolute();
-    _isRelative = uri.isRelative();
-
-    _schema    = uri.getSchema();
-    _authority = uri.getAuthority();
-    _path      = uri.getPath();
-    _query     = uri.getQuery();
-    _fragment  = uri.getFragment();
+    *this = uri;
   }
 
   void setUri(const std::string uri)
   {
-    reset();
-
     fromString(unescapeString(trimString(uri)));
-    normalize();
   }
 
-  std::string toString() const
+  const std::string& toString() const
+  {
+    // Invalid URIs are kept as an empty string
+    return _uri;
+  }
+
+  std::string toUriEncodedString() const
   {
     if(!_isValid) {
       return "";
     }
 
-    std::string ret;
+    std::string ret(_uri, 0, _path.pos + _path.len);
 
-    ret.append(_schema).append(":");
-    if(_authority.size() != 0) {
-      ret.append("//").append(_authority);
+    if(_query.len != 0) {
+      ret.append("?").append(getUriEncodedQuery());
     }
 
-    ret.append(_path);
-
-    if(_query.size() != 0) {
-      ret.append("?").append(_query);
-    }
-
-    if(_fragment.size() != 0) {
-      ret.append("#").append(_fragment);
+    if(_fragment.len != 0) {
+      ret.append("#").append(getUriEncodedFragment());
     }
 
     return ret;
   }
 
-  std::string toUriEncodedString() const
+  Layout getLayout() const
   {
-    if(!_isValid) {
-      return "";
-    }
-
-    std::string ret;
-
-    ret.append(_schema).append(":");
-    if(_authority.size() != 0) {
-      ret.append("//").append(_authority);
-    }
-
-    ret.append(_path);
+    Layout layout = {uint32_t(_schema.len), uint32_t(_authority.len), uint32_t(_path.len),
+                     uint32_t(_query.len), uint32_t(_fragment.len), _isAbsolute};
+    return layout;
+  }
 
-    if(_query.size() != 0) {
-      ret.append("?").append(escapeString(_query));
-    }
+  uint64_t hash() const
+  {
+    return _hash;
+  }
 
-    if(_fragment.size() != 0) {
-      ret.append("#").append(escapeString(_fragment));
+  // 64-bit FNV-1a, as used for the hash of the canonical string
+  static uint64_t hashString(const char* data, const size_t size)
+  {
+    uint64_t hash = 14695981039346656037ULL;
+    for(size_t i = 0; i < size; ++i) {
+      hash ^= (unsigned char) data[i];
+      hash *= 1099511628211ULL;
     }
-
-    return ret;
+    return hash;
   }
 
-  Uri& operator=(const Uri& other)
+  bool operator==(const Uri& other) const
   {
-    setUri(other);
-    return *this;
+    return _hash == other._hash
+           && _uri.size() == other._uri.size()
+           && memcmp(_uri.data(), other._uri.data(), _uri.size()) == 0;
   }
 
-  bool operator==(const Uri& other) const
+  bool operator!=(const Uri& other) const
   {
-    return toString() == other.toString();
+    return !(*this == other);
   }
 
+  // URIs are ordered by hash first, which is consistent but unrelated to
+  // the alphabetical order of their strings
   bool operator<(const Uri& other) const
   {
-    return toString() < other.toString();
+    if(_hash != other._hash) {
+      return _hash < other._hash;
+    }
+    return _uri < other._uri;
   }
 
   bool operator>(const Uri& other) const
   {
-    return toString() > other.toString();
+    return other < *this;
   }
 
 private:
-  void fromString(std::string str)
+  std::string get(const Part& part) const
   {
-    if(!regexAbsoluteUri(str)) {
-      regexRelativeUri(str);
-    }
+    return std::string(_uri, part.pos, part.len);
   }
 
-  bool regexAbsoluteUri(std::string str)
+  void fromString(const std::string& str)
   {
     reset();
 
-    std::smatch match;
-    static std::regex const expression("^(([^:/?#]+):)(//([^/?#]*))?([^?#]*)([?]([^#]*))?(#(.*))?",
-                                       std::regex_constants::ECMAScript | std::regex_constants::icase);
+    // Fragment (everything after the first '#')
+    size_t end = str.size();
+    size_t hash = str.find('#');
+    if(hash != std::string::npos) {
+      if(str.find_first_of("\r\n", hash + 1) != std::string::npos) {
+        return;
+      }
+      end = hash;
+    }
 
-    if(std::regex_match(str, match, expression) && match.size() == 10) {
-      _isValid    = true;
-      _isAbsolute = true;
-      _isRelative = false;
+    // Query (everything after the first '?', up to the fragment)
+    size_t query_end = end;
+    size_t question = str.find('?');
+    if(question < end) {
+      end = question;
+    }
 
-      _schema    = match[2];
-      _authority = match[4];
-      _path      = match[5];
-      _query     = match[7];
-      _fragment  = match[9];
+    // Schema (everything up to the first ':', unless a '/' comes first)
+    size_t pos = 0;
+    bool absolute = false;
+    size_t colon = str.find_first_of(":/");
+    if(colon < end && colon != 0 && str[colon] == ':') {
+      absolute = true;
+      pos = colon + 1;
     }
 
-    return _isValid;
+    // Authority (after '//', up to the next '/')
+    size_t authority_pos = pos;
+    size_t authority_end = pos;
+    if(end - pos >= 2 && str[pos] == '/' && str[pos + 1] == '/') {
+      authority_pos = pos + 2;
+      authority_end = str.find('/', authority_pos);
+      if(authority_end > end) {
+        authority_end = end;
+      }
+      pos = authority_end;
+    }
+
+    Part none = {0, 0};
+    assign(str,
+           {0, absolute ? colon : 0},
+           {authority_pos, authority_end - authority_pos},
+           {pos, end - pos},
+           end < query_end ? Part{end + 1, query_end - end - 1} : none,
+           hash != std::string::npos ? Part{hash + 1, str.size() - hash - 1} : none,
+           absolute);
   }
 
-  bool regexRelativeUri(std::string str)
+  // Components resolved apart (see Uri(base, ref))
+  void assign(const std::string& schema, const std::string& authority, const std::string& path,
+              const std::string& query, const std::string& fragment,
+              const bool absolute)
+  {
+    const std::string* components[] = {&schema, &authority, &path, &query, &fragment};
+    Part parts[5];
+    std::string str;
+    for(int i = 0; i < 5; ++i) {
+      parts[i] = {str.size(), components[i]->size()};
+      str.append(*components[i]);
+    }
+
+    assign(str, parts[0], parts[1], parts[2], parts[3], parts[4], absolute);
+  }
+
+  // Builds the canonical string straight from the components found in str.
+  // The authority and the path are normalized in place, once copied.
+  void assign(const std::string& str, const Part schema, const Part authority, const Part path,
+              const Part query, const Part fragment, const bool absolute)
   {
     reset();
 
-    std::smatch match;
-    static std::regex const expression("^(//([^/?#]*))?([^?#]*)([?]([^#]*))?(#(.*))?",
-                                       std::regex_constants::ECMAScript | std::regex_constants::icase);
+    _isValid    = true;
+    _isAbsolute = absolute;
+    _isRelative = !absolute;
 
-    if(std::regex_match(str, match, expression) && match.size() == 8) {
-      _isValid    = true;
-      _isAbsolute = false;
-      _isRelative = true;
+    _uri.reserve(schema.len + authority.len + path.len + query.len + fragment.len + 5);
 
-      _schema    = "";
-      _authority = match[2];
-      _path      = match[3];
-      _query     = match[5];
-      _fragment  = match[7];
+    _schema = append(str, schema);
+    _uri.append(":");
+    if(authority.len != 0) {
+      _uri.append("//");
     }
+    _authority = append(str, authority);
+    removeDoubleSlashes(_uri, _authority);
 
-    return _isValid;
-  }
+    _path = append(str, path);
+    compressPath(_uri, _path);
+    removeDoubleSlashes(_uri, _path);
 
-  void removeDoubleSlashes(std::string& str) {
-    size_t pos = 0;
-    while((pos = str.find("//")) != std::string::npos) {
-      str.replace(pos, 2, "/");
+    if(query.len != 0) {
+      _uri.append("?");
+    }
+    _query = append(str, query);
+    if(fragment.len != 0) {
+      _uri.append("#");
     }
+    _fragment = append(str, fragment);
+
+    _hash = hashString(_uri.data(), _uri.size());
   }
 
-  void compressPath(std::string& str) {
-    size_t pos = 0;
+  Part append(const std::string& str, const Part part)
+  {
+    Part ret = {_uri.size(), part.len};
+    _uri.append(str, part.pos, part.len);
+    return ret;
+  }
 
-    while((pos = str.find("/./")) != std::string::npos) {
-      str.replace(pos, 3, "/");
+  // Collapses each run of slashes of the part (at the end of str) into a
+  // single one
+  static void removeDoubleSlashes(std::string& str, Part& part)
+  {
+    size_t len = part.pos;
+    for(size_t i = part.pos; i < str.size(); ++i) {
+      if(str[i] != '/' || len == part.pos || str[len - 1] != '/') {
+        str[len++] = str[i];
+      }
     }
+    str.resize(len);
+    part.len = len - part.pos;
+  }
 
-    while((pos = str.find("/../")) != std::string::npos) {
-      size_t tmp = str.rfind("/", pos - 1);
-      str.erase(tmp + 1, pos - tmp + 3);
+  // Removes the "." segments and then the ".." segments, along with the
+  // segment preceding them, from the part (at the end of str). A ".." right
+  // after the root is dropped.
+  static void compressPath(std::string& str, Part& part)
+  {
+    size_t len = part.pos;
+    for(size_t i = part.pos; i < str.size();) {
+      if(len != part.pos && str[len - 1] == '/' && str.compare(i, 2, "./") == 0) {
+        i += 2;
+      } else {
+        str[len++] = str[i++];
+      }
     }
-
+    str.resize(len);
+
+    len = part.pos;
+    for(size_t i = part.pos; i < str.size();) {
+      if(len != part.pos && str[len - 1] == '/' && str.compare(i, 3, "../") == 0) {
+        // Back to the previous '/' of the part, if any
+        if(len - part.pos > 1) {
+          len -= 2;
+          while(len > part.pos && str[len] != '/') {
+            --len;
+          }
+          len = str[len] == '/' ? len + 1 : part.pos;
+        }
+        i += 3;
+      } else {
+        str[len++] = str[i++];
+      }
+    }
+    str.resize(len);
+    part.len = len - part.pos;
   }
+};
 
-  void normalize()
-  {
-    compressPath(_path);
+namespace std {
 
-    // Remove double slashes from authority and path only
-    removeDoubleSlashes(_authority);
-    removeDoubleSlashes(_path);
+template<>
+struct hash<Uri>
+{
+  size_t operator()(const Uri& uri) const
+  {
+    return uri.hash();
   }
 };
 
-#endif /* URI__HPP_ */
+}
 
+#endif /* URI__HPP_ */
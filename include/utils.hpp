@@ -18,42 +18,179 @@
 #ifndef UTILS__HPP_
 #define UTILS__HPP_
 
+#include "buffer.hpp"
 #include "logger.hpp"
 
 #include <algorithm>
 #include <cctype>
-#include <iomanip>
+#include <cstring>
 #include <magic.h>
-#include <sstream>
 #include <stdlib.h>
 #include <string>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Number of bytes of a content looked at to discover its type
+#define CONTENT_SNIFF_SIZE 64 * 1024
+
+// libmagic handle of the calling thread, opened on first use. Loading the
+// magic database is expensive, so each thread does it only once
+class MagicHandle
+{
+private:
+  magic_t _magic;
+
+public:
+  MagicHandle()
+    : _magic(magic_open(MAGIC_MIME_TYPE | MAGIC_CHECK))
+  {
+    if(_magic == NULL) {
+      FIFU_LOG_ERROR("(utils) Error while opening libmagic");
+      return;
+    }
+
+    if(magic_load(_magic, NULL) != 0) {
+      FIFU_LOG_ERROR("(utils) Error while loading the default database");
+      magic_close(_magic);
+      _magic = NULL;
+    }
+  }
+
+  ~MagicHandle()
+  {
+    if(_magic != NULL) {
+      magic_close(_magic);
+    }
+  }
+
+  MagicHandle(const MagicHandle&) = delete;
+  void operator=(const MagicHandle&) = delete;
+
+  static magic_t get()
+  {
+    static thread_local MagicHandle handle;
+    return handle._magic;
+  }
+};
+
 inline
-std::string discoverContentType(const std::string content)
+bool startsWith(const char* data, const size_t size, const char* prefix, const size_t len)
 {
-  magic_t magic = magic_open(MAGIC_MIME_TYPE | MAGIC_CONTINUE | MAGIC_CHECK);
-  if(magic == NULL) {
-    FIFU_LOG_ERROR("(utils) Error while opening libmagic");
-    return "";
+  return size >= len && memcmp(data, prefix, len) == 0;
+}
+
+// Case-insensitive version of startsWith (prefix must be lowercase)
+inline
+bool startsWithNoCase(const char* data, const size_t size, const char* prefix, const size_t len)
+{
+  if(size < len) {
+    return false;
+  }
+
+  for(size_t i = 0; i < len; ++i) {
+    if(std::tolower((unsigned char) data[i]) != prefix[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Type of the most common contents, told by their first bytes (or "" if
+// the type is not one of them)
+inline
+std::string sniffContentType(const char* data, const size_t size)
+{
+  if(size == 0) {
+    return "application/x-empty";
+  }
+
+  // Binary formats have a fixed signature
+  if(startsWith(data, size, "\x89PNG\r\n\x1a\n", 8)) {
+    return "image/png";
+  }
+  if(startsWith(data, size, "\xff\xd8\xff", 3)) {
+    return "image/jpeg";
+  }
+  if(startsWith(data, size, "GIF87a", 6) || startsWith(data, size, "GIF89a", 6)) {
+    return "image/gif";
+  }
+  // RIFF containers have the size of the data between the tag and the
+  // format, so the whole 12 bytes must be in
+  if(size >= 12 && startsWith(data, size, "RIFF", 4) && startsWith(data + 8, size - 8, "WEBP", 4)) {
+    return "image/webp";
+  }
+  if(startsWith(data, size, "\x1f\x8b", 2)) {
+    return "application/gzip";
+  }
+  if(startsWith(data, size, "%PDF-", 5)) {
+    return "application/pdf";
+  }
+
+  // Text formats may start with a BOM and whitespace
+  size_t i = startsWith(data, size, "\xef\xbb\xbf", 3) ? 3 : 0;
+  while(i < size && std::isspace((unsigned char) data[i])) {
+    ++i;
+  }
+
+  const char* text = data + i;
+  size_t len = size - i;
+  if(startsWithNoCase(text, len, "<!doctype html", 14)
+     || startsWithNoCase(text, len, "<html", 5)
+     || startsWithNoCase(text, len, "<head", 5)
+     || startsWithNoCase(text, len, "<body", 5)) {
+    return "text/html";
+  }
+
+  // JSON documents are objects or arrays, which must also be closed at
+  // the end of the content
+  if(len > 0 && (text[0] == '{' || text[0] == '[')) {
+    size_t end = len;
+    while(end > 0 && std::isspace((unsigned char) text[end - 1])) {
+      --end;
+    }
+
+    size_t next = 1;
+    while(next < end && std::isspace((unsigned char) text[next])) {
+      ++next;
+    }
+
+    if(text[0] == '{' && text[end - 1] == '}' && next < end
+       && (text[next] == '"' || text[next] == '}')) {
+      return "application/json";
+    }
+    if(text[0] == '[' && text[end - 1] == ']' && next < end
+       && text[next] != '\0' && strchr("{[\"-0123456789tfn]", text[next]) != NULL) {
+      return "application/json";
+    }
   }
 
-  if(magic_load(magic, NULL) != 0) {
-    FIFU_LOG_ERROR("(utils) Error while loading the default database");
-    magic_close(magic);
+  return "";
+}
+
+inline
+std::string discoverContentType(const Buffer& content)
+{
+  std::string contentType = sniffContentType(content.data(), content.size());
+  if(contentType != "") {
+    return contentType;
+  }
+
+  magic_t magic = MagicHandle::get();
+  if(magic == NULL) {
     return "";
   }
 
-  const char* ct = magic_buffer(magic, content.data(), content.size());
+  size_t size = content.size() < (CONTENT_SNIFF_SIZE) ? content.size() : (CONTENT_SNIFF_SIZE);
+  const char* ct = magic_buffer(magic, content.data(), size);
   if(ct == NULL) {
     FIFU_LOG_ERROR("(utils) Error while detecting the file type");
-    magic_close(magic);
     return "";
   }
 
-  std::string contentType = ct;
-  magic_close(magic);
-
-  return contentType;
+  return ct;
 }
 
 inline
@@ -65,34 +202,166 @@ std::string trimString(std::string str)
   return str;
 }
 
+// Lookup tables for escaping and unescaping URI strings
+struct UriCharTable
+{
+  // Characters left as they are by escapeString(), i.e. the unreserved
+  // characters of RFC 3986 (alphanumeric and "-._~")
+  bool unreserved[256];
+
+  // Value of each hexadecimal digit, -1 for other characters
+  signed char hex[256];
+
+  // Characters skipped by strtol() before the digits (in the C locale)
+  bool space[256];
+
+  constexpr UriCharTable()
+    : unreserved(), hex(), space()
+  {
+    for(int c = 0; c < 256; ++c) {
+      unreserved[c] = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')
+                      || c == '-' || c == '.' || c == '_' || c == '~';
+
+      hex[c] = (c >= '0' && c <= '9') ? c - '0'
+               : (c >= 'A' && c <= 'F') ? c - 'A' + 10
+               : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+               : -1;
+
+      space[c] = c == ' ' || (c >= '\t' && c <= '\r');
+    }
+  }
+};
+
+inline
+const UriCharTable& uriCharTable()
+{
+  static constexpr UriCharTable table;
+  return table;
+}
+
+// Length of the leading run of characters that need no escaping
+inline
+size_t unreservedPrefixLength(const char* str, const size_t size)
+{
+  size_t i = 0;
+
+#ifdef __SSE2__
+  // Check 16 characters at once. Characters above 0x7F are negative, so
+  // they never fall within the (signed) ranges below
+  const __m128i digit_lo = _mm_set1_epi8('0' - 1), digit_hi = _mm_set1_epi8('9' + 1);
+  const __m128i upper_lo = _mm_set1_epi8('A' - 1), upper_hi = _mm_set1_epi8('Z' + 1);
+  const __m128i lower_lo = _mm_set1_epi8('a' - 1), lower_hi = _mm_set1_epi8('z' + 1);
+  const __m128i mark_lo  = _mm_set1_epi8('-' - 1), mark_hi  = _mm_set1_epi8('.' + 1);
+  const __m128i underscore = _mm_set1_epi8('_'), tilde = _mm_set1_epi8('~');
+
+  for(; i + 16 <= size; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+
+    __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(v, digit_lo), _mm_cmplt_epi8(v, digit_hi));
+    ok = _mm_or_si128(ok, _mm_and_si128(_mm_cmpgt_epi8(v, upper_lo), _mm_cmplt_epi8(v, upper_hi)));
+    ok = _mm_or_si128(ok, _mm_and_si128(_mm_cmpgt_epi8(v, lower_lo), _mm_cmplt_epi8(v, lower_hi)));
+    ok = _mm_or_si128(ok, _mm_and_si128(_mm_cmpgt_epi8(v, mark_lo), _mm_cmplt_epi8(v, mark_hi)));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, underscore));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, tilde));
+
+    int mask = _mm_movemask_epi8(ok);
+    if(mask != 0xFFFF) {
+      return i + __builtin_ctz(~mask);
+    }
+  }
+#endif
+
+  const UriCharTable& table = uriCharTable();
+  while(i < size && table.unreserved[(unsigned char) str[i]]) {
+    ++i;
+  }
+
+  return i;
+}
+
 inline
-std::string escapeString(const std::string str)
+std::string escapeString(const std::string& str)
 {
-  std::ostringstream ret;
-  ret << std::setfill('0') << std::hex;
+  static const char digits[] = "0123456789ABCDEF";
+
+  std::string ret;
+  ret.reserve(str.size());
+
+  size_t i = 0;
+  while(i < str.size()) {
+    // Copy the characters that need no escaping in one go
+    size_t run = unreservedPrefixLength(str.data() + i, str.size() - i);
+    ret.append(str, i, run);
+    i += run;
 
-  for(const char& c : str) {
-    if(std::isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~') {
-      ret << std::nouppercase << c;
-    } else {
-      ret << std::uppercase << '%' << std::setw(2) << int((unsigned char) c);
+    if(i < str.size()) {
+      unsigned char c = str[i++];
+      ret.push_back('%');
+      ret.push_back(digits[c >> 4]);
+      ret.push_back(digits[c & 0xF]);
     }
   }
 
-  return ret.str();
+  return ret;
 }
 
+// Each "%" and the (up to) two characters after it are replaced by the
+// character whose code is given by those two characters, read as strtol()
+// would in base 16. The new character is itself unescaped again if it is
+// a "%" (i.e., "%2541" becomes "A").
 inline
-std::string unescapeString(const std::string str)
+std::string unescapeString(const std::string& str)
 {
+  const UriCharTable& table = uriCharTable();
+
+  // Unescape in place: the write position never passes the read one
   std::string res = str;
+  char* data = &res[0];
+  size_t size = res.size();
+  size_t w = 0;
+  size_t r = 0;
+
+  while(r < size) {
+    // Move the characters up to the next "%" in one go
+    const char* next = static_cast<const char*>(memchr(data + r, '%', size - r));
+    size_t run = (next == nullptr ? size : next - data) - r;
+    if(w != r) {
+      memmove(data + w, data + r, run);
+    }
+    w += run;
+    r += run;
+
+    if(r == size) {
+      break;
+    }
+
+    // Digits (if any) after the "%"
+    size_t n = std::min<size_t>(size - r - 1, 2);
+    const unsigned char* d = reinterpret_cast<const unsigned char*>(data + r + 1);
+
+    size_t k = 0;
+    while(k < n && table.space[d[k]]) {
+      ++k;
+    }
+
+    bool negative = false;
+    if(k < n && (d[k] == '+' || d[k] == '-')) {
+      negative = d[k] == '-';
+      ++k;
+    }
+
+    int value = 0;
+    while(k < n && table.hex[d[k]] >= 0) {
+      value = value * 16 + table.hex[d[k]];
+      ++k;
+    }
 
-  // Unescape string
-  size_t pos = 0;
-  while((pos = res.find("%", pos)) != std::string::npos) {
-    res.replace(pos, 3, 1, (char)(int)strtol(res.substr(pos + 1, 2).c_str(), NULL, 16));
+    // The new character is read again as the next input
+    r += n;
+    data[r] = (char) (negative ? -value : value);
   }
 
+  res.resize(w);
   return res;
 }
 
@@ -0,0 +1,200 @@
+/** Brief: Cache of original contents
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "content-cache.hpp"
+#include "metrics.hpp"
+
+ContentCache::ContentCache(const size_t capacity)
+  : _uris(UriTable::getInstance()),
+    _capacity(capacity),
+    _size(0),
+    _next_version(1),
+    _hits(Metrics::getInstance().getCounter("cache.hits")),
+    _misses(Metrics::getInstance().getCounter("cache.misses")),
+    _converted_hits(Metrics::getInstance().getCounter("cache.converted_hits")),
+    _converted_misses(Metrics::getInstance().getCounter("cache.converted_misses"))
+{
+  Metrics::getInstance().setGauge("cache.bytes", [this]() { return size(); });
+}
+
+ContentCache::~ContentCache()
+{
+  Metrics::getInstance().removeGauge("cache.bytes");
+}
+
+bool ContentCache::get(const Uri& uri, std::string& type, Buffer& data, uint64_t& version)
+{
+  if(_capacity == 0) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto it = _entries.find(_uris.find(uri));
+  if(it == _entries.end()) {
+    ++_misses;
+    return false;
+  }
+
+  if(it->second->expires <= std::chrono::steady_clock::now()) {
+    eraseEntry(it->second);
+    ++_misses;
+    return false;
+  }
+
+  // Move entry to the front of the list
+  _lru.splice(_lru.begin(), _lru, it->second);
+
+  type = it->second->type;
+  data = it->second->data;
+  version = it->second->version;
+
+  ++_hits;
+  return true;
+}
+
+uint64_t ContentCache::put(const Uri& uri, const std::string type, const Buffer& data,
+                           const std::chrono::seconds freshness)
+{
+  if(_capacity == 0 || data.size() > _capacity || freshness.count() <= 0) {
+    return 0;
+  }
+
+  UriId key = _uris.intern(uri);
+  if(key == INVALID_URI_ID) {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto it = _entries.find(key);
+  if(it != _entries.end()) {
+    eraseEntry(it->second);
+  }
+
+  // Evict least recently used entries until the new one fits
+  evict(data.size(), _lru.end());
+
+  uint64_t version = _next_version++;
+  _lru.push_front({key, type, data, std::chrono::steady_clock::now() + freshness, version, {}});
+  _entries.emplace(key, _lru.begin());
+  _size += data.size();
+
+  return version;
+}
+
+void ContentCache::erase(const Uri& uri)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto it = _entries.find(_uris.find(uri));
+  if(it != _entries.end()) {
+    eraseEntry(it->second);
+  }
+}
+
+bool ContentCache::getConverted(const Uri& uri, const std::string scheme, const uint64_t version,
+                                Buffer& data)
+{
+  if(_capacity == 0) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto it = _entries.find(_uris.find(uri));
+  if(it == _entries.end()
+     || it->second->version != version
+     || it->second->expires <= std::chrono::steady_clock::now()) {
+    ++_converted_misses;
+    return false;
+  }
+
+  auto it_conv = it->second->converted.find(scheme);
+  if(it_conv == it->second->converted.end()) {
+    ++_converted_misses;
+    return false;
+  }
+
+  data = it_conv->second;
+
+  ++_converted_hits;
+  return true;
+}
+
+void ContentCache::putConverted(const Uri& uri, const std::string scheme, const uint64_t version,
+                                const Buffer& data)
+{
+  if(_capacity == 0 || data.size() > _capacity) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  // Converted contents are only kept along with their original content
+  auto it = _entries.find(_uris.find(uri));
+  if(it == _entries.end() || it->second->version != version) {
+    return;
+  }
+
+  auto entry = it->second;
+  if(entry->converted.find(scheme) != entry->converted.end()) {
+    return;
+  }
+
+  evict(data.size(), entry);
+  if(_size + data.size() > _capacity) {
+    return;
+  }
+
+  entry->converted.emplace(scheme, data);
+  _size += data.size();
+}
+
+size_t ContentCache::size() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _size;
+}
+
+void ContentCache::eraseEntry(std::list<Entry>::iterator it)
+{
+  _size -= it->data.size();
+  for(auto& item : it->converted) {
+    _size -= item.second.size();
+  }
+
+  _entries.erase(it->key);
+  _lru.erase(it);
+}
+
+void ContentCache::evict(const size_t size, std::list<Entry>::iterator keep)
+{
+  while(!_lru.empty() && _size + size > _capacity) {
+    auto it = std::prev(_lru.end());
+    if(it == keep) {
+      // The entry to keep is the only one left
+      if(it == _lru.begin()) {
+        return;
+      }
+
+      it = std::prev(it);
+    }
+
+    eraseEntry(it);
+  }
+}
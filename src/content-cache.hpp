@@ -0,0 +1,97 @@
+/** Brief: Cache of original contents
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTENT_CACHE__HPP_
+#define CONTENT_CACHE__HPP_
+
+#include "buffer.hpp"
+#include "uri.hpp"
+#include "uri-table.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Least recently used cache of the contents received from the original
+// networks, bounded by the total size (in bytes) of the cached contents.
+// Entries expire after the freshness period given by the source protocol.
+//
+// Each entry also keeps the contents already converted for each target
+// scheme. These are tied to the version of the original content, so they are
+// dropped whenever the original content is replaced, expires or is evicted.
+//
+// A capacity of 0 disables the cache: nothing is stored nor looked up, and
+// no hits or misses are counted.
+class ContentCache
+{
+private:
+  struct Entry
+  {
+    UriId key;
+    std::string type;
+    Buffer data;
+    std::chrono::steady_clock::time_point expires;
+    uint64_t version;
+
+    // Scheme -> Converted content
+    std::map<std::string, Buffer> converted;
+  };
+
+  UriTable& _uris;
+
+  size_t _capacity;
+  size_t _size;
+  uint64_t _next_version;
+
+  // Most recently used entries at the front
+  std::list<Entry> _lru;
+  std::unordered_map<UriId, std::list<Entry>::iterator> _entries;
+  mutable std::mutex _mutex;
+
+  std::atomic<uint64_t>& _hits;
+  std::atomic<uint64_t>& _misses;
+  std::atomic<uint64_t>& _converted_hits;
+  std::atomic<uint64_t>& _converted_misses;
+
+public:
+  ContentCache(const size_t capacity);
+  ~ContentCache();
+
+  // Versions are never 0, which stands for "not cached"
+  // Contents are shared with the cache, not copied
+  bool get(const Uri& uri, std::string& type, Buffer& data, uint64_t& version);
+  uint64_t put(const Uri& uri, const std::string type, const Buffer& data,
+               const std::chrono::seconds freshness);
+  void erase(const Uri& uri);
+
+  bool getConverted(const Uri& uri, const std::string scheme, const uint64_t version,
+                    Buffer& data);
+  void putConverted(const Uri& uri, const std::string scheme, const uint64_t version,
+                    const Buffer& data);
+
+  size_t size() const;
+
+private:
+  void eraseEntry(std::list<Entry>::iterator it);
+  void evict(const size_t size, std::list<Entry>::iterator keep);
+};
+
+#endif /* CONTENT_CACHE__HPP_ */
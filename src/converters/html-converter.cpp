@@ -33,16 +33,15 @@ extern "C" void destroy_object(HtmlConverter* object)
 }
 
 std::map<std::string, Uri>
-HtmlConverter::extractUrisFromContent(const Uri uri, const std::string content)
+HtmlConverter::extractUrisFromContent(const Uri uri, const Buffer& content)
 {
   std::map<std::string, Uri> uris;
 
-  std::smatch match;
   std::regex expression("(href|src)[[:space:]]*=[[:space:]]*(\"|'|`)(.*?)\\2",
                         std::regex_constants::ECMAScript | std::regex_constants::icase);
 
-  std::sregex_token_iterator end;
-  for(std::sregex_token_iterator i(content.begin(), content.end(), expression, {2, 3}); i != end; ++i) {
+  std::cregex_token_iterator end;
+  for(std::cregex_token_iterator i(content.begin(), content.end(), expression, {2, 3}); i != end; ++i) {
     std::string quote = i->str();
     std::string e_uri = (++i)->str();
     std::string trimmed_e_uri = trimString(e_uri);
@@ -56,11 +55,11 @@ HtmlConverter::extractUrisFromContent(const Uri uri, const std::string content)
 }
 
 std::string
-HtmlConverter::convertContent(const std::string content,
+HtmlConverter::convertContent(const Buffer& content,
                               const std::map<std::string, Uri>& mappings)
 {
   // Adapt each URI to cope with foreign network
-  std::string tmp = content;
+  std::string tmp = content.toString();
   for(auto& uris : mappings) {
     // Replace URI on the content
     std::string o_uri = uris.first;
@@ -27,8 +27,8 @@ public:
   ~HtmlConverter() { };
 
   std::vector<std::string> getFileTypes() const { return {"text/html"}; };
-  std::map<std::string, Uri> extractUrisFromContent(const Uri uri, const std::string content);
-  std::string convertContent(const std::string content, const std::map<std::string, Uri>& mappings);
+  std::map<std::string, Uri> extractUrisFromContent(const Uri uri, const Buffer& content);
+  std::string convertContent(const Buffer& content, const std::map<std::string, Uri>& mappings);
 };
 
 #endif /* HTML_CONVERTER__HPP_ */
@@ -17,14 +17,93 @@
 
 #include "core.hpp"
 #include "logger.hpp"
+#include "metrics.hpp"
 #include "utils.hpp"
 
 #include <algorithm>
+#include <iostream>
 #include <memory>
 
-void Core::loadProtocol(const std::string path)
+Core::Core(ThreadPool& tp, const size_t cacheSize, const long cacheTtl,
+           const long requestTimeout)
+  : isRunning(false),
+    _tp(tp),
+    _uris(UriTable::getInstance()),
+    _next_waiter_id(1),
+    _request_timeout(requestTimeout),
+    _timers(std::chrono::milliseconds(EXPIRY_TIMER_TICK), EXPIRY_TIMER_SLOTS),
+    _metrics_interval(0),
+    _metrics_requested(false),
+    _cache(cacheSize),
+    _cache_ttl(cacheTtl),
+    _in_flight(0),
+    _requests(Metrics::getInstance().getCounter("core.requests")),
+    _upstream_requests(Metrics::getInstance().getCounter("core.upstream_requests")),
+    _expired_requests(Metrics::getInstance().getCounter("core.expired_requests"))
 {
-  pm.loadProtocol(path, _queue, _tp);
+  // Number of foreign requests served by each request sent upstream
+  Metrics::getInstance().setGauge("core.coalescing_ratio", [this]() {
+    uint64_t upstream = _upstream_requests;
+    return upstream == 0 ? 0.0 : double(_requests) / upstream;
+  });
+
+  Metrics::getInstance().setGauge("core.queue_depth", [this]() {
+    return double(_queue.size());
+  });
+  Metrics::getInstance().setGauge("core.in_flight", [this]() {
+    return double(_in_flight);
+  });
+
+  // Both go back to 0 once every request is answered or expired
+  Metrics::getInstance().setGauge("core.pending_responses", [this]() {
+    return double(_waiting_for_response.size());
+  });
+  Metrics::getInstance().setGauge("core.expiry_timers", [this]() {
+    return double(_timers.size());
+  });
+
+  Metrics::getInstance().setGauge("core.interned_uris", [this]() {
+    return double(_uris.size());
+  });
+  Metrics::getInstance().setGauge("core.interned_uris_bytes", [this]() {
+    return double(_uris.bytes());
+  });
+}
+
+Core::~Core()
+{
+  Metrics::getInstance().removeGauge("core.coalescing_ratio");
+  Metrics::getInstance().removeGauge("core.queue_depth");
+  Metrics::getInstance().removeGauge("core.in_flight");
+  Metrics::getInstance().removeGauge("core.pending_responses");
+  Metrics::getInstance().removeGauge("core.expiry_timers");
+  Metrics::getInstance().removeGauge("core.interned_uris");
+  Metrics::getInstance().removeGauge("core.interned_uris_bytes");
+}
+
+void Core::setQueueWatermarks(const size_t high, const size_t low)
+{
+  _queue.setWatermarks(high, low);
+}
+
+void Core::setMetricsInterval(const long seconds)
+{
+  _metrics_interval = seconds;
+}
+
+void Core::dumpMetrics()
+{
+  _metrics_requested = true;
+}
+
+void Core::setProtocolOptions(const std::map<std::string, std::string>& options)
+{
+  pm.setProtocolOptions(options);
+}
+
+bool Core::loadProtocol(const std::string path)
+{
+  return pm.loadProtocol(path, _queue, _tp);
 }
 
 void Core::loadConverter(const std::string path)
@@ -43,28 +122,17 @@ std::vector<Uri> Core::createMapping(const Uri o_uri)
     schemes.erase(it);
   }
 
-  // Get existing mappings for the given URI
-  std::unique_lock<std::shared_timed_mutex> lock(_mappings_mutex);
-  for(auto& item : _mappings) {
-    if(item.second == o_uri) {
-      f_uris.push_back(item.first);
-
-      // Drop the scheme from the list
-      it = std::find(schemes.begin(), schemes.end(), item.first.getSchema());
-      if (it != schemes.end()) {
-        schemes.erase(it);
-      }
-    }
-  }
-
-  // Check if all protocols have a mapping for the given URI
-  // If no mapping for a protocol is found create one
-  for(auto& scheme : schemes) {
-    Uri f_uri = pm.installMapping(o_uri, scheme);
-    FIFU_LOG_INFO("(Core) New mapping: " + f_uri.toString() + " -> " + o_uri.toString());
+  std::map<std::string, Uri> existing =
+    _mappings.getOrInstallForeign(o_uri, schemes,
+                                  [this, &o_uri](const std::string& scheme) {
+                                    Uri f_uri = pm.installMapping(o_uri, scheme);
+                                    FIFU_LOG_INFO("(Core) New mapping: " + f_uri.toString()
+                                                  + " -> " + o_uri.toString());
+                                    return f_uri;
+                                  });
 
-    _mappings.emplace(f_uri, o_uri);
-    f_uris.push_back(f_uri);
+  for(auto& item : existing) {
+    f_uris.push_back(item.second);
   }
 
   return f_uris;
@@ -75,124 +143,533 @@ void Core::stop()
   isRunning = false;
   pm.stop();
   _queue.stop();
+
+  {
+    std::lock_guard<std::mutex> lock(_in_flight_mutex);
+    _in_flight_cond.notify_all();
+  }
+
+  FIFU_LOG_INFO("(Core) Metrics: " + Metrics::getInstance().toString());
 }
 
 void Core::start()
 {
   isRunning = true;
 
-  const MetaMessage* in;
+  _timer_thread = std::thread(&Core::runTimers, this);
+
+  MetaMessagePtr in;
   while(isRunning) {
     // Process next message
     try {
       in = _queue.pop();
     } catch(...) {
-      return;
+      break;
     }
 
     // Schedule message processing
     FIFU_LOG_INFO("(Core) Scheduling next message (" + in->getUriString() + ") processing");
-    std::function<void()> func(std::bind(&Core::processMessage, this, in));
-    _tp.schedule(std::move(func));
+    waitForProcessingSlot();
+    _tp.schedule([this, in = std::move(in)]() mutable {
+      processMessage(std::move(in));
+      releaseProcessingSlot();
+    });
+  }
+
+  // Also when stopped before it started
+  isRunning = false;
+  _timer_thread.join();
+}
+
+void Core::waitForProcessingSlot()
+{
+  if(_in_flight.load() >= _queue.getHighWatermark()) {
+    std::unique_lock<std::mutex> lock(_in_flight_mutex);
+    _in_flight_cond.wait(lock, [this]() {
+      return _in_flight.load() < _queue.getHighWatermark() || !isRunning;
+    });
   }
+
+  _in_flight.fetch_add(1);
 }
 
-void Core::processMessage(const MetaMessage* msg)
+void Core::releaseProcessingSlot()
+{
+  if(_in_flight.fetch_sub(1) >= _queue.getHighWatermark()) {
+    std::lock_guard<std::mutex> lock(_in_flight_mutex);
+    _in_flight_cond.notify_one();
+  }
+}
+
+void Core::processMessage(MetaMessagePtr msg)
 {
   FIFU_LOG_INFO("(Core) Processing message (" + msg->getUriString() + ")");
-  std::vector<Uri> out_uris;
 
-  // Begin: Locking scope
-  {
-    // Check if message is identified by a foreign URI
-    // (i.e., foreign URI exists in mappings)
-    std::shared_lock<std::shared_timed_mutex> lock_map(_mappings_mutex);
-    auto it = _mappings.find(msg->getUri());
-    if(it != _mappings.end()) {
-      out_uris.push_back(it->second);
-      lock_map.unlock();
-
-      // Message will (eventually) be replied
-      std::unique_lock<std::shared_timed_mutex> lock_wait(_waiting_for_response_mutex);
-      auto it_wait = _waiting_for_response.find(it->second);
-      if(it_wait != _waiting_for_response.end()) {
-        it_wait->second.push_back(msg->getUri());
-      } else {
-        std::vector<Uri> vec;
-        vec.push_back(msg->getUri());
-        _waiting_for_response[it->second] = vec;
-      }
-      lock_wait.unlock();
+  // Check if message is identified by a foreign URI
+  // (i.e., foreign URI exists in mappings)
+  Uri o_uri;
+  if(_mappings.getOriginal(msg->getUri(), o_uri)) {
+    processRequest(msg.get(), o_uri);
+  } else if(msg->getMessageType() == MESSAGE_TYPE_FAILURE) {
+    // Original network was unable to answer a previous request
+    processFailure(msg.get());
+  } else {
+    // Let's assume that is an original URI
+    // (i.e., response to a previous request)
+    processResponse(msg.get());
+  }
+}
 
-    } else {
-      lock_map.unlock();
-      // Let's assume that is an original URI
-      // (i.e., response to a previous request)
-      std::unique_lock<std::shared_timed_mutex> lock_wait(_waiting_for_response_mutex);
-      auto it_wait = _waiting_for_response.find(msg->getUri());
-      if(it_wait != _waiting_for_response.end()) {
-        out_uris = it_wait->second;
-      }
+void Core::processRequest(const MetaMessage* msg, const Uri o_uri)
+{
+  ++_requests;
 
-      if(!msg->getKeepSession()) {
-        _waiting_for_response.erase(msg->getUri());
-      }
-      lock_wait.unlock();
-    }
-  } // End: Locking scope
+  // Answer straight away if the content is cached
+  std::string type;
+  Buffer data;
+  uint64_t version;
+  if(_cache.get(o_uri, type, data, version)) {
+    FIFU_LOG_INFO("(Core) Answering " + msg->getUriString() + " from cache");
+
+    MetaMessage response;
+    response.setUri(o_uri);
+    response.setMessageType(MESSAGE_TYPE_RESPONSE);
+    response.setContent(type, data);
+
+    forwardMessage(&response, {msg->getUri()}, version);
+    return;
+  }
+
+  // Message will (eventually) be replied, or expire at its deadline
+  // Only one request per original URI is sent upstream at a time
+  // Both URIs are mapped, hence already interned
+  UriId o_id = _uris.intern(o_uri);
+  auto now = std::chrono::steady_clock::now();
+  Waiter waiter = {_uris.intern(msg->getUri()), _next_waiter_id++,
+                   now + std::chrono::seconds(_request_timeout), false};
+
+  bool forward = false;
+  _waiting_for_response.upsert(o_id,
+                               [&](PendingResponse& pending, bool inserted) {
+                                 pending.waiting.push_back(waiter);
+
+                                 if(inserted || now - pending.forwarded
+                                                  > std::chrono::seconds(REQUEST_COALESCING_WINDOW)) {
+                                   pending.forwarded = now;
+                                   forward = true;
+                                 }
+                               });
+  _timers.schedule(waiter.deadline, {o_id, waiter.id});
+
+  if(!forward) {
+    FIFU_LOG_INFO("(Core) Request for " + o_uri.toString() + " already in-flight");
+    return;
+  }
+
+  ++_upstream_requests;
+
+  MetaMessage request = *msg;
+  request.setDeadline(waiter.deadline);
+  if(request.getTraceId() == 0) {
+    request.setTraceId(waiter.id);
+  }
+  forwardMessage(&request, {o_uri});
+}
+
+void Core::processResponse(const MetaMessage* msg)
+{
+  if(msg->getChunkNumber() != size_t(-1)) {
+    processChunk(msg);
+    return;
+  }
+
+  std::vector<UriId> out_uris;
+
+  bool keepSession = msg->getKeepSession();
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(_request_timeout);
+  UriId o_id = _uris.find(msg->getUri());
+  _waiting_for_response.apply(o_id,
+                              [&](PendingResponse& pending) {
+                                for(auto& waiter : pending.waiting) {
+                                  out_uris.push_back(waiter.f_uri);
+
+                                  // Waiters of an ongoing session wait for
+                                  // the next response (their timer is
+                                  // re-armed when it fires)
+                                  if(keepSession) {
+                                    waiter.deadline = deadline;
+                                  }
+                                }
+                                return !keepSession;
+                              });
 
   if(out_uris.size() == 0) {
     FIFU_LOG_WARN("(Core) Mapping for " + msg->getUriString() + " not found!");
+    return;
+  }
+
+  // Contents of an ongoing session are not complete responses
+  uint64_t version = 0;
+  if(!keepSession) {
+    long freshness = msg->getFreshness();
+    version = _cache.put(msg->getUri(), msg->getContentType(), msg->getContentData(),
+                         std::chrono::seconds(freshness < 0 ? _cache_ttl : freshness));
+  }
+
+  // Reply once to each foreign URI, even if requested several times
+  forwardMessage(msg, toUris(out_uris), version);
+}
+
+// Chunks may be processed out of order, so they are put back in order
+// first. Chunks of contents that need no conversion are sent as soon as
+// they are in order to the waiters of plugins supporting streaming (if
+// they were there from the first chunk). Everyone else gets the whole
+// content once the last chunk is in.
+void Core::processChunk(const MetaMessage* msg)
+{
+  size_t number = msg->getChunkNumber();
+
+  // The first chunk tells the type of the whole content
+  std::string type;
+  bool streamable = false;
+  if(number == 0) {
+    type = msg->getContentType();
+    if(type == "") {
+      type = discoverContentType(msg->getContentData());
+      FIFU_LOG_WARN("(Core) Detected content type (" + type +") of " + msg->getUriString());
+    }
+
+    // Contents to be converted need to be whole
+    streamable = !pm.getConverterPlugin(type);
+  }
+
+  std::vector<std::pair<size_t, Buffer>> ready;
+  std::vector<Buffer> chunks;
+  std::vector<UriId> stream_uris;
+  std::vector<UriId> whole_uris;
+  size_t last = -1;
+  bool found = false;
+  bool complete = false;
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(_request_timeout);
+  UriId o_id = _uris.find(msg->getUri());
+  _waiting_for_response.apply(o_id,
+                              [&](PendingResponse& pending) {
+                                found = true;
+
+                                // Drop duplicates
+                                if(number < pending.chunks.size()
+                                   || pending.early.count(number) != 0) {
+                                  return false;
+                                }
 
-    delete msg;
+                                if(!msg->getKeepSession()) {
+                                  pending.last = number;
+                                }
+                                if(number == 0) {
+                                  pending.type = type;
+                                  pending.streamable = streamable;
+                                }
+                                pending.early.emplace(number, msg->getContentData());
+
+                                auto it = pending.early.begin();
+                                while(it != pending.early.end()
+                                      && it->first == pending.chunks.size()) {
+                                  ready.emplace_back(it->first, it->second);
+                                  pending.chunks.push_back(it->second);
+                                  it = pending.early.erase(it);
+                                }
+
+                                type = pending.type;
+                                last = pending.last;
+                                complete = pending.last != size_t(-1)
+                                           && pending.chunks.size() > pending.last;
+                                bool first = !ready.empty() && ready.front().first == 0;
+
+                                for(auto& waiter : pending.waiting) {
+                                  if(first && pending.streamable) {
+                                    auto protocol = pm.getProtocolPlugin(_uris.getSchema(waiter.f_uri));
+                                    waiter.streaming = protocol && protocol->supportsStreaming();
+                                  }
+
+                                  if(waiter.streaming) {
+                                    stream_uris.push_back(waiter.f_uri);
+                                  } else if(complete) {
+                                    whole_uris.push_back(waiter.f_uri);
+                                  }
+
+                                  // Waiters wait for the next chunk (their
+                                  // timer is re-armed when it fires)
+                                  if(!complete) {
+                                    waiter.deadline = deadline;
+                                  }
+                                }
+
+                                if(complete) {
+                                  chunks.swap(pending.chunks);
+                                }
+                                return complete;
+                              });
+
+  if(!found) {
+    FIFU_LOG_WARN("(Core) Mapping for " + msg->getUriString() + " not found!");
+    return;
+  }
+
+  if(!ready.empty() && !stream_uris.empty()) {
+    std::vector<Uri> out_uris = toUris(stream_uris);
+    for(auto& chunk : ready) {
+      MetaMessage part;
+      part.setUri(msg->getUri());
+      part.setMetadata(msg->getMetadata());
+      part.setContent(type, chunk.second);
+      part.setContentLength(msg->getContentLength());
+      part.setChunkNumber(chunk.first);
+      part.setKeepSession(chunk.first != last);
+
+      forwardMessage(&part, out_uris);
+    }
+  }
+
+  if(!complete) {
     return;
   }
 
+  Buffer data;
+  if(chunks.size() == 1) {
+    data = chunks.front();
+  } else {
+    size_t size = 0;
+    for(auto& chunk : chunks) {
+      size += chunk.size();
+    }
+
+    std::string content;
+    content.reserve(size);
+    for(auto& chunk : chunks) {
+      content.append(chunk.data(), chunk.size());
+    }
+    data = Buffer(std::move(content));
+  }
+
+  long freshness = msg->getFreshness();
+  uint64_t version = _cache.put(msg->getUri(), type, data,
+                                std::chrono::seconds(freshness < 0 ? _cache_ttl : freshness));
+
+  // A foreign URI may also be among the streamed ones, when its protocol
+  // asked again after streaming started (e.g., another HTTP client)
+  if(whole_uris.empty()) {
+    return;
+  }
+
+  MetaMessage whole;
+  whole.setUri(msg->getUri());
+  whole.setMessageType(MESSAGE_TYPE_RESPONSE);
+  whole.setContent(type, data);
+  whole.setFreshness(freshness);
+  whole.setTraceId(msg->getTraceId());
+
+  forwardMessage(&whole, toUris(whole_uris), version);
+}
+
+void Core::processFailure(const MetaMessage* msg)
+{
+  std::vector<UriId> out_uris;
+  _waiting_for_response.apply(_uris.find(msg->getUri()),
+                              [&out_uris](PendingResponse& pending) {
+                                for(auto& waiter : pending.waiting) {
+                                  out_uris.push_back(waiter.f_uri);
+                                }
+                                return true;
+                              });
+
+  FIFU_LOG_WARN("(Core) Unable to get " + msg->getUriString());
+
+  for(auto& f_uri : toUris(out_uris)) {
+    sendFailure(f_uri);
+  }
+}
+
+void Core::forwardMessage(const MetaMessage* msg, const std::vector<Uri>& out_uris,
+                          const uint64_t version)
+{
+  std::string contentType = msg->getContentType();
+  if(contentType == "") {
+    contentType = discoverContentType(msg->getContentData());
+    FIFU_LOG_WARN("(Core) Detected content type (" + contentType +") of " + msg->getUriString());
+  }
+
+  std::shared_ptr<PluginConverter> converter = pm.getConverterPlugin(contentType);
+
+  // Scheme -> Converted content
+  std::map<std::string, Buffer> converted;
+
   for(auto& item : out_uris) {
-    MetaMessage* out = new MetaMessage();
+    MetaMessagePtr out = createMetaMessage();
     out->setUri(item);
     out->setMetadata(msg->getMetadata());
 
-    std::string contentType = msg->getContentType();
-    if(contentType == "") {
-      contentType = discoverContentType(msg->getContentData());
-      FIFU_LOG_WARN("(Core) Detected content type (" + contentType +") of " + msg->getUriString());
-    }
-
-    std::shared_ptr<PluginConverter> converter = pm.getConverterPlugin(contentType);
     if(converter) {
-      // Extract existent URIs and create mappings to other architectures
-      std::map<std::string, Uri> uris;
-      uris = converter->extractUrisFromContent(msg->getUri(), msg->getContentData());
-
-      std::map<std::string, Uri> mappings_for_convertion;
-      for(auto& o_uri : uris) {
-        std::vector<Uri> f_uris = createMapping(o_uri.second);
-
-        for(auto& f_uri : f_uris) {
-          if(f_uri.getSchema() == out->getUri().getSchema()) {
-            mappings_for_convertion.emplace(o_uri.first, f_uri);
-            break;
+      std::string scheme = item.getSchema();
+
+      auto it = converted.find(scheme);
+      if(it == converted.end()) {
+        Buffer data;
+        if(version == 0 || !_cache.getConverted(msg->getUri(), scheme, version, data)) {
+          data = convertContent(msg, converter, scheme);
+
+          if(version != 0) {
+            _cache.putConverted(msg->getUri(), scheme, version, data);
           }
         }
+
+        it = converted.emplace(scheme, data).first;
       }
 
-      out->setContent(contentType,
-                      converter->convertContent(msg->getContentData(),
-                                                mappings_for_convertion));
+      out->setContent(contentType, it->second);
     } else {
       // If no converter is found send the content without conversion
       out->setContent(contentType, msg->getContentData());
+      out->setContentLength(msg->getContentLength());
     }
 
     // Send message to destination network architecture
     std::shared_ptr<PluginProtocol> protocol = pm.getProtocolPlugin(out->getUri().getSchema());
     if(protocol) {
-      protocol->sendMessage(out);
+      protocol->sendMessage(std::move(out));
     } else {
       FIFU_LOG_WARN("(Core) Protocol endpoint for '" + out->getUri().getSchema() + "' not found");
     }
   }
+}
+
+Buffer Core::convertContent(const MetaMessage* msg,
+                            std::shared_ptr<PluginConverter> converter,
+                            const std::string scheme)
+{
+  // Extract existent URIs and create mappings to other architectures
+  std::map<std::string, Uri> uris;
+  uris = converter->extractUrisFromContent(msg->getUri(), msg->getContentData());
+
+  std::map<std::string, Uri> mappings_for_convertion;
+  for(auto& o_uri : uris) {
+    std::vector<Uri> f_uris = createMapping(o_uri.second);
+
+    for(auto& f_uri : f_uris) {
+      if(f_uri.getSchema() == scheme) {
+        mappings_for_convertion.emplace(o_uri.first, f_uri);
+        break;
+      }
+    }
+  }
+
+  return converter->convertContent(msg->getContentData(), mappings_for_convertion);
+}
+
+void Core::runTimers()
+{
+  auto next_dump = std::chrono::steady_clock::now() + std::chrono::seconds(_metrics_interval);
+  while(isRunning) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(EXPIRY_TIMER_TICK));
+
+    auto now = std::chrono::steady_clock::now();
+    expireRequests(now);
+
+    if(_metrics_requested.exchange(false)
+       || (_metrics_interval > 0 && now >= next_dump)) {
+      next_dump = now + std::chrono::seconds(_metrics_interval);
+      writeMetrics();
+    }
+  }
+}
+
+// Written whatever the level of the logger, so that they can be followed
+// while running
+void Core::writeMetrics()
+{
+  std::cerr << std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::system_clock::now().time_since_epoch()).count()
+            << " [METRICS] " << Metrics::getInstance().toString() << std::endl;
+}
+
+void Core::expireRequests(const std::chrono::steady_clock::time_point now)
+{
+  for(auto& timer : _timers.advance(now)) {
+    // Waiters already answered are no longer found and waiters whose
+    // deadline was postponed get their timer re-armed, so each waiter
+    // has a single timer in the wheel
+    UriId f_uri = INVALID_URI_ID;
+    bool expired = false;
+    bool waiting = false;
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    _waiting_for_response.apply(timer.o_uri,
+                                [&](PendingResponse& pending) {
+                                  auto it = std::find_if(pending.waiting.begin(),
+                                                         pending.waiting.end(),
+                                                         [&timer](const Waiter& waiter) {
+                                                           return waiter.id == timer.id;
+                                                         });
+                                  if(it != pending.waiting.end() && it->deadline > now) {
+                                    deadline = it->deadline;
+                                  } else if(it != pending.waiting.end()) {
+                                    f_uri = it->f_uri;
+                                    expired = true;
+                                    pending.waiting.erase(it);
+
+                                    // Check for other requests of the same foreign URI
+                                    waiting = std::any_of(pending.waiting.begin(),
+                                                          pending.waiting.end(),
+                                                          [&f_uri](const Waiter& waiter) {
+                                                            return waiter.f_uri == f_uri;
+                                                          });
+                                  }
+                                  return pending.waiting.empty();
+                                });
+
+    if(deadline != std::chrono::steady_clock::time_point::max()) {
+      _timers.schedule(deadline, timer);
+      continue;
+    }
+
+    if(!expired) {
+      continue;
+    }
+
+    ++_expired_requests;
+    FIFU_LOG_WARN("(Core) Request of " + _uris.get(f_uri).toString() + " to "
+                  + _uris.get(timer.o_uri).toString() + " expired");
+    if(!waiting) {
+      sendFailure(_uris.get(f_uri));
+    }
+  }
+}
+
+// Sorted and without duplicates
+std::vector<Uri> Core::toUris(std::vector<UriId>& ids) const
+{
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  std::vector<Uri> ret;
+  ret.reserve(ids.size());
+  for(auto id : ids) {
+    ret.push_back(_uris.get(id));
+  }
+
+  return ret;
+}
+
+void Core::sendFailure(const Uri f_uri)
+{
+  std::shared_ptr<PluginProtocol> protocol = pm.getProtocolPlugin(f_uri.getSchema());
+  if(!protocol) {
+    FIFU_LOG_WARN("(Core) Protocol endpoint for '" + f_uri.getSchema() + "' not found");
+    return;
+  }
+
+  MetaMessagePtr out = createMetaMessage();
+  out->setUri(f_uri);
+  out->setMessageType(MESSAGE_TYPE_FAILURE);
 
-  delete msg;
+  protocol->sendMessage(std::move(out));
 }
@@ -19,16 +19,75 @@
 #define CORE__HPP_
 
 #include "plugin-manager.hpp"
+#include "buffer.hpp"
+#include "content-cache.hpp"
+#include "mapping-table.hpp"
 #include "concurrent-blocking-queue.hpp"
+#include "concurrent-hash-map.hpp"
 #include "thread-pool.hpp"
+#include "timer-wheel.hpp"
 #include "uri.hpp"
+#include "uri-table.hpp"
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <map>
-#include <shared_mutex>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
+// Time (in seconds) after which a pending request is sent upstream again,
+// instead of waiting for the response of the in-flight one
+#define REQUEST_COALESCING_WINDOW 30
+
+// Default size (in bytes) of the content cache
+#define DEFAULT_CACHE_SIZE 64 * 1024 * 1024
+
+// Time (in seconds) a content is kept in the cache when the source network
+// gives no freshness information
+#define DEFAULT_CACHE_TTL 60
+
+// Time (in seconds) a foreign request waits for its response
+#define DEFAULT_REQUEST_TIMEOUT 30
+
+// Resolution (in milliseconds) and number of slots of the expiry timers
+#define EXPIRY_TIMER_TICK 100
+#define EXPIRY_TIMER_SLOTS 1024
+
+struct Waiter
+{
+  UriId f_uri;
+  uint64_t id;
+  std::chrono::steady_clock::time_point deadline;
+
+  // Gets the chunks of the response as they arrive
+  bool streaming;
+};
+
+struct PendingResponse
+{
+  // Foreign URIs waiting for the response
+  std::vector<Waiter> waiting;
+
+  // Last time the request was sent upstream
+  std::chrono::steady_clock::time_point forwarded;
+
+  // Chunks of a chunked response, put back in order
+  std::vector<Buffer> chunks;
+  std::map<size_t, Buffer> early;   // Arrived ahead of their turn
+  size_t last = -1;                 // -1 until the last chunk arrives
+  std::string type;
+  bool streamable = false;
+};
+
+struct ExpiryTimer
+{
+  UriId o_uri;
+  uint64_t id;
+};
+
 class Core
 {
 private:
@@ -37,32 +96,82 @@ private:
   PluginManager pm;
   ThreadPool& _tp;
 
-  std::map<Uri, Uri> _mappings;
-  mutable std::shared_timed_mutex _mappings_mutex;
+  UriTable& _uris;
+  MappingTable _mappings;
 
-  std::map<Uri, std::vector<Uri>> _waiting_for_response;
-  mutable std::shared_timed_mutex _waiting_for_response_mutex;
+  // Original URI -> Foreign URIs waiting for its response
+  ConcurrentHashMap<UriId, PendingResponse> _waiting_for_response;
 
-  ConcurrentBlockingQueue<const MetaMessage*> _queue;
+  std::atomic<uint64_t> _next_waiter_id;
+  long _request_timeout;
+  TimerWheel<ExpiryTimer> _timers;
+  std::thread _timer_thread;
 
-public:
-  Core(ThreadPool& tp)
-    : isRunning(false),
-      _tp(tp)
-  { }
+  // Metrics are written to stderr every interval (in seconds, 0 for never)
+  // and whenever asked to
+  std::atomic<long> _metrics_interval;
+  std::atomic<bool> _metrics_requested;
+
+  ContentCache _cache;
+  long _cache_ttl;
+
+  ConcurrentBlockingQueue<MetaMessagePtr> _queue;
+
+  // Messages taken from the queue but not yet processed. At most the high
+  // watermark of the queue is in flight, so that the excess stays in the
+  // queue and the protocols see the Core as overloaded
+  std::atomic<size_t> _in_flight;
+  std::mutex _in_flight_mutex;
+  std::condition_variable _in_flight_cond;
 
-  ~Core()
-  { }
+  std::atomic<uint64_t>& _requests;
+  std::atomic<uint64_t>& _upstream_requests;
+  std::atomic<uint64_t>& _expired_requests;
+
+public:
+  Core(ThreadPool& tp,
+       const size_t cacheSize = DEFAULT_CACHE_SIZE,
+       const long cacheTtl = DEFAULT_CACHE_TTL,
+       const long requestTimeout = DEFAULT_REQUEST_TIMEOUT);
+  ~Core();
 
   void start();
   void stop();
 
-  void loadProtocol(const std::string path);
+  void setQueueWatermarks(const size_t high, const size_t low);
+  void setMetricsInterval(const long seconds);
+  void setProtocolOptions(const std::map<std::string, std::string>& options);
+
+  // Returns false if the plugin was not loaded or not started
+  bool loadProtocol(const std::string path);
   void loadConverter(const std::string path);
   std::vector<Uri> createMapping(const Uri o_uri);
 
+  // Writes the metrics to stderr within a tick of the timers. Safe to call
+  // from a signal handler
+  void dumpMetrics();
+
 private:
-  void processMessage(const MetaMessage* msg);
+  void processMessage(MetaMessagePtr msg);
+  void processRequest(const MetaMessage* msg, const Uri o_uri);
+  void processResponse(const MetaMessage* msg);
+  void processChunk(const MetaMessage* msg);
+  void processFailure(const MetaMessage* msg);
+  void forwardMessage(const MetaMessage* msg, const std::vector<Uri>& out_uris,
+                      const uint64_t version = 0);
+  Buffer convertContent(const MetaMessage* msg,
+                        std::shared_ptr<PluginConverter> converter,
+                        const std::string scheme);
+
+  void waitForProcessingSlot();
+  void releaseProcessingSlot();
+
+  std::vector<Uri> toUris(std::vector<UriId>& ids) const;
+
+  void runTimers();
+  void expireRequests(const std::chrono::steady_clock::time_point now);
+  void writeMetrics();
+  void sendFailure(const Uri f_uri);
 };
 
 #endif /* CORE__HPP_ */
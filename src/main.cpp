@@ -24,6 +24,7 @@
 #include <dirent.h>
 #include <iostream>
 #include <fstream>
+#include <map>
 #include <signal.h>
 
 #define USAGE "Usage: fixp [OPTIONS] -r <resource file> " \
@@ -37,20 +38,30 @@ void signalHandler(int signum)
     core->stop();
 }
 
-void loadProtocols(Core& core, const std::string path)
+void metricsHandler(int)
+{
+  core->dumpMetrics();
+}
+
+// Returns false if some plugin could not be started
+bool loadProtocols(Core& core, const std::string path)
 {
   DIR *dir = opendir(path.c_str());
   if(dir == NULL) {
     FIFU_LOG_WARN("(Main) Error while opening protocol plugins folder");
-    return;
+    return true;
   }
 
+  bool ret = true;
   struct dirent* dirEntry;
   while(dirEntry = readdir(dir)) {
     if(dirEntry->d_type == DT_REG) {
-      core.loadProtocol(path + "/" + dirEntry->d_name);
+      ret = core.loadProtocol(path + "/" + dirEntry->d_name) && ret;
     }
   }
+
+  closedir(dir);
+  return ret;
 }
 
 void loadConverters(Core& core, const std::string path)
@@ -67,6 +78,8 @@ void loadConverters(Core& core, const std::string path)
       core.loadConverter(path + "/" + dirEntry->d_name);
     }
   }
+
+  closedir(dir);
 }
 
 void loadLogger(const unsigned short level)
@@ -104,6 +117,13 @@ struct Options
   const char* path_to_converters;
   int numWorkers;
   unsigned short verbosity;
+  size_t cacheSize;
+  long cacheTtl;
+  long requestTimeout;
+  size_t queueHigh;
+  size_t queueLow;
+  long metricsInterval;
+  std::map<std::string, std::string> protocolOptions;
   bool usage;
 };
 
@@ -118,6 +138,22 @@ struct argp_option program_options[] = {
        "Number of conversions that can be handled simultaneously", 0},
     {"verbose",    'v', "VALUE", 0,
        "Produce verbose output",                                   0},
+    {"cache-size", 's', "BYTES", 0,
+       "Maximum size of the content cache (0 disables it)",        0},
+    {"cache-ttl",  't', "SECONDS", 0,
+       "Caching time of contents without freshness information",   0},
+    {"timeout",    'T', "SECONDS", 0,
+       "Time a request waits for the response of the original network", 0},
+    {"queue-high", 'H', "VALUE", 0,
+       "Queue depth at which new requests start being rejected",   0},
+    {"queue-low",  'L', "VALUE", 0,
+       "Queue depth at which new requests are accepted again",     0},
+    {"metrics",    'm', "SECONDS", 0,
+       "Period of the dump of the metrics to stderr (0 disables it). "
+       "SIGUSR1 dumps them at any time",                            0},
+    {"option",     'o', "KEY=VALUE", 0,
+       "Option of a protocol plugin, as <scheme>.<key>=<value> "
+       "(e.g., http.port=8080). May be given several times",       0},
     {"usage",      -1,  "",      OPTION_HIDDEN | OPTION_ARG_OPTIONAL,
        "Print an usage example message", 0},
     {0}
@@ -143,6 +179,39 @@ error_t parse_opt(int key, char* arg, struct argp_state *state)
       options->path_to_resources = arg;
     } break;
 
+    case 's': {
+      options->cacheSize = strtoull(arg, NULL, 10);
+    } break;
+
+    case 't': {
+      options->cacheTtl = atol(arg);
+    } break;
+
+    case 'T': {
+      options->requestTimeout = atol(arg);
+    } break;
+
+    case 'H': {
+      options->queueHigh = strtoull(arg, NULL, 10);
+    } break;
+
+    case 'L': {
+      options->queueLow = strtoull(arg, NULL, 10);
+    } break;
+
+    case 'm': {
+      options->metricsInterval = atol(arg);
+    } break;
+
+    case 'o': {
+      std::string option(arg);
+      size_t pos = option.find('=');
+      if(pos == std::string::npos || pos == 0) {
+        argp_error(state, "invalid plugin option '%s' (expected KEY=VALUE)", arg);
+      }
+      options->protocolOptions[option.substr(0, pos)] = option.substr(pos + 1);
+    } break;
+
     case 'v': {
       options->verbosity = atoi(arg);
     } break;
@@ -163,7 +232,12 @@ int parseCmdOptions(int& argc, char**& argv,
                     const char*& path_to_resources,
                     const char*& path_to_protocols,
                     const char*& path_to_converters,
-                    int& numWorkers, unsigned short& verbosity)
+                    int& numWorkers, unsigned short& verbosity,
+                    size_t& cacheSize, long& cacheTtl,
+                    long& requestTimeout,
+                    size_t& queueHigh, size_t& queueLow,
+                    long& metricsInterval,
+                    std::map<std::string, std::string>& protocolOptions)
 {
   struct Options options;
 
@@ -173,6 +247,12 @@ int parseCmdOptions(int& argc, char**& argv,
   options.path_to_converters = NULL;
   options.numWorkers = -1;
   options.verbosity = 3;
+  options.cacheSize = DEFAULT_CACHE_SIZE;
+  options.cacheTtl = DEFAULT_CACHE_TTL;
+  options.requestTimeout = DEFAULT_REQUEST_TIMEOUT;
+  options.queueHigh = DEFAULT_QUEUE_HIGH_WATERMARK;
+  options.queueLow = DEFAULT_QUEUE_LOW_WATERMARK;
+  options.metricsInterval = 0;
   options.usage = false;
 
   struct argp argp = { program_options, parse_opt, "", "OPTION:" };
@@ -211,6 +291,14 @@ int parseCmdOptions(int& argc, char**& argv,
 
   verbosity = options.verbosity;
 
+  cacheSize = options.cacheSize;
+  cacheTtl = options.cacheTtl;
+  requestTimeout = options.requestTimeout;
+  queueHigh = options.queueHigh;
+  queueLow = options.queueLow;
+  metricsInterval = options.metricsInterval;
+  protocolOptions = options.protocolOptions;
+
   return 0;
 }
 
@@ -223,10 +311,20 @@ int main(int argc, char* argv[])
   const char* path_to_converters;
   int numWorkers;
   unsigned short verbosity;
+  size_t cacheSize;
+  long cacheTtl;
+  long requestTimeout;
+  size_t queueHigh;
+  size_t queueLow;
+  long metricsInterval;
+  std::map<std::string, std::string> protocolOptions;
 
   int ret = parseCmdOptions(argc, argv,
                             path_to_resources, path_to_protocols,
-                            path_to_converters, numWorkers, verbosity);
+                            path_to_converters, numWorkers, verbosity,
+                            cacheSize, cacheTtl, requestTimeout,
+                            queueHigh, queueLow, metricsInterval,
+                            protocolOptions);
 
   if(ret != 0) {
     return ret;
@@ -235,10 +333,20 @@ int main(int argc, char* argv[])
   loadLogger(verbosity);
 
   ThreadPool tp(numWorkers);
-  core = new Core(tp);
-
-  // Load plugins
-  loadProtocols(*core, path_to_protocols);
+  core = new Core(tp, cacheSize, cacheTtl, requestTimeout);
+  core->setQueueWatermarks(queueHigh, queueLow);
+  core->setMetricsInterval(metricsInterval);
+  signal(SIGUSR1, metricsHandler);
+  core->setProtocolOptions(protocolOptions);
+
+  // Load plugins, giving up if any of them is misconfigured
+  if(!loadProtocols(*core, path_to_protocols)) {
+    std::cout << "Invalid plugin options ( -o, --option=KEY=VALUE )"
+              << std::endl << std::flush;
+    core->stop();
+    delete core;
+    return -1;
+  }
   loadConverters(*core, path_to_converters);
 
   // Load known resource and create mappings on each architecture
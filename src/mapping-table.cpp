@@ -0,0 +1,215 @@
+/** Brief: Bidirectional mapping table between foreign and original URIs
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mapping-table.hpp"
+
+bool MappingTable::insert(const Uri& f_uri, const Uri& o_uri)
+{
+  UriId f_id = _uris.intern(f_uri);
+  UriId o_id = _uris.intern(o_uri);
+  if(f_id == INVALID_URI_ID || o_id == INVALID_URI_ID) {
+    return false;
+  }
+
+  ReverseShard& shard = getReverseShard(o_id);
+  std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+  UriId first = getFirst(shard, o_id);
+  bool chain = findScheme(getChain(first), f_uri.getSchema()) == INVALID_URI_ID;
+
+  // A foreign URI always identifies a single original URI
+  if(!insertLink(f_id, {o_id, chain ? first : INVALID_URI_ID})) {
+    return false;
+  }
+
+  if(chain) {
+    if(getIndex(o_id) >= shard.first.size()) {
+      shard.first.resize(getIndex(o_id) + 1, INVALID_URI_ID);
+    }
+    shard.first[getIndex(o_id)] = f_id;
+  }
+  return true;
+}
+
+bool MappingTable::getOriginal(const Uri& f_uri, Uri& o_uri) const
+{
+  UriId f_id = _uris.find(f_uri);
+  if(f_id == INVALID_URI_ID) {
+    return false;
+  }
+
+  UriId o_id = getLink(f_id).original;
+  if(o_id == INVALID_URI_ID) {
+    return false;
+  }
+
+  o_uri = _uris.get(o_id);
+  return true;
+}
+
+std::map<std::string, Uri> MappingTable::getForeign(const Uri& o_uri) const
+{
+  std::vector<UriId> f_ids;
+  UriId o_id = _uris.find(o_uri);
+  if(o_id != INVALID_URI_ID) {
+    const ReverseShard& shard = getReverseShard(o_id);
+    std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+    f_ids = getChain(getFirst(shard, o_id));
+  }
+
+  return toSchemeMap(f_ids);
+}
+
+std::map<std::string, Uri>
+MappingTable::getOrInstallForeign(const Uri& o_uri,
+                                  const std::vector<std::string>& schemes,
+                                  std::function<Uri(const std::string&)> install)
+{
+  std::vector<UriId> ret;
+
+  UriId o_id = _uris.intern(o_uri);
+  if(o_id == INVALID_URI_ID) {
+    return std::map<std::string, Uri>();
+  }
+
+  ReverseShard& shard = getReverseShard(o_id);
+
+  // Most of the times all mappings for the given URI already exist
+  std::vector<std::string> missing;
+  {
+    std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+    ret = getChain(getFirst(shard, o_id));
+  }
+  for(auto& scheme : schemes) {
+    if(findScheme(ret, scheme) == INVALID_URI_ID) {
+      missing.push_back(scheme);
+    }
+  }
+  if(missing.empty()) {
+    return toSchemeMap(ret);
+  }
+
+  // Plugins may block (e.g., on the network) while installing, so no lock
+  // is held meanwhile
+  std::vector<UriId> installed;
+  for(auto& scheme : missing) {
+    UriId f_id = _uris.intern(install(scheme));
+    if(f_id != INVALID_URI_ID) {
+      installed.push_back(f_id);
+    }
+  }
+
+  // Concurrent calls may have installed the same mappings meanwhile, in
+  // which case the first ones inserted are kept. Foreign URIs installed
+  // that already belong to another original URI are left out.
+  std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+  UriId first = getFirst(shard, o_id);
+  ret = getChain(first);
+  for(auto f_id : installed) {
+    if(findScheme(ret, _uris.getSchema(f_id)) != INVALID_URI_ID) {
+      continue;
+    }
+
+    if(insertLink(f_id, {o_id, first})) {
+      first = f_id;
+      ret.push_back(f_id);
+    }
+  }
+
+  if(first != INVALID_URI_ID) {
+    if(getIndex(o_id) >= shard.first.size()) {
+      shard.first.resize(getIndex(o_id) + 1, INVALID_URI_ID);
+    }
+    shard.first[getIndex(o_id)] = first;
+  }
+
+  return toSchemeMap(ret);
+}
+
+size_t MappingTable::size() const
+{
+  return _size;
+}
+
+UriId MappingTable::getFirst(const ReverseShard& shard, const UriId o_id) const
+{
+  if(getIndex(o_id) >= shard.first.size()) {
+    return INVALID_URI_ID;
+  }
+
+  return shard.first[getIndex(o_id)];
+}
+
+std::vector<UriId> MappingTable::getChain(UriId f_id) const
+{
+  std::vector<UriId> ret;
+  for(; f_id != INVALID_URI_ID; f_id = getLink(f_id).next) {
+    ret.push_back(f_id);
+  }
+
+  return ret;
+}
+
+MappingTable::Link MappingTable::getLink(const UriId f_id) const
+{
+  const ForwardShard& shard = _forward[f_id & (URI_TABLE_SHARDS - 1)];
+  std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+  if(getIndex(f_id) >= shard.links.size()) {
+    return {INVALID_URI_ID, INVALID_URI_ID};
+  }
+
+  return shard.links[getIndex(f_id)];
+}
+
+bool MappingTable::insertLink(const UriId f_id, const Link& link)
+{
+  ForwardShard& shard = _forward[f_id & (URI_TABLE_SHARDS - 1)];
+  std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+  if(getIndex(f_id) >= shard.links.size()) {
+    shard.links.resize(getIndex(f_id) + 1, {INVALID_URI_ID, INVALID_URI_ID});
+  } else if(shard.links[getIndex(f_id)].original != INVALID_URI_ID) {
+    return false;
+  }
+
+  shard.links[getIndex(f_id)] = link;
+  ++_size;
+  return true;
+}
+
+std::map<std::string, Uri> MappingTable::toSchemeMap(const std::vector<UriId>& f_ids) const
+{
+  std::map<std::string, Uri> ret;
+  for(auto f_id : f_ids) {
+    Uri f_uri = _uris.get(f_id);
+    ret.emplace(f_uri.getSchema(), f_uri);
+  }
+
+  return ret;
+}
+
+UriId MappingTable::findScheme(const std::vector<UriId>& f_ids, const std::string& scheme) const
+{
+  for(auto f_id : f_ids) {
+    if(_uris.getSchema(f_id) == scheme) {
+      return f_id;
+    }
+  }
+
+  return INVALID_URI_ID;
+}
@@ -0,0 +1,125 @@
+/** Brief: Bidirectional mapping table between foreign and original URIs
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MAPPING_TABLE__HPP_
+#define MAPPING_TABLE__HPP_
+
+#include "uri.hpp"
+#include "uri-table.hpp"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+// Both indexes are arrays indexed by the position of the identifiers in
+// their shard of the URI table (see UriTable), so each interned URI costs a
+// few bytes to them, whether it is mapped or not. The foreign URIs of an
+// original URI are chained through their forward entries.
+//
+// The reverse shard of an original URI is always locked before the forward
+// shards of its foreign URIs, never the other way around.
+class MappingTable
+{
+private:
+  struct Link
+  {
+    UriId original;    // Original URI of the foreign URI
+    UriId next;        // Next foreign URI of the same original URI
+  };
+
+  struct ForwardShard
+  {
+    mutable std::shared_timed_mutex mutex;
+    std::vector<Link> links;
+  };
+
+  struct ReverseShard
+  {
+    mutable std::shared_timed_mutex mutex;
+    std::vector<UriId> first;
+  };
+
+  UriTable& _uris;
+
+  // Foreign URI -> Original URI
+  std::array<ForwardShard, URI_TABLE_SHARDS> _forward;
+
+  // Original URI -> First of its foreign URIs (one per scheme)
+  std::array<ReverseShard, URI_TABLE_SHARDS> _reverse;
+
+  std::atomic<size_t> _size;
+
+public:
+  MappingTable()
+    : _uris(UriTable::getInstance())
+    , _size(0)
+  { }
+
+  ~MappingTable()
+  { }
+
+  bool insert(const Uri& f_uri, const Uri& o_uri);
+
+  bool getOriginal(const Uri& f_uri, Uri& o_uri) const;
+  std::map<std::string, Uri> getForeign(const Uri& o_uri) const;
+
+  // Get the foreign URIs of the original URI for the given schemes, calling
+  // install() to create the ones that are still missing. install() is
+  // called without holding any lock, so concurrent calls for the same
+  // original URI may install the same mapping more than once, but only the
+  // first one inserted is kept.
+  std::map<std::string, Uri> getOrInstallForeign(const Uri& o_uri,
+                                                 const std::vector<std::string>& schemes,
+                                                 std::function<Uri(const std::string&)> install);
+
+  size_t size() const;
+
+private:
+  static size_t getIndex(const UriId id)
+  {
+    return id / URI_TABLE_SHARDS - 1;
+  }
+
+  ReverseShard& getReverseShard(const UriId o_id)
+  {
+    return _reverse[o_id & (URI_TABLE_SHARDS - 1)];
+  }
+
+  const ReverseShard& getReverseShard(const UriId o_id) const
+  {
+    return _reverse[o_id & (URI_TABLE_SHARDS - 1)];
+  }
+
+  // Both must be called with the reverse shard of the original URI locked
+  UriId getFirst(const ReverseShard& shard, const UriId o_id) const;
+  std::vector<UriId> getChain(UriId f_id) const;
+
+  Link getLink(const UriId f_id) const;
+
+  // Sets the link of the foreign URI, unless it already has one
+  bool insertLink(const UriId f_id, const Link& link);
+
+  std::map<std::string, Uri> toSchemeMap(const std::vector<UriId>& f_ids) const;
+  UriId findScheme(const std::vector<UriId>& f_ids, const std::string& scheme) const;
+};
+
+#endif /* MAPPING_TABLE__HPP_ */
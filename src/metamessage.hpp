@@ -18,36 +18,65 @@
 #ifndef META_MESSAGE__HPP_
 #define META_MESSAGE__HPP_
 
+#include "buffer.hpp"
+#include "object-pool.hpp"
 #include "utils.hpp"
 #include "uri.hpp"
 
+#include <chrono>
+#include <cstdint>
 #include <map>
 #include <string>
-#include <vector>
 
 enum MetadataMessageType {
   MESSAGE_TYPE_UNKNOWN    = -1,
   MESSAGE_TYPE_REQUEST    =  0,
   MESSAGE_TYPE_RESPONSE   =  1,
-  MESSAGE_TYPE_INDICATION =  2
+  MESSAGE_TYPE_INDICATION =  2,
+  MESSAGE_TYPE_FAILURE    =  3
 };
 
 class Content {
 public:
   Content() { };
-  Content(const std::string type, const std::string data)
+  Content(const std::string type, const Buffer data)
     : _type(type), _data(data)
   { };
 
   std::string _type;
-  std::string _data;
+  Buffer _data;
+};
+
+// Well-known metadata is kept in typed fields. Any other key goes to the
+// extensions map.
+class Metadata {
+public:
+  Metadata()
+    : messageType(MESSAGE_TYPE_UNKNOWN),
+      keepSession(false),
+      chunkNumber(-1),
+      contentLength(-1),
+      deadline(std::chrono::steady_clock::time_point::max()),
+      traceId(0),
+      freshness(-1)
+  { };
+
+  MetadataMessageType messageType;
+  bool keepSession;
+  size_t chunkNumber;                              // -1 if not chunked
+  size_t contentLength;                            // -1 if unknown
+  std::chrono::steady_clock::time_point deadline;  // max() if none
+  uint64_t traceId;                                // 0 if none
+  long freshness;                                  // -1 if unknown
+
+  std::map<std::string, std::string> extensions;
 };
 
 class MetaMessage
 {
 private:
   Uri _uri;
-  std::map<std::string, std::string> _metadata;
+  Metadata _metadata;
   Content _content;
 
 public:
@@ -55,9 +84,11 @@ public:
   { };
 
   MetaMessage(const std::string uri,
-              const std::string contentType, const std::string contentData)
+              const std::string contentType, const Buffer contentData)
     : _uri(uri), _content(contentType, contentData)
-  { }
+  {
+    _metadata.contentLength = contentData.size();
+  }
 
   MetaMessage(MetaMessage*& rhs)
   {
@@ -66,18 +97,19 @@ public:
     _content = rhs->_content;
   }
 
-  void setContent(const std::string type, const std::string data)
+  void setContent(const std::string type, const Buffer data)
   {
     _content._type = type;
     _content._data = data;
+    _metadata.contentLength = data.size();
   }
 
-  Uri getUri() const
+  const Uri& getUri() const
   {
     return _uri;
   }
 
-  std::string getUriString() const
+  const std::string& getUriString() const
   {
     return _uri.toString();
   }
@@ -97,90 +129,117 @@ public:
     _uri.setUri(uri);
   }
 
-  std::map<std::string, std::string> getMetadata() const
+  const Metadata& getMetadata() const
   {
     return _metadata;
   }
 
-  void setMetadata(const std::map<std::string, std::string> metadata)
+  void setMetadata(const Metadata& metadata)
   {
     _metadata = metadata;
   }
 
-  bool getKeepSession() const
+  bool getExtension(const std::string key, std::string& value) const
   {
-    std::string value;
-    try {
-      value = _metadata.at("KeepSession");
-    } catch(const std::out_of_range& e) {
+    auto it = _metadata.extensions.find(key);
+    if(it == _metadata.extensions.end()) {
       return false;
     }
 
-    if(value == "True") {
-      return true;
-    } else {
-      return false;
-    }
+    value = it->second;
+    return true;
+  }
+
+  void setExtension(const std::string key, const std::string value)
+  {
+    _metadata.extensions[key] = value;
+  }
+
+  bool getKeepSession() const
+  {
+    return _metadata.keepSession;
   }
 
   void setKeepSession(const bool val)
   {
-    if(val) {
-      _metadata.emplace("KeepSession", "True");
-    } else {
-      _metadata.emplace("KeepSession", "False");
-    }
+    _metadata.keepSession = val;
   }
 
   size_t getChunkNumber() const
   {
-    std::string value;
-    try {
-      value = _metadata.at("ChunkNumber");
-    } catch(const std::out_of_range& e) {
-      return -1;
-    }
-
-    return atoll(value.c_str());
+    return _metadata.chunkNumber;
   }
 
   void setChunkNumber(const size_t val)
   {
-    _metadata.emplace("ChunkNumber", std::to_string(val));
+    _metadata.chunkNumber = val;
   }
 
-  MetadataMessageType getMessageType() const
+  // Size (in bytes) of the whole content, which may be bigger than the
+  // content of this message if it is chunked. Returns -1 if unknown.
+  size_t getContentLength() const
   {
-    std::string messageType;
+    return _metadata.contentLength;
+  }
 
-    try {
-      messageType = _metadata.at("MessageType");
-    } catch(const std::out_of_range& e) {
-      return MESSAGE_TYPE_UNKNOWN;
-    }
+  void setContentLength(const size_t val)
+  {
+    _metadata.contentLength = val;
+  }
 
-    std::vector<std::string> typeStr = {"request", "response", "indication"};
-    for(int i = 0; i < typeStr.size(); ++i) {
-      if(messageType == typeStr[i]) {
-        return (MetadataMessageType) i;
-      }
-    }
+  // Freshness period (in seconds) of the content, as given by the source
+  // network. Returns -1 if unknown.
+  long getFreshness() const
+  {
+    return _metadata.freshness;
+  }
 
-    return MESSAGE_TYPE_UNKNOWN;
+  void setFreshness(const long val)
+  {
+    _metadata.freshness = val;
+  }
+
+  // Time until which the request will be waited for.
+  // Returns time_point::max() if the request has no deadline.
+  std::chrono::steady_clock::time_point getDeadline() const
+  {
+    return _metadata.deadline;
+  }
+
+  void setDeadline(const std::chrono::steady_clock::time_point val)
+  {
+    _metadata.deadline = val;
+  }
+
+  // Identifier shared by the messages of the same exchange, for logging.
+  // Returns 0 if none.
+  uint64_t getTraceId() const
+  {
+    return _metadata.traceId;
+  }
+
+  void setTraceId(const uint64_t val)
+  {
+    _metadata.traceId = val;
+  }
+
+  MetadataMessageType getMessageType() const
+  {
+    return _metadata.messageType;
   }
 
   void setMessageType(const MetadataMessageType type)
   {
     if(type == MESSAGE_TYPE_REQUEST
        || type == MESSAGE_TYPE_RESPONSE
-       || type == MESSAGE_TYPE_INDICATION) {
-      std::vector<std::string> typeStr = {"request", "response", "indication"};
-
-      _metadata.emplace("MessageType", typeStr[type]);
+       || type == MESSAGE_TYPE_INDICATION
+       || type == MESSAGE_TYPE_FAILURE) {
+      _metadata.messageType = type;
     }
   }
 
-  std::string getContentData() const
+  // Shares the content bytes, instead of copying them
+  const Buffer& getContentData() const
   {
     return _content._data;
   }
@@ -196,5 +255,14 @@ public:
   }
 };
 
-#endif /* META_MESSAGE__HPP_ */
+// Messages are taken from a pool and given back to it once their handle
+// is destroyed
+typedef ObjectPool<MetaMessage>::Ptr MetaMessagePtr;
 
+inline
+MetaMessagePtr createMetaMessage()
+{
+  return ObjectPool<MetaMessage>::acquire();
+}
+
+#endif /* META_MESSAGE__HPP_ */
@@ -18,6 +18,7 @@
 #ifndef PLUGIN_CONVERTER__HPP_
 #define PLUGIN_CONVERTER__HPP_
 
+#include "buffer.hpp"
 #include "metamessage.hpp"
 #include "uri.hpp"
 
@@ -31,8 +32,8 @@ public:
   ~PluginConverter() { };
 
   virtual std::vector<std::string> getFileTypes() const = 0;
-  virtual std::map<std::string, Uri> extractUrisFromContent(const Uri uri, const std::string content) = 0;
-  virtual std::string convertContent(const std::string content, const std::map<std::string, Uri>& mappings) = 0;
+  virtual std::map<std::string, Uri> extractUrisFromContent(const Uri uri, const Buffer& content) = 0;
+  virtual std::string convertContent(const Buffer& content, const std::map<std::string, Uri>& mappings) = 0;
 };
 
 #endif /* PLUGIN_CONVERTER__HPP_ */
@@ -18,6 +18,7 @@
 #include "plugin-manager.hpp"
 
 #include "logger.hpp"
+#include "metrics.hpp"
 #include "plugin-protocol-factory.hpp"
 #include "plugin-converter-factory.hpp"
 
@@ -33,31 +34,57 @@ void PluginManager::stop()
   }
 }
 
-void PluginManager::loadProtocol(const std::string path,
-                                 ConcurrentBlockingQueue<const MetaMessage*>& queue,
+void PluginManager::setProtocolOptions(const std::map<std::string, std::string>& options)
+{
+  _protocol_options = options;
+}
+
+bool PluginManager::loadProtocol(const std::string path,
+                                 ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                                  ThreadPool& tp)
 {
   struct stat fileStat;
   if(stat(path.c_str(), &fileStat) != 0) {
     FIFU_LOG_WARN("(PluginManager) '" + path +
                   "' not loaded (file not found)");
-    return;
+    return false;
   }
 
   if(S_ISREG(fileStat.st_mode) == 0) {
     FIFU_LOG_WARN("(PluginManager) '" + path +
                   "' not loaded (file is not a regular file)");
-    return;
+    return false;
   }
 
   // Create protocol plugin
   std::shared_ptr<PluginProtocol> protocol
          = PluginProtocolFactory::createPlugin(path, queue, tp);
+
+  std::map<std::string, std::string> options;
+  std::string prefix = protocol->getProtocol() + ".";
+  for(auto& item : _protocol_options) {
+    if(item.first.compare(0, prefix.size(), prefix) == 0) {
+      options.emplace(item.first.substr(prefix.size()), item.second);
+    }
+  }
+  if(!protocol->configure(options)) {
+    FIFU_LOG_ERROR("(PluginManager) " + protocol->getProtocol() +
+                   " protocol not started (invalid options)");
+    return false;
+  }
+
   _protocols.emplace(std::piecewise_construct,
                      std::forward_as_tuple(protocol->getProtocol()),
                      std::forward_as_tuple(protocol));
   protocol->start();
+
+  PluginProtocol* plugin = protocol.get();
+  Metrics::getInstance().setGauge(protocol->getProtocol() + ".queue_depth", [plugin]() {
+    return double(plugin->getQueueDepth());
+  });
   FIFU_LOG_INFO("(PluginManager) Loaded & Started " + protocol->getProtocol() + " protocol");
+
+  return true;
 }
 
 void PluginManager::loadConverter(const std::string path)
@@ -21,11 +21,13 @@
 #include "plugin-protocol.hpp"
 #include "plugin-converter.hpp"
 #include "concurrent-blocking-queue.hpp"
+#include "metrics.hpp"
 #include "uri.hpp"
 #include "thread-pool.hpp"
 
 #include <map>
 #include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -34,6 +36,7 @@ class PluginManager
 private:
   std::map<std::string, std::shared_ptr<PluginProtocol> > _protocols;
   std::map<std::string, std::shared_ptr<PluginConverter> > _converters;
+  std::map<std::string, std::string> _protocol_options;
 
 public:
   PluginManager()
@@ -43,6 +46,7 @@ public:
   {
     // Delete protocol plugins
     for(auto item : _protocols) {
+      Metrics::getInstance().removeGauge(item.first + ".queue_depth");
       item.second.reset();
     }
 
@@ -57,8 +61,11 @@ public:
   }
 
   void stop();
-  void loadProtocol(const std::string path,
-                    ConcurrentBlockingQueue<const MetaMessage*>& queue,
+  void setProtocolOptions(const std::map<std::string, std::string>& options);
+  // Returns false if the plugin was not loaded or not started (e.g., due to
+  // invalid options)
+  bool loadProtocol(const std::string path,
+                    ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                     ThreadPool& tp);
   void loadConverter(const std::string path);
 
@@ -27,13 +27,13 @@
 class PluginProtocolFactory {
 public:
   static const std::shared_ptr<PluginProtocol> createPlugin(const std::string path,
-                                                            ConcurrentBlockingQueue<const MetaMessage*>& queue,
+                                                            ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                                                             ThreadPool& tp)
   {
     void* handle = dlopen(path.c_str(), RTLD_LAZY);
-    PluginProtocol* (*create)(ConcurrentBlockingQueue<const MetaMessage*>&,
+    PluginProtocol* (*create)(ConcurrentBlockingQueue<MetaMessagePtr>&,
                               ThreadPool&)
-      = (PluginProtocol* (*)(ConcurrentBlockingQueue<const MetaMessage*>&,
+      = (PluginProtocol* (*)(ConcurrentBlockingQueue<MetaMessagePtr>&,
                              ThreadPool&)) dlsym(handle, "create_plugin_object");
     PluginProtocol* plugin = create(queue, tp);
 
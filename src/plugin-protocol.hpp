@@ -30,42 +30,79 @@
 class PluginProtocol
 {
 private:
-  ConcurrentBlockingQueue<const MetaMessage*>& _send_to_core;
+  ConcurrentBlockingQueue<MetaMessagePtr>& _send_to_core;
 
 protected:
   std::atomic<bool> isRunning;
-  ConcurrentBlockingQueue<const MetaMessage*> _msg_to_send;
+  ConcurrentBlockingQueue<MetaMessagePtr> _msg_to_send;
   ThreadPool& _tp;
 
 public:
-  PluginProtocol(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+  PluginProtocol(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                  ThreadPool& tp)
     : _send_to_core(queue),
       _tp(tp),
       isRunning(false)
-  { };
+  {
+    _msg_to_send.setWatermarks(queue.getHighWatermark(), queue.getLowWatermark());
+  };
 
   virtual ~PluginProtocol()
   { };
 
+  // Called before start() with the options given to this plugin. Options
+  // given as <scheme>.<key>=<value> reach the plugin as <key>=<value>.
+  // Returns false if some option is invalid, in which case the plugin is
+  // not started.
+  virtual bool configure(const std::map<std::string, std::string>&)
+  {
+    return true;
+  };
+
   virtual void start() = 0;
   virtual void stop() = 0;
 
   virtual std::string getProtocol() const = 0;
   virtual std::string installMapping(const std::string uri) = 0;
 
-  void receivedMessage(const MetaMessage* msg)
+  // Whether chunked responses may be sent to this plugin chunk by chunk,
+  // as they arrive, instead of only once the whole content is in
+  virtual bool supportsStreaming() const
+  {
+    return false;
+  }
+
+  void receivedMessage(MetaMessagePtr msg)
+  {
+    _send_to_core.push(std::move(msg));
+  }
+
+  // Never blocks: returns false, keeping the message, if the queue to the
+  // Core is full
+  bool tryReceivedMessage(MetaMessagePtr& msg)
+  {
+    return _send_to_core.try_push(std::move(msg));
+  }
+
+  void sendMessage(MetaMessagePtr msg)
+  {
+    _msg_to_send.push(std::move(msg));
+  }
+
+  // New requests should not be admitted while the Core or this plugin
+  // are lagging behind
+  bool isOverloaded() const
   {
-    _send_to_core.push(msg);
+    return _send_to_core.isOverloaded() || _msg_to_send.isOverloaded();
   }
 
-  void sendMessage(const MetaMessage* msg)
+  size_t getQueueDepth() const
   {
-    _msg_to_send.push(msg);
+    return _msg_to_send.size();
   }
 
 protected:
-  virtual void processMessage(const MetaMessage* msg) = 0;
+  virtual void processMessage(MetaMessagePtr msg) = 0;
 };
 
 #endif /* PLUGIN_PROTOCOL__HPP_ */
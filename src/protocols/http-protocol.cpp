@@ -18,11 +18,15 @@
 #include "http-protocol.hpp"
 #include "logger.hpp"
 
-#include <curl/curl.h>
-#include <curl/multi.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <vector>
 
-extern "C" HttpProtocol* create_plugin_object(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+extern "C" HttpProtocol* create_plugin_object(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                                               ThreadPool& tp)
 {
   return new HttpProtocol(queue, tp);
@@ -34,115 +38,245 @@ extern "C" void destroy_object(HttpProtocol* object)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-std::string createForeignUri(std::string o_uri)
+std::string createForeignUri(std::string o_uri, const std::string& hostname,
+                             const unsigned short port)
 {
   Uri uri(o_uri);
 
+  // IPv6 addresses go between brackets
+  std::string host = hostname.find(':') != std::string::npos ? "[" + hostname + "]"
+                                                              : hostname;
+
   return std::string(SCHEMA) + ":"
-          + "//" + DEFAULT_HOSTNAME
-          + (HTTPD_PORT == 80 ? "" : ":" + std::to_string(HTTPD_PORT)) + "/"
+          + "//" + host
+          + (port == 80 ? "" : ":" + std::to_string(port)) + "/"
           + (uri.getAuthority().size() != 0 ? "/" + uri.getAuthority() : "")
           + uri.getPath()
           + (uri.getQuery().size() != 0 ? "?" + uri.getQuery() : "")
           + (uri.getFragment().size() != 0 ? "#" + uri.getFragment() : "");
 }
-///////////////////////////////////////////////////////////////////////////////
 
-size_t getHttpContent(const void *content, const size_t size, const size_t nmemb, std::string *data)
+bool parseOption(const std::string& value, const unsigned long max, unsigned long& ret)
 {
-  size_t content_size = size * nmemb;
+  char* end;
+  errno = 0;
+  ret = strtoul(value.c_str(), &end, 10);
 
-  std::string tmp((const char*) content, content_size);
-  data->append(tmp);
-
-  return content_size;
-}
-
-bool requestHttpUri(const std::string uri, std::string& type, std::string& content)
-{
-  FIFU_LOG_INFO("(HTTP Protocol) Requesting " + uri);
-
-  CURL *curl;
-  CURLcode res;
-
-  curl = curl_easy_init();
-  if(!curl) {
-    return false;
-  }
-
-  curl_easy_setopt(curl, CURLOPT_URL, uri.c_str());
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, getHttpContent);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &content);
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L); // 30 seconds
-
-  res = curl_easy_perform(curl);
-  if(res != CURLE_OK) {
-    FIFU_LOG_INFO("(HTTP Protocol) Unable to get " + uri
-                  + "[Error " + curl_easy_strerror(res) + "]");
-    return false;
-  }
-
-  char* t;
-  res = curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &t);
-  if(res != CURLE_OK || !t) {
-    FIFU_LOG_WARN("(HTTP Protocol) Unable to get content type for " + uri
-                  + "[Error " + curl_easy_strerror(res) + "]");
-  } else {
-    type = t;
-    type = type.substr(0, type.find(";"));
-  }
-
-  curl_easy_cleanup(curl);
-  return true;
+  return !value.empty() && *end == '\0' && errno == 0 && ret <= max;
 }
 ///////////////////////////////////////////////////////////////////////////////
 
-HttpProtocol::HttpProtocol(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+HttpProtocol::HttpProtocol(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                            ThreadPool& tp)
-    : PluginProtocol(queue, tp)
+    : PluginProtocol(queue, tp),
+      daemon(NULL),
+      _address(DEFAULT_HOSTNAME),
+      _port(DEFAULT_HTTPD_PORT),
+      _polling(DEFAULT_HTTPD_POLLING),
+      _threads(DEFAULT_HTTPD_THREADS),
+      _connection_limit(0),
+      _per_ip_limit(0),
+      _reuse_port(false),
+      _timeout(DEFAULT_HTTPD_TIMEOUT)
 { }
 
 HttpProtocol::~HttpProtocol()
 { }
 
+bool HttpProtocol::configure(const std::map<std::string, std::string>& options)
+{
+  bool ret = true;
+  for(auto& option : options) {
+    const std::string& key = option.first;
+    const std::string& value = option.second;
+
+    unsigned long number;
+    bool valid = true;
+    if(key == "address") {
+      _address = value;
+    } else if(key == "hostname") {
+      _hostname = value;
+    } else if(key == "port") {
+      if((valid = parseOption(value, UINT16_MAX, number))) {
+        _port = number;
+      }
+    } else if(key == "polling") {
+      if((valid = (value == "epoll" || value == "poll" || value == "select"))) {
+        _polling = value;
+      }
+    } else if(key == "threads") {
+      if((valid = parseOption(value, UINT16_MAX, number) && number > 0)) {
+        _threads = number;
+      }
+    } else if(key == "connection-limit") {
+      if((valid = parseOption(value, UINT32_MAX, number))) {
+        _connection_limit = number;
+      }
+    } else if(key == "per-ip-limit") {
+      if((valid = parseOption(value, UINT32_MAX, number))) {
+        _per_ip_limit = number;
+      }
+    } else if(key == "reuse-port") {
+      if((valid = (value == "0" || value == "1"))) {
+        _reuse_port = value == "1";
+      }
+    } else if(key == "timeout") {
+      if((valid = parseOption(value, UINT32_MAX, number) && number > 0)) {
+        _timeout = number;
+      }
+    } else {
+      FIFU_LOG_WARN("(HTTP Protocol) Unknown option '" + key + "'");
+      continue;
+    }
+
+    if(!valid) {
+      FIFU_LOG_ERROR("(HTTP Protocol) Invalid value '" + value + "' of option '" + key + "'");
+      ret = false;
+    }
+  }
+
+  return ret;
+}
+
 void HttpProtocol::stop()
 {
   isRunning = false;
 
-  MHD_stop_daemon(daemon);
-  _msg_to_send.stop();
-
+  // The receiver is done once the server is started (or failed to)
   _msg_receiver.join();
+
+  // No new connections from now on, while the ones open are still served
+  MHD_socket listener = MHD_INVALID_SOCKET;
+  if(daemon != NULL) {
+    listener = MHD_quiesce_daemon(daemon);
+  }
+
+  // No new requests or responses either
+  _msg_to_send.stop();
+  _client.stop();
   _msg_sender.join();
+  _expirer.join();
+
+  // Suspended connections must be resumed before stopping the server
+  replyWithStatus(_pending.takeAll(), MHD_HTTP_SERVICE_UNAVAILABLE);
+  {
+    std::lock_guard<std::mutex> lock(_streams_mutex);
+    for(auto& item : _streams) {
+      for(auto& stream : item.second) {
+        stream->fail();
+      }
+    }
+    _streams.clear();
+  }
+
+  if(daemon != NULL) {
+    MHD_stop_daemon(daemon);
+  }
+
+  // Once quiesced, closing the listening socket is up to us
+  if(listener != MHD_INVALID_SOCKET) {
+    close(listener);
+  }
 }
 
 void HttpProtocol::start()
 {
   isRunning = true;
 
+  _client.start();
   _msg_receiver = std::thread(&HttpProtocol::startReceiver, this);
   _msg_sender = std::thread(&HttpProtocol::startSender, this);
+  _expirer = std::thread(&HttpProtocol::expireConnections, this);
 }
 
 std::string HttpProtocol::installMapping(const std::string uri)
 {
-  return createForeignUri(uri);
+  // Wildcard addresses are no use to clients
+  std::string hostname = _hostname;
+  if(hostname.empty()) {
+    hostname = (_address == "0.0.0.0" || _address == "::") ? DEFAULT_HOSTNAME : _address;
+  }
+
+  return createForeignUri(uri, hostname, _port);
 }
 
 void HttpProtocol::startReceiver()
 {
-  daemon = MHD_start_daemon(MHD_USE_SELECT_INTERNALLY | MHD_USE_POLL | MHD_USE_SUSPEND_RESUME,
-                            HTTPD_PORT, NULL, NULL,
-                            &HttpProtocol::static_answer_to_connection, this, MHD_OPTION_END);
+  unsigned int flags = MHD_USE_SELECT_INTERNALLY | MHD_USE_SUSPEND_RESUME;
+
+  // Needed to quiesce the server when stopping
+#if MHD_VERSION >= 0x00095300
+  flags |= MHD_USE_ITC;
+#else
+  flags |= MHD_USE_PIPE_FOR_SHUTDOWN;
+#endif
+  if(_polling == "epoll") {
+    flags |= MHD_USE_EPOLL_LINUX_ONLY;
+  } else if(_polling == "poll") {
+    flags |= MHD_USE_POLL;
+  }
+
+  struct sockaddr_in addr4;
+  struct sockaddr_in6 addr6;
+  struct sockaddr* addr;
+  memset(&addr4, 0, sizeof(addr4));
+  memset(&addr6, 0, sizeof(addr6));
+  if(_address.find(':') != std::string::npos) {
+    addr6.sin6_family = AF_INET6;
+    addr6.sin6_port = htons(_port);
+    addr = (struct sockaddr*) &addr6;
+    flags |= MHD_USE_IPv6;
+  } else {
+    addr4.sin_family = AF_INET;
+    addr4.sin_port = htons(_port);
+    addr = (struct sockaddr*) &addr4;
+  }
+
+  if(inet_pton(addr->sa_family, _address.c_str(),
+               addr->sa_family == AF_INET6 ? (void*) &addr6.sin6_addr : (void*) &addr4.sin_addr) != 1) {
+    FIFU_LOG_ERROR("(HTTP Protocol) Invalid listening address '" + _address + "'");
+    return;
+  }
+
+  // The default of libmicrohttpd suits select, which cannot go beyond
+  // FD_SETSIZE
+  unsigned int connection_limit = _connection_limit;
+  if(connection_limit == 0 && _polling != "select") {
+    connection_limit = DEFAULT_HTTPD_CONNECTION_LIMIT;
+  }
+
+  std::vector<struct MHD_OptionItem> options;
+  options.push_back({MHD_OPTION_SOCK_ADDR, 0, addr});
+  if(_threads > 1) {
+    options.push_back({MHD_OPTION_THREAD_POOL_SIZE, _threads, NULL});
+  }
+  if(connection_limit > 0) {
+    options.push_back({MHD_OPTION_CONNECTION_LIMIT, connection_limit, NULL});
+  }
+  if(_per_ip_limit > 0) {
+    options.push_back({MHD_OPTION_PER_IP_CONNECTION_LIMIT, _per_ip_limit, NULL});
+  }
+  if(_reuse_port) {
+    // Several listeners (e.g., processes) may share the port (SO_REUSEPORT)
+    options.push_back({MHD_OPTION_LISTENING_ADDRESS_REUSE, 1, NULL});
+  }
+  options.push_back({MHD_OPTION_END, 0, NULL});
+
+  daemon = MHD_start_daemon(flags, _port, NULL, NULL,
+                            &HttpProtocol::static_answer_to_connection, this,
+                            MHD_OPTION_ARRAY, options.data(), MHD_OPTION_END);
   if(daemon == NULL) {
     FIFU_LOG_ERROR("Unable to start HTTP server capabilities");
     return;
   }
+
+  FIFU_LOG_INFO("(HTTP Protocol) Listening on " + _address + " port " + std::to_string(_port)
+                + " (" + _polling + ", " + std::to_string(_threads) + " threads)");
 }
 
 void HttpProtocol::startSender()
 {
-  const MetaMessage* out;
+  MetaMessagePtr out;
   while(isRunning) {
     try {
       out = _msg_to_send.pop();
@@ -152,44 +286,75 @@ void HttpProtocol::startSender()
 
     // Schedule message processing
     FIFU_LOG_INFO("(HTTP Protocol) Scheduling next message (" + out->getUriString() + ") processing");
-    std::function<void()> func(std::bind(&HttpProtocol::processMessage, this, out));
-    _tp.schedule(std::move(func));
+    _tp.schedule([this, out = std::move(out)]() mutable { processMessage(std::move(out)); });
   }
 }
 
-void HttpProtocol::processMessage(const MetaMessage* msg)
+void HttpProtocol::expireConnections()
+{
+  while(isRunning) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(HTTP_PENDING_TICK));
+
+    auto expired = _pending.expire(std::chrono::steady_clock::now());
+    if(!expired.empty()) {
+      FIFU_LOG_WARN("(HTTP Protocol) " + std::to_string(expired.size()) + " request(s) timed out. Replying with Gateway Timeout (504) error message...");
+      replyWithStatus(expired, MHD_HTTP_GATEWAY_TIMEOUT);
+    }
+  }
+}
+
+void HttpProtocol::processMessage(MetaMessagePtr msg)
 {
   FIFU_LOG_INFO("(HTTP Protocol) Processing message (" + msg->getUriString() + ")");
 
   if(msg->getMessageType() == MESSAGE_TYPE_REQUEST) {
     // Request content from the original network
-    std::string content;
-    std::string type;
-    if(!requestHttpUri(msg->getUriString(), type, content)) {
-      delete msg;
-      return;
+    // Do not wait longer than the requester is willing to
+    long timeout = DEFAULT_REQUEST_TIMEOUT_MS;
+    auto deadline = msg->getDeadline();
+    if(deadline != std::chrono::steady_clock::time_point::max()) {
+      timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  deadline - std::chrono::steady_clock::now()).count();
+      if(timeout <= 0) {
+        return;
+      }
     }
 
-    // Send received response to Core
-    MetaMessage* response = new MetaMessage();
-    response->setUri(msg->getUri());
-    response->setMessageType(MESSAGE_TYPE_RESPONSE);
-    response->setContent(type, content);
-
-    FIFU_LOG_INFO("(HTTP Protocol) Received response of " + msg->getUriString());
-    receivedMessage(response);
-  } else if(msg->getMessageType() == MESSAGE_TYPE_RESPONSE) {
-    responseHttpUri(msg);
+    // The client thread reports back once the content arrives, so this
+    // thread is free to go on with other messages
+    _client.get(msg->getUriString(), timeout, [this, uri = msg->getUri()](HttpResult& result) {
+      if(!result.ok) {
+        // Let the Core fail the requests waiting for this content
+        MetaMessagePtr failure = createMetaMessage();
+        failure->setUri(uri);
+        failure->setMessageType(MESSAGE_TYPE_FAILURE);
+        receivedMessage(std::move(failure));
+        return;
+      }
+
+      // Send received response to Core
+      MetaMessagePtr response = createMetaMessage();
+      response->setUri(uri);
+      response->setMessageType(MESSAGE_TYPE_RESPONSE);
+      response->setContent(result.type, std::move(result.content));
+      if(result.freshness >= 0) {
+        response->setFreshness(result.freshness);
+      }
+
+      FIFU_LOG_INFO("(HTTP Protocol) Received response of " + uri.toString());
+      receivedMessage(std::move(response));
+    });
+  } else if(msg->getMessageType() == MESSAGE_TYPE_RESPONSE
+            || msg->getMessageType() == MESSAGE_TYPE_FAILURE) {
+    responseHttpUri(msg.get());
   }
-
-  delete msg;
 }
 
-int HttpProtocol::static_answer_to_connection(void *cls, struct MHD_Connection *connection,
-                                              const char *url,
-                                              const char *method, const char *version,
-                                              const char *upload_data,
-                                              size_t *upload_data_size, void **con_cls)
+MHD_Result HttpProtocol::static_answer_to_connection(void *cls, struct MHD_Connection *connection,
+                                                     const char *url,
+                                                     const char *method, const char *version,
+                                                     const char *upload_data,
+                                                     size_t *upload_data_size, void **con_cls)
 {
   static int dummy;
   if(strcmp(method, "GET") != 0) {
@@ -210,11 +375,11 @@ int HttpProtocol::static_answer_to_connection(void *cls, struct MHD_Connection *
   return instance->answer_to_connection(connection, url, method, version, upload_data, upload_data_size, con_cls);
 }
 
-int HttpProtocol::answer_to_connection(struct MHD_Connection *connection,
-                                       const char *url,
-                                       const char *method, const char *version,
-                                       const char *upload_data,
-                                       size_t *upload_data_size, void **con_cls)
+MHD_Result HttpProtocol::answer_to_connection(struct MHD_Connection *connection,
+                                              const char *url,
+                                              const char *method, const char *version,
+                                              const char *upload_data,
+                                              size_t *upload_data_size, void **con_cls)
 {
   const char* host = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Host");
   if(host == NULL) {
@@ -223,49 +388,166 @@ int HttpProtocol::answer_to_connection(struct MHD_Connection *connection,
     response = MHD_create_response_from_buffer(0, (void*) "",
                                                MHD_RESPMEM_PERSISTENT);
 
-    int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+    MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+    MHD_destroy_response(response);
     return ret;
   }
 
-  MetaMessage* in = new MetaMessage();
+  MetaMessagePtr in = createMetaMessage();
   in->setUri(std::string(SCHEMA) + ":" + "//" + host + url);
   in->setMessageType(MESSAGE_TYPE_REQUEST);
 
   FIFU_LOG_INFO("(HTTP Protocol) Received GET request to " + in->getUriString());
-  pendingConnections.emplace(in->getUri(), connection);
+
+  // Suspend first, as the response may arrive as soon as the connection is
+  // registered
   MHD_suspend_connection(connection);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(_timeout);
+  if(!_pending.add(in->getUri(), connection, deadline)) {
+    // Answered along with the connections already waiting for this URI,
+    // so it adds no load and is always admitted
+    return MHD_YES;
+  }
 
-  receivedMessage(in);
+  // The server thread must not block on a full queue
+  if(isOverloaded() || !tryReceivedMessage(in)) {
+    FIFU_LOG_WARN("(HTTP Protocol) Overloaded. Replying with Service Unavailable (503) error message...");
+    replyWithStatus(_pending.take(in->getUri()), MHD_HTTP_SERVICE_UNAVAILABLE);
+  }
 
   return MHD_YES;
 }
 
 void HttpProtocol::responseHttpUri(const MetaMessage* msg)
 {
-  // Get pending connection
-  auto it = pendingConnections.find(msg->getUri());
-  if(it == pendingConnections.end()) {
+  if(msg->getMessageType() == MESSAGE_TYPE_RESPONSE
+     && msg->getChunkNumber() != size_t(-1)) {
+    streamHttpUri(msg);
+    return;
+  }
+
+  if(msg->getMessageType() == MESSAGE_TYPE_FAILURE) {
+    // Responses already being sent can only be cut short
+    std::vector<std::shared_ptr<HttpStream>> streams;
+    {
+      std::lock_guard<std::mutex> lock(_streams_mutex);
+      auto it = _streams.find(msg->getUri());
+      if(it != _streams.end()) {
+        streams.swap(it->second);
+        _streams.erase(it);
+      }
+    }
+
+    if(!streams.empty()) {
+      FIFU_LOG_WARN("(HTTP Protocol) Request of " + msg->getUriString() + " failed. Cutting the response short...");
+      for(auto& stream : streams) {
+        stream->fail();
+      }
+    }
+  }
+
+  // Every connection waiting for this URI gets the same response
+  std::vector<struct MHD_Connection*> connections = _pending.take(msg->getUri());
+  if(connections.empty()) {
     return;
   }
 
-  if(it->second == NULL) {
+  if(msg->getMessageType() == MESSAGE_TYPE_FAILURE) {
+    FIFU_LOG_WARN("(HTTP Protocol) Request of " + msg->getUriString() + " failed. Replying with Gateway Timeout (504) error message...");
+    replyWithStatus(connections, MHD_HTTP_GATEWAY_TIMEOUT);
     return;
   }
-  struct MHD_Connection* connection = it->second;
-  pendingConnections.erase(it);
 
-  struct MHD_Response* response;
-  response = MHD_create_response_from_buffer(msg->getContentData().size(), (void*) msg->getContentData().c_str(), MHD_RESPMEM_MUST_COPY);
+  struct MHD_Response* response = _responses.create(msg->getContentData());
   MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_TYPE, msg->getContentType().c_str());
 
-  MHD_resume_connection(connection);
-  int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-  if(ret == MHD_YES) {
-    FIFU_LOG_INFO("(HTTP Protocol) Sending the response message of " + msg->getUriString());
-  } else {
-    FIFU_LOG_INFO("(HTTP Protocol) Failed to send response message of " + msg->getUriString());
+  // Queued while the connections are still suspended (see HttpPending)
+  for(auto connection : connections) {
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_resume_connection(connection);
+    if(ret == MHD_YES) {
+      FIFU_LOG_INFO("(HTTP Protocol) Sending the response message of " + msg->getUriString());
+    } else {
+      FIFU_LOG_INFO("(HTTP Protocol) Failed to send response message of " + msg->getUriString());
+    }
   }
 
+  // Freed once the last connection is done with it
   MHD_destroy_response(response);
 }
 
+void HttpProtocol::streamHttpUri(const MetaMessage* msg)
+{
+  std::vector<std::shared_ptr<HttpStream>> streams;
+  std::vector<struct MHD_Connection*> connections;
+  {
+    std::lock_guard<std::mutex> lock(_streams_mutex);
+    auto it = _streams.find(msg->getUri());
+    if(it != _streams.end()) {
+      // Connections that arrived meanwhile wait for the whole response
+      streams = it->second;
+    } else {
+      // Chunks may arrive out of order, so the first one to arrive
+      // (whichever it is) starts the responses
+      connections = _pending.take(msg->getUri());
+      if(connections.empty()) {
+        return;
+      }
+
+      for(auto connection : connections) {
+        streams.push_back(std::make_shared<HttpStream>(connection));
+      }
+      _streams.emplace(msg->getUri(), streams);
+    }
+  }
+
+  // All streams get the same chunks, so all of them complete together
+  bool complete = false;
+  for(auto& stream : streams) {
+    complete = stream->push(msg->getChunkNumber(), msg->getContentData(), !msg->getKeepSession());
+  }
+  if(complete) {
+    std::lock_guard<std::mutex> lock(_streams_mutex);
+    _streams.erase(msg->getUri());
+  }
+
+  // Without the length of the whole content, the responses are sent with
+  // chunked encoding
+  uint64_t size = msg->getContentLength() == size_t(-1) ? MHD_SIZE_UNKNOWN
+                                                        : msg->getContentLength();
+  for(size_t i = 0; i < connections.size(); ++i) {
+    struct MHD_Response* response = HttpStream::createResponse(streams[i], size);
+    MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_TYPE, msg->getContentType().c_str());
+
+    int ret = MHD_queue_response(connections[i], MHD_HTTP_OK, response);
+    MHD_resume_connection(connections[i]);
+    if(ret == MHD_YES) {
+      FIFU_LOG_INFO("(HTTP Protocol) Streaming the response message of " + msg->getUriString());
+    } else {
+      FIFU_LOG_INFO("(HTTP Protocol) Failed to stream response message of " + msg->getUriString());
+    }
+
+    MHD_destroy_response(response);
+  }
+}
+
+void HttpProtocol::replyWithStatus(const std::vector<struct MHD_Connection*>& connections,
+                                   const unsigned int status)
+{
+  if(connections.empty()) {
+    return;
+  }
+
+  struct MHD_Response* response = MHD_create_response_from_buffer(0, (void*) "",
+                                                                   MHD_RESPMEM_PERSISTENT);
+  if(status == MHD_HTTP_SERVICE_UNAVAILABLE) {
+    MHD_add_response_header(response, MHD_HTTP_HEADER_RETRY_AFTER, HTTP_RETRY_AFTER);
+  }
+
+  for(auto connection : connections) {
+    MHD_queue_response(connection, status, response);
+    MHD_resume_connection(connection);
+  }
+
+  MHD_destroy_response(response);
+}
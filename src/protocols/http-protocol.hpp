@@ -20,58 +20,117 @@
 
 #include "../plugin-protocol.hpp"
 #include "concurrent-blocking-queue.hpp"
+#include "http/http-client.hpp"
+#include "http/http-pending.hpp"
+#include "http/http-responses.hpp"
+#include "http/http-stream.hpp"
 #include "thread-pool.hpp"
 
+#include <map>
+#include <memory>
 #include <microhttpd.h>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <unordered_map>
 
 #define SCHEMA "http"
 
+// Defaults of the options of the plugin (-o http.<option>=<value>)
 #define DEFAULT_HOSTNAME "127.0.0.1"
-#define HTTPD_PORT 8000
+#define DEFAULT_HTTPD_PORT 8000
+#define DEFAULT_HTTPD_POLLING "epoll"
+#define DEFAULT_HTTPD_THREADS 1
+
+// Connections served at once when polling with epoll or poll (select is
+// limited by FD_SETSIZE)
+#define DEFAULT_HTTPD_CONNECTION_LIMIT 10000
+
+// Seconds a client waits for its response before getting a Gateway Timeout
+// (504)
+#define DEFAULT_HTTPD_TIMEOUT 30
+
+// Timeout (in milliseconds) of requests that carry no deadline
+#define DEFAULT_REQUEST_TIMEOUT_MS 30000
+
+// Seconds after which clients rejected due to overload may retry
+#define HTTP_RETRY_AFTER "1"
+
+// The callbacks of libmicrohttpd return an enum since 0.9.71
+#if MHD_VERSION < 0x00097002
+typedef int MHD_Result;
+#endif
 
 class HttpProtocol : public PluginProtocol
 {
 private:
   struct MHD_Daemon* daemon;
+
+  // Options
+  std::string _address;             // Listening address
+  std::string _hostname;            // Host of the foreign URIs
+  unsigned short _port;
+  std::string _polling;             // "epoll", "poll" or "select"
+  unsigned int _threads;
+  unsigned int _connection_limit;   // 0 for the default
+  unsigned int _per_ip_limit;       // 0 for no limit
+  bool _reuse_port;
+  unsigned int _timeout;            // Seconds
+
   std::thread _msg_receiver;
   std::thread _msg_sender;
+  std::thread _expirer;
+
+  // Suspended connections waiting for their response
+  HttpPending _pending;
+
+  // Responses being sent as their chunks arrive (one per connection)
+  std::unordered_map<Uri, std::vector<std::shared_ptr<HttpStream>>> _streams;
+  std::mutex _streams_mutex;
 
-  std::map<Uri, MHD_Connection*> pendingConnections;
+  // Fetches contents from the original servers
+  HttpClient _client;
+
+  // Creates responses without copying their body
+  HttpResponses _responses;
 
 public:
-  HttpProtocol(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+  HttpProtocol(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                ThreadPool& tp);
   ~HttpProtocol();
 
+  bool configure(const std::map<std::string, std::string>& options);
   void start();
   void stop();
 
   std::string getProtocol() const { return SCHEMA; };
+  bool supportsStreaming() const { return true; };
   std::string installMapping(const std::string uri);
 
 protected:
-  void processMessage(const MetaMessage* msg);
+  void processMessage(MetaMessagePtr msg);
 
 private:
   void startReceiver();
   void startSender();
+  void expireConnections();
 
-  void sendMessage(const MetaMessage* out);
-
-  static int static_answer_to_connection(void *cls, struct MHD_Connection *connection,
-                                         const char *url,
-                                         const char *method, const char *version,
-                                         const char *upload_data,
-                                         size_t *upload_data_size, void **con_cls);
+  static MHD_Result static_answer_to_connection(void *cls, struct MHD_Connection *connection,
+                                                const char *url,
+                                                const char *method, const char *version,
+                                                const char *upload_data,
+                                                size_t *upload_data_size, void **con_cls);
 
-  int answer_to_connection(struct MHD_Connection *connection,
-                           const char *url,
-                           const char *method, const char *version,
-                           const char *upload_data,
-                           size_t *upload_data_size, void **con_cls);
+  MHD_Result answer_to_connection(struct MHD_Connection *connection,
+                                  const char *url,
+                                  const char *method, const char *version,
+                                  const char *upload_data,
+                                  size_t *upload_data_size, void **con_cls);
 
   void responseHttpUri(const MetaMessage* msg);
+  void streamHttpUri(const MetaMessage* msg);
+  void replyWithStatus(const std::vector<struct MHD_Connection*>& connections,
+                       const unsigned int status);
 };
 
 #endif /* HTTP_PROTOCOL__HPP_ */
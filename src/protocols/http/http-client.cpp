@@ -0,0 +1,463 @@
+/** Brief: HTTP client for fetching contents from the original network
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "http-client.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <sstream>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+size_t getHttpContent(const void *content, const size_t size, const size_t nmemb, std::string *data)
+{
+  size_t content_size = size * nmemb;
+  data->append((const char*) content, content_size);
+
+  return content_size;
+}
+
+size_t getHttpHeaders(const void *header, const size_t size, const size_t nmemb, std::string *headers)
+{
+  size_t header_size = size * nmemb;
+  headers->append((const char*) header, header_size);
+
+  return header_size;
+}
+
+long getHttpFreshness(const std::string headers)
+{
+  std::istringstream lines(headers);
+  std::string line;
+  while(std::getline(lines, line)) {
+    std::transform(line.begin(), line.end(), line.begin(), ::tolower);
+    if(line.find("cache-control:") != 0) {
+      continue;
+    }
+
+    if(line.find("no-store") != std::string::npos
+       || line.find("no-cache") != std::string::npos
+       || line.find("private") != std::string::npos) {
+      return 0;
+    }
+
+    size_t pos = line.find("max-age=");
+    if(pos != std::string::npos) {
+      return atol(line.c_str() + pos + strlen("max-age="));
+    }
+  }
+
+  return -1;
+}
+///////////////////////////////////////////////////////////////////////////////
+
+HttpClient::HttpClient()
+  : _share(NULL),
+    _multi(NULL),
+    _epoll(-1),
+    _wakeup(-1),
+    _deadline(std::chrono::steady_clock::time_point::max()),
+    _isRunning(false),
+    _requests(Metrics::getInstance().getCounter("http.upstream_requests")),
+    _connections(Metrics::getInstance().getCounter("http.upstream_connections"))
+{
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+
+  _share = curl_share_init();
+  if(_share == NULL) {
+    FIFU_LOG_ERROR("(HTTP Protocol) Unable to create the share of the HTTP client");
+    return;
+  }
+
+  curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, &HttpClient::lock);
+  curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, &HttpClient::unlock);
+  curl_share_setopt(_share, CURLSHOPT_USERDATA, this);
+  curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+  _multi = curl_multi_init();
+  _epoll = epoll_create1(EPOLL_CLOEXEC);
+  _wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(_multi == NULL || _epoll < 0 || _wakeup < 0) {
+    FIFU_LOG_ERROR("(HTTP Protocol) Unable to create the event loop of the HTTP client");
+    return;
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = _wakeup;
+  epoll_ctl(_epoll, EPOLL_CTL_ADD, _wakeup, &ev);
+
+  curl_multi_setopt(_multi, CURLMOPT_SOCKETFUNCTION, &HttpClient::onSocket);
+  curl_multi_setopt(_multi, CURLMOPT_SOCKETDATA, this);
+  curl_multi_setopt(_multi, CURLMOPT_TIMERFUNCTION, &HttpClient::onTimer);
+  curl_multi_setopt(_multi, CURLMOPT_TIMERDATA, this);
+  curl_multi_setopt(_multi, CURLMOPT_MAXCONNECTS, (long) HTTP_CLIENT_MAX_CONNECTIONS);
+}
+
+HttpClient::~HttpClient()
+{
+  stop();
+
+  // Handles must be gone before the multi and the share they use
+  for(auto curl : _handles) {
+    curl_easy_cleanup(curl);
+  }
+  _handles.clear();
+
+  if(_multi != NULL) {
+    curl_multi_cleanup(_multi);
+  }
+  if(_share != NULL) {
+    curl_share_cleanup(_share);
+  }
+  if(_epoll >= 0) {
+    close(_epoll);
+  }
+  if(_wakeup >= 0) {
+    close(_wakeup);
+  }
+
+  curl_global_cleanup();
+}
+
+void HttpClient::start()
+{
+  if(_isRunning || _multi == NULL || _epoll < 0 || _wakeup < 0) {
+    return;
+  }
+
+  _isRunning = true;
+  _loop = std::thread(&HttpClient::run, this);
+}
+
+void HttpClient::stop()
+{
+  {
+    // Nothing can be submitted once the client is stopping
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(!_isRunning) {
+      return;
+    }
+    _isRunning = false;
+  }
+
+  uint64_t one = 1;
+  if(write(_wakeup, &one, sizeof(one)) < 0) {
+    FIFU_LOG_WARN("(HTTP Protocol) Unable to wake up the HTTP client");
+  }
+
+  if(_loop.joinable()) {
+    _loop.join();
+  }
+}
+
+void HttpClient::get(const std::string& uri, const long timeout, HttpCallback done)
+{
+  FIFU_LOG_INFO("(HTTP Protocol) Requesting " + uri);
+
+  Transfer* transfer = new Transfer();
+  transfer->uri = uri;
+  transfer->timeout = timeout;
+  transfer->done = std::move(done);
+  transfer->curl = NULL;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_isRunning) {
+      _submitted.push_back(transfer);
+      transfer = NULL;
+    }
+  }
+
+  if(transfer != NULL) {
+    finish(transfer, CURLE_FAILED_INIT);
+    return;
+  }
+
+  uint64_t one = 1;
+  if(write(_wakeup, &one, sizeof(one)) < 0) {
+    FIFU_LOG_WARN("(HTTP Protocol) Unable to wake up the HTTP client");
+  }
+}
+
+void HttpClient::run()
+{
+  struct epoll_event events[HTTP_CLIENT_MAX_EVENTS];
+  int running;
+
+  while(_isRunning) {
+    int wait = -1;
+    if(_deadline != std::chrono::steady_clock::time_point::max()) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    _deadline - std::chrono::steady_clock::now()).count();
+      wait = left > 0 ? left : 0;
+    }
+
+    int n = epoll_wait(_epoll, events, HTTP_CLIENT_MAX_EVENTS, wait);
+    if(n < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      FIFU_LOG_ERROR("(HTTP Protocol) Event loop of the HTTP client failed ("
+                     + std::string(strerror(errno)) + ")");
+      break;
+    }
+
+    for(int i = 0; i < n; ++i) {
+      if(events[i].data.fd == _wakeup) {
+        uint64_t count;
+        while(read(_wakeup, &count, sizeof(count)) > 0);
+        addSubmitted();
+        continue;
+      }
+
+      int flags = 0;
+      if(events[i].events & EPOLLIN) {
+        flags |= CURL_CSELECT_IN;
+      }
+      if(events[i].events & EPOLLOUT) {
+        flags |= CURL_CSELECT_OUT;
+      }
+      if(events[i].events & (EPOLLERR | EPOLLHUP)) {
+        flags |= CURL_CSELECT_ERR;
+      }
+      curl_multi_socket_action(_multi, events[i].data.fd, flags, &running);
+    }
+
+    if(_deadline <= std::chrono::steady_clock::now()) {
+      _deadline = std::chrono::steady_clock::time_point::max();
+      curl_multi_socket_action(_multi, CURL_SOCKET_TIMEOUT, 0, &running);
+    }
+
+    finishTransfers();
+  }
+
+  // Fail whatever is left, so no one waits forever
+  for(auto transfer : _active) {
+    curl_multi_remove_handle(_multi, transfer->curl);
+    release(transfer->curl);
+    transfer->curl = NULL;
+    finish(transfer, CURLE_ABORTED_BY_CALLBACK);
+  }
+  _active.clear();
+
+  std::vector<Transfer*> submitted;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    submitted.swap(_submitted);
+  }
+  for(auto transfer : submitted) {
+    finish(transfer, CURLE_ABORTED_BY_CALLBACK);
+  }
+}
+
+void HttpClient::addSubmitted()
+{
+  std::vector<Transfer*> submitted;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    submitted.swap(_submitted);
+  }
+
+  for(auto transfer : submitted) {
+    CURL* curl = acquire();
+    if(!curl) {
+      finish(transfer, CURLE_FAILED_INIT);
+      continue;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, transfer->uri.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer->content);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &transfer->headers);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, transfer->timeout);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, transfer);
+    transfer->curl = curl;
+
+    if(curl_multi_add_handle(_multi, curl) != CURLM_OK) {
+      release(curl);
+      transfer->curl = NULL;
+      finish(transfer, CURLE_FAILED_INIT);
+      continue;
+    }
+
+    ++_requests;
+    _active.insert(transfer);
+  }
+}
+
+void HttpClient::finishTransfers()
+{
+  CURLMsg* msg;
+  int left;
+  while((msg = curl_multi_info_read(_multi, &left)) != NULL) {
+    if(msg->msg != CURLMSG_DONE) {
+      continue;
+    }
+
+    CURL* curl = msg->easy_handle;
+    CURLcode res = msg->data.result;
+
+    Transfer* transfer;
+    curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char**) &transfer);
+
+    long connections = 0;
+    if(curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connections) == CURLE_OK) {
+      _connections += connections;
+    }
+
+    curl_multi_remove_handle(_multi, curl);
+    _active.erase(transfer);
+    finish(transfer, res);
+
+    release(curl);
+  }
+}
+
+void HttpClient::finish(Transfer* transfer, const CURLcode res)
+{
+  HttpResult result;
+  result.ok = false;
+  result.freshness = -1;
+
+  if(res != CURLE_OK) {
+    FIFU_LOG_INFO("(HTTP Protocol) Unable to get " + transfer->uri
+                  + "[Error " + curl_easy_strerror(res) + "]");
+  } else {
+    result.ok = true;
+
+    char* t = NULL;
+    CURLcode ret = curl_easy_getinfo(transfer->curl, CURLINFO_CONTENT_TYPE, &t);
+    if(ret != CURLE_OK || !t) {
+      FIFU_LOG_WARN("(HTTP Protocol) Unable to get content type for " + transfer->uri
+                    + "[Error " + curl_easy_strerror(ret) + "]");
+    } else {
+      result.type = t;
+      result.type = result.type.substr(0, result.type.find(";"));
+    }
+
+    result.content = std::move(transfer->content);
+    result.freshness = getHttpFreshness(transfer->headers);
+  }
+
+  if(transfer->done) {
+    transfer->done(result);
+  }
+
+  delete transfer;
+}
+
+CURL* HttpClient::acquire()
+{
+  if(!_handles.empty()) {
+    CURL* curl = _handles.back();
+    _handles.pop_back();
+    return curl;
+  }
+
+  CURL* curl = curl_easy_init();
+  if(!curl) {
+    return NULL;
+  }
+
+  // Options common to all requests
+  curl_easy_setopt(curl, CURLOPT_SHARE, _share);
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, getHttpContent);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, getHttpHeaders);
+
+  return curl;
+}
+
+void HttpClient::release(CURL* curl)
+{
+  // Do not keep pointers to the buffers of the finished request
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, NULL);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, NULL);
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, NULL);
+
+  if(_handles.size() < HTTP_CLIENT_MAX_HANDLES) {
+    _handles.push_back(curl);
+    return;
+  }
+
+  curl_easy_cleanup(curl);
+}
+
+int HttpClient::onSocket(CURL*, curl_socket_t s, int what, void* userp, void* socketp)
+{
+  HttpClient* client = static_cast<HttpClient*>(userp);
+
+  if(what == CURL_POLL_REMOVE) {
+    // The socket may already be closed, in which case epoll dropped it
+    epoll_ctl(client->_epoll, EPOLL_CTL_DEL, s, NULL);
+    return 0;
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.data.fd = s;
+  if(what & CURL_POLL_IN) {
+    ev.events |= EPOLLIN;
+  }
+  if(what & CURL_POLL_OUT) {
+    ev.events |= EPOLLOUT;
+  }
+
+  // Sockets seen before are tagged with the client
+  if(socketp == NULL) {
+    if(epoll_ctl(client->_epoll, EPOLL_CTL_ADD, s, &ev) < 0 && errno == EEXIST) {
+      epoll_ctl(client->_epoll, EPOLL_CTL_MOD, s, &ev);
+    }
+    curl_multi_assign(client->_multi, s, client);
+  } else {
+    epoll_ctl(client->_epoll, EPOLL_CTL_MOD, s, &ev);
+  }
+
+  return 0;
+}
+
+int HttpClient::onTimer(CURLM*, long timeout_ms, void* userp)
+{
+  HttpClient* client = static_cast<HttpClient*>(userp);
+
+  if(timeout_ms < 0) {
+    client->_deadline = std::chrono::steady_clock::time_point::max();
+  } else {
+    client->_deadline = std::chrono::steady_clock::now()
+                        + std::chrono::milliseconds(timeout_ms);
+  }
+
+  return 0;
+}
+
+void HttpClient::lock(CURL*, curl_lock_data data, curl_lock_access, void* userptr)
+{
+  static_cast<HttpClient*>(userptr)->_share_locks[data].lock();
+}
+
+void HttpClient::unlock(CURL*, curl_lock_data data, void* userptr)
+{
+  static_cast<HttpClient*>(userptr)->_share_locks[data].unlock();
+}
@@ -0,0 +1,142 @@
+/** Brief: HTTP client for fetching contents from the original network
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTP_CLIENT__HPP_
+#define HTTP_CLIENT__HPP_
+
+#include <atomic>
+#include <chrono>
+#include <curl/curl.h>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Number of idle handles kept for reuse
+#define HTTP_CLIENT_MAX_HANDLES 64
+
+// Number of open connections to the origin servers kept for reuse
+#define HTTP_CLIENT_MAX_CONNECTIONS 64
+
+// Number of socket events handled per iteration of the event loop
+#define HTTP_CLIENT_MAX_EVENTS 64
+
+struct HttpResult
+{
+  bool ok;
+  std::string type;
+  std::string content;
+
+  // Seconds (or -1 if the server gave no freshness information)
+  long freshness;
+};
+
+typedef std::function<void(HttpResult& result)> HttpCallback;
+
+// Usage example:
+// '''
+//  (...)
+//
+//  HttpClient client;
+//  client.start();
+//
+//  // Returns straight away
+//  client.get("http://example.org/", 5000, [](HttpResult& result) {
+//    // Called from the client thread once the transfer is over
+//  });
+//
+//  (...)
+// '''
+//
+// Fetches contents over HTTP without blocking the calling thread. All
+// transfers are driven by a single thread, which waits on the sockets of
+// all of them at once (epoll) and lets libcurl act only on those that are
+// ready, so thousands of transfers can be in progress at the same time.
+//
+// Finished easy handles are kept for reuse, and all of them use the same
+// share object, so DNS lookups, open (keep-alive) connections and TLS
+// sessions are reused between transfers.
+class HttpClient
+{
+private:
+  struct Transfer
+  {
+    std::string uri;
+    long timeout;
+    HttpCallback done;
+
+    CURL* curl;
+    std::string content;
+    std::string headers;
+  };
+
+  CURLSH* _share;
+  std::mutex _share_locks[CURL_LOCK_DATA_LAST];
+
+  CURLM* _multi;
+  int _epoll;
+  int _wakeup;
+  std::chrono::steady_clock::time_point _deadline;
+
+  std::atomic<bool> _isRunning;
+  std::thread _loop;
+
+  // Transfers waiting to be picked up by the client thread
+  std::mutex _mutex;
+  std::vector<Transfer*> _submitted;
+
+  // Used by the client thread only
+  std::unordered_set<Transfer*> _active;
+  std::vector<CURL*> _handles;
+
+  std::atomic<uint64_t>& _requests;
+  std::atomic<uint64_t>& _connections;
+
+public:
+  HttpClient();
+  ~HttpClient();
+
+  HttpClient(const HttpClient&) = delete;
+  void operator=(const HttpClient&) = delete;
+
+  void start();
+  void stop();
+
+  // Fetches the content within the timeout (in milliseconds) and calls
+  // done() with the result. Transfers still in progress when the client
+  // is stopped fail.
+  void get(const std::string& uri, const long timeout, HttpCallback done);
+
+private:
+  void run();
+  void addSubmitted();
+  void finishTransfers();
+  void finish(Transfer* transfer, const CURLcode res);
+
+  CURL* acquire();
+  void release(CURL* curl);
+
+  static int onSocket(CURL* curl, curl_socket_t s, int what, void* userp, void* socketp);
+  static int onTimer(CURLM* multi, long timeout_ms, void* userp);
+
+  static void lock(CURL* curl, curl_lock_data data, curl_lock_access access, void* userptr);
+  static void unlock(CURL* curl, curl_lock_data data, void* userptr);
+};
+
+#endif /* HTTP_CLIENT__HPP_ */
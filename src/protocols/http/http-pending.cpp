@@ -0,0 +1,108 @@
+/** Brief: Suspended HTTP connections waiting for their response
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "http-pending.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+
+HttpPending::HttpPending()
+  : _timers(std::chrono::milliseconds(HTTP_PENDING_TICK), HTTP_PENDING_SLOTS),
+    _next_id(1),
+    _size(0),
+    _coalesced(Metrics::getInstance().getCounter("http.coalesced_requests"))
+{
+  Metrics::getInstance().setGauge("http.pending_connections", [this]() { return size(); });
+}
+
+HttpPending::~HttpPending()
+{
+  Metrics::getInstance().removeGauge("http.pending_connections");
+}
+
+bool HttpPending::add(const Uri& uri, struct MHD_Connection* connection,
+                      const std::chrono::steady_clock::time_point deadline)
+{
+  Entry entry = {connection, _next_id++, deadline};
+
+  bool first = false;
+  _entries.upsert(uri,
+                  [&](std::vector<Entry>& entries, bool) {
+                    first = entries.empty();
+                    entries.push_back(entry);
+                  });
+  ++_size;
+  if(!first) {
+    ++_coalesced;
+  }
+
+  _timers.schedule(deadline, {uri, entry.id});
+  return first;
+}
+
+std::vector<struct MHD_Connection*> HttpPending::take(const Uri& uri)
+{
+  std::vector<struct MHD_Connection*> ret;
+  _entries.apply(uri,
+                 [&ret](std::vector<Entry>& entries) {
+                   for(auto& entry : entries) {
+                     ret.push_back(entry.connection);
+                   }
+                   return true;
+                 });
+  _size -= ret.size();
+
+  return ret;
+}
+
+std::vector<struct MHD_Connection*> HttpPending::expire(const std::chrono::steady_clock::time_point now)
+{
+  std::vector<struct MHD_Connection*> ret;
+
+  // Connections already taken are no longer found
+  for(auto& timer : _timers.advance(now)) {
+    _entries.apply(timer.uri,
+                   [&](std::vector<Entry>& entries) {
+                     auto it = std::find_if(entries.begin(), entries.end(),
+                                            [&timer](const Entry& entry) {
+                                              return entry.id == timer.id;
+                                            });
+                     if(it != entries.end() && it->deadline <= now) {
+                       ret.push_back(it->connection);
+                       entries.erase(it);
+                     }
+                     return entries.empty();
+                   });
+  }
+  _size -= ret.size();
+
+  return ret;
+}
+
+std::vector<struct MHD_Connection*> HttpPending::takeAll()
+{
+  std::vector<struct MHD_Connection*> ret;
+  _entries.applyAll([&ret](const Uri&, std::vector<Entry>& entries) {
+                      for(auto& entry : entries) {
+                        ret.push_back(entry.connection);
+                      }
+                      return true;
+                    });
+  _size -= ret.size();
+
+  return ret;
+}
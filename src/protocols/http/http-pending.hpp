@@ -0,0 +1,111 @@
+/** Brief: Suspended HTTP connections waiting for their response
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTP_PENDING__HPP_
+#define HTTP_PENDING__HPP_
+
+#include "concurrent-hash-map.hpp"
+#include "timer-wheel.hpp"
+#include "uri.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <microhttpd.h>
+#include <vector>
+
+// Resolution (in milliseconds) and number of slots of the timeouts
+#define HTTP_PENDING_TICK 100
+#define HTTP_PENDING_SLOTS 1024
+
+// Usage example:
+// '''
+//  (...)
+//
+//  HttpPending pending;
+//
+//  // From the thread of the server
+//  MHD_suspend_connection(connection);
+//  if(pending.add(uri, connection, deadline)) {
+//    // First one waiting for this URI, so ask for it
+//  }
+//
+//  // From any thread
+//  for(auto connection : pending.take(uri)) {
+//    MHD_queue_response(connection, MHD_HTTP_OK, response);
+//    MHD_resume_connection(connection);
+//  }
+//
+//  (...)
+// '''
+//
+// Any number of connections may wait for the same URI, and all of them are
+// taken at once when its response arrives. Responses are queued before the
+// connections are resumed, as libmicrohttpd only takes them from other
+// threads while the connections are suspended. Connections not taken by their
+// deadline are handed out by expire().
+//
+class HttpPending
+{
+private:
+  struct Entry
+  {
+    struct MHD_Connection* connection;
+    uint64_t id;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  struct Timer
+  {
+    Uri uri;
+    uint64_t id;
+  };
+
+  ConcurrentHashMap<Uri, std::vector<Entry>> _entries;
+  TimerWheel<Timer> _timers;
+  std::atomic<uint64_t> _next_id;
+  std::atomic<size_t> _size;
+
+  // Connections that did not need a request of their own
+  std::atomic<uint64_t>& _coalesced;
+
+public:
+  HttpPending();
+  ~HttpPending();
+
+  HttpPending(const HttpPending&) = delete;
+  void operator=(const HttpPending&) = delete;
+
+  // Returns true if no other connection was waiting for the URI
+  bool add(const Uri& uri, struct MHD_Connection* connection,
+           const std::chrono::steady_clock::time_point deadline);
+
+  // Connections waiting for the URI, which no longer wait
+  std::vector<struct MHD_Connection*> take(const Uri& uri);
+
+  // Connections whose deadline passed, which no longer wait
+  std::vector<struct MHD_Connection*> expire(const std::chrono::steady_clock::time_point now);
+
+  // Connections still waiting (e.g., when stopping), which no longer wait
+  std::vector<struct MHD_Connection*> takeAll();
+
+  size_t size() const
+  {
+    return _size;
+  }
+};
+
+#endif /* HTTP_PENDING__HPP_ */
@@ -0,0 +1,182 @@
+/** Brief: Creates HTTP responses without copying their body
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "http-responses.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+HttpResponses::HttpResponses()
+  : _bytes(0),
+    _sendfile(Metrics::getInstance().getCounter("http.sendfile_responses"))
+{ }
+
+HttpResponses::~HttpResponses()
+{
+  for(auto& item : _files) {
+    if(item.second.fd >= 0) {
+      close(item.second.fd);
+    }
+  }
+}
+
+struct MHD_Response* HttpResponses::create(const Buffer& data)
+{
+  if(data.size() >= HTTP_SENDFILE_MIN_SIZE) {
+    int fd = getFile(data);
+    if(fd >= 0) {
+      struct MHD_Response* response =
+        MHD_create_response_from_fd_at_offset64(data.size(), fd, data.offset());
+      if(response != NULL) {
+        ++_sendfile;
+        return response;
+      }
+      close(fd);
+    }
+  }
+
+  // Available since libmicrohttpd 0.9.74
+#if MHD_VERSION >= 0x00097400
+  return MHD_create_response_from_buffer_with_free_callback_cls(data.size(), data.data(),
+                                                                &HttpResponses::release,
+                                                                new Buffer(data));
+#else
+  return MHD_create_response_from_buffer(data.size(), (void*) data.data(),
+                                         MHD_RESPMEM_MUST_COPY);
+#endif
+}
+
+int HttpResponses::getFile(const Buffer& data)
+{
+  const std::shared_ptr<const std::string>& storage = data.storage();
+  if(!storage || storage->size() > HTTP_FILES_MAX_SIZE) {
+    return -1;
+  }
+
+  std::unique_lock<std::mutex> lock(_mutex);
+
+  auto it = _files.find(storage.get());
+
+  // The bytes may be gone and others be at the same address
+  if(it != _files.end() && it->second.storage.lock() != storage) {
+    remove(it);
+    it = _files.end();
+  }
+
+  if(it == _files.end()) {
+    // First time seen
+    if(_files.size() >= HTTP_FILES_MAX_ENTRIES) {
+      remove(_files.find(_lru.front()));
+    }
+
+    _lru.push_back(storage.get());
+    _files.emplace(storage.get(), File{storage, -1, 0, false, std::prev(_lru.end())});
+    return -1;
+  }
+
+  _lru.splice(_lru.end(), _lru, it->second.lru);
+
+  // Each response closes its own descriptor. They share the file offset,
+  // which is fine since responses read at explicit offsets.
+  if(it->second.fd >= 0) {
+    return dup(it->second.fd);
+  }
+
+  // Responses are sent from memory until the file is written
+  if(it->second.writing) {
+    return -1;
+  }
+  it->second.writing = true;
+
+  // Writing may take a while, so other responses are not held back
+  // meanwhile
+  lock.unlock();
+  int fd = writeFile(*storage);
+  lock.lock();
+
+  // The entry may have been removed (and even added again) meanwhile
+  it = _files.find(storage.get());
+  if(it == _files.end() || it->second.storage.lock() != storage) {
+    if(fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+  it->second.writing = false;
+
+  if(fd < 0 || it->second.fd >= 0) {
+    if(fd >= 0) {
+      close(fd);
+    }
+    return it->second.fd >= 0 ? dup(it->second.fd) : -1;
+  }
+
+  // Make room for it
+  while(_bytes + storage->size() > HTTP_FILES_MAX_SIZE && _lru.front() != storage.get()) {
+    remove(_files.find(_lru.front()));
+  }
+
+  it->second.fd = fd;
+  it->second.size = storage->size();
+  _bytes += storage->size();
+
+  return dup(fd);
+}
+
+int HttpResponses::writeFile(const std::string& bytes)
+{
+  int fd = memfd_create("fixp-http", MFD_CLOEXEC);
+  if(fd < 0) {
+    FIFU_LOG_WARN("(HTTP Protocol) Unable to create file for response (" + std::string(strerror(errno)) + ")");
+    return -1;
+  }
+
+  size_t written = 0;
+  while(written < bytes.size()) {
+    ssize_t ret = write(fd, bytes.data() + written, bytes.size() - written);
+    if(ret < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      close(fd);
+      return -1;
+    }
+    written += ret;
+  }
+
+  return fd;
+}
+
+void HttpResponses::remove(std::unordered_map<const std::string*, File>::iterator it)
+{
+  if(it->second.fd >= 0) {
+    close(it->second.fd);
+    _bytes -= it->second.size;
+  }
+
+  _lru.erase(it->second.lru);
+  _files.erase(it);
+}
+
+void HttpResponses::release(void* cls)
+{
+  delete static_cast<Buffer*>(cls);
+}
@@ -0,0 +1,98 @@
+/** Brief: Creates HTTP responses without copying their body
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTP_RESPONSES__HPP_
+#define HTTP_RESPONSES__HPP_
+
+#include "buffer.hpp"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <microhttpd.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Bodies smaller than this (in bytes) are never sent from a file
+#define HTTP_SENDFILE_MIN_SIZE 64 * 1024
+
+// Size (in bytes) and number of the bodies kept in (in-memory) files
+#define HTTP_FILES_MAX_SIZE 64 * 1024 * 1024
+#define HTTP_FILES_MAX_ENTRIES 256
+
+// Usage example:
+// '''
+//  (...)
+//
+//  HttpResponses responses;
+//
+//  struct MHD_Response* response = responses.create(msg->getContentData());
+//  MHD_queue_response(connection, MHD_HTTP_OK, response);
+//  MHD_destroy_response(response);
+//
+//  (...)
+// '''
+//
+// Responses hold a reference to the buffer of the content until the server
+// is done with them, instead of copying it.
+//
+// Big bodies sent more than once (i.e., cached ones) are put in an
+// in-memory file the second time they are seen, and sent from it
+// afterwards, so the kernel copies them straight to the socket (sendfile).
+// Bodies are told apart by the bytes they share, which the cache keeps
+// while the content is cached.
+//
+class HttpResponses
+{
+private:
+  struct File
+  {
+    std::weak_ptr<const std::string> storage;
+    int fd;                                   // -1 until seen twice
+    size_t size;                              // Bytes in the file
+    bool writing;                             // File being written
+    std::list<const std::string*>::iterator lru;
+  };
+
+  std::mutex _mutex;
+  std::unordered_map<const std::string*, File> _files;
+  std::list<const std::string*> _lru;        // Least recently used first
+  size_t _bytes;
+
+  std::atomic<uint64_t>& _sendfile;
+
+public:
+  HttpResponses();
+  ~HttpResponses();
+
+  HttpResponses(const HttpResponses&) = delete;
+  void operator=(const HttpResponses&) = delete;
+
+  struct MHD_Response* create(const Buffer& data);
+
+private:
+  // File (to be closed by the caller) holding the bytes of the buffer, or
+  // -1 if there is none (yet)
+  int getFile(const Buffer& data);
+  int writeFile(const std::string& bytes);
+  void remove(std::unordered_map<const std::string*, File>::iterator it);
+
+  static void release(void* cls);
+};
+
+#endif /* HTTP_RESPONSES__HPP_ */
@@ -0,0 +1,142 @@
+/** Brief: Body of an HTTP response streamed as its chunks arrive
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "http-stream.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+HttpStream::HttpStream(struct MHD_Connection* connection)
+  : _connection(connection),
+    _offset(0),
+    _next(0),
+    _last(-1),
+    _failed(false),
+    _suspended(false),
+    _closed(false)
+{ }
+
+struct MHD_Response* HttpStream::createResponse(std::shared_ptr<HttpStream> stream,
+                                                const uint64_t size)
+{
+  // The response keeps the stream alive until the server is done with it
+  return MHD_create_response_from_callback(size, HTTP_STREAM_BLOCK_SIZE,
+                                           &HttpStream::static_read,
+                                           new std::shared_ptr<HttpStream>(stream),
+                                           &HttpStream::static_free);
+}
+
+bool HttpStream::push(const size_t number, const Buffer data, const bool last)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  // Drop duplicates
+  if(number < _next || _early.count(number) != 0) {
+    return _next > _last && _last != size_t(-1);
+  }
+
+  if(last) {
+    _last = number;
+  }
+  _early.emplace(number, data);
+
+  auto it = _early.begin();
+  while(it != _early.end() && it->first == _next) {
+    if(!it->second.empty()) {
+      _ready.push_back(it->second);
+    }
+    ++_next;
+    it = _early.erase(it);
+  }
+
+  bool complete = _last != size_t(-1) && _next > _last;
+  if(!_ready.empty() || complete) {
+    resume();
+  }
+
+  return complete;
+}
+
+void HttpStream::fail()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  _failed = true;
+  resume();
+}
+
+ssize_t HttpStream::read(char* buf, size_t max)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  if(_failed) {
+    return MHD_CONTENT_READER_END_WITH_ERROR;
+  }
+
+  if(_ready.empty()) {
+    if(_last != size_t(-1) && _next > _last) {
+      return MHD_CONTENT_READER_END_OF_STREAM;
+    }
+
+    // Wait for the next chunk without keeping the server busy
+    _suspended = true;
+    MHD_suspend_connection(_connection);
+    return 0;
+  }
+
+  size_t size = 0;
+  while(size < max && !_ready.empty()) {
+    const Buffer& chunk = _ready.front();
+    size_t len = std::min(max - size, chunk.size() - _offset);
+    memcpy(buf + size, chunk.data() + _offset, len);
+    size += len;
+    _offset += len;
+
+    if(_offset == chunk.size()) {
+      _ready.pop_front();
+      _offset = 0;
+    }
+  }
+
+  return size;
+}
+
+// Must be called with the lock held
+void HttpStream::resume()
+{
+  // The connection is gone once the server is done with the response
+  if(_suspended && !_closed) {
+    _suspended = false;
+    MHD_resume_connection(_connection);
+  }
+}
+
+ssize_t HttpStream::static_read(void* cls, uint64_t, char* buf, size_t max)
+{
+  return (*static_cast<std::shared_ptr<HttpStream>*>(cls))->read(buf, max);
+}
+
+void HttpStream::static_free(void* cls)
+{
+  std::shared_ptr<HttpStream>* stream = static_cast<std::shared_ptr<HttpStream>*>(cls);
+  {
+    std::lock_guard<std::mutex> lock((*stream)->_mutex);
+    (*stream)->_closed = true;
+  }
+
+  delete stream;
+}
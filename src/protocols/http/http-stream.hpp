@@ -0,0 +1,94 @@
+/** Brief: Body of an HTTP response streamed as its chunks arrive
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTP_STREAM__HPP_
+#define HTTP_STREAM__HPP_
+
+#include "buffer.hpp"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <microhttpd.h>
+#include <mutex>
+
+// Size (in bytes) of the blocks handed to the HTTP server at a time
+#define HTTP_STREAM_BLOCK_SIZE 32 * 1024
+
+// Usage example:
+// '''
+//  (...)
+//
+//  auto stream = std::make_shared<HttpStream>(connection);
+//  struct MHD_Response* response = HttpStream::createResponse(stream, MHD_SIZE_UNKNOWN);
+//  MHD_queue_response(connection, MHD_HTTP_OK, response);
+//  MHD_destroy_response(response);
+//
+//  // From any thread and in any order
+//  stream->push(1, chunk1, true);
+//  stream->push(0, chunk0, false);
+//
+//  (...)
+// '''
+//
+// Chunks are put back in order and sent to the HTTP client as soon as they
+// are, so the client gets the first bytes without waiting for the whole
+// content. The connection is suspended while the client is waiting for the
+// next chunk, and resumed once it arrives.
+//
+class HttpStream
+{
+private:
+  std::mutex _mutex;
+  struct MHD_Connection* _connection;
+
+  std::map<size_t, Buffer> _early;   // Arrived ahead of their turn
+  std::deque<Buffer> _ready;         // In order, not yet sent
+  size_t _offset;                    // Bytes of the first ready chunk already sent
+  size_t _next;                      // Number of the next chunk in order
+  size_t _last;                      // -1 until the last chunk arrives
+
+  bool _failed;
+  bool _suspended;
+  bool _closed;
+
+public:
+  HttpStream(struct MHD_Connection* connection);
+
+  HttpStream(const HttpStream&) = delete;
+  void operator=(const HttpStream&) = delete;
+
+  // Response reading its body from the stream. The size of the body may be
+  // MHD_SIZE_UNKNOWN, in which case it is sent with chunked encoding.
+  static struct MHD_Response* createResponse(std::shared_ptr<HttpStream> stream,
+                                             const uint64_t size);
+
+  // Returns true once all chunks are in
+  bool push(const size_t number, const Buffer data, const bool last);
+
+  // Cuts the body short
+  void fail();
+
+private:
+  ssize_t read(char* buf, size_t max);
+  void resume();
+
+  static ssize_t static_read(void* cls, uint64_t pos, char* buf, size_t max);
+  static void static_free(void* cls);
+};
+
+#endif /* HTTP_STREAM__HPP_ */
@@ -20,7 +20,7 @@
 #include "ndn-protocol.hpp"
 #include "logger.hpp"
 
-extern "C" NdnProtocol* create_plugin_object(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+extern "C" NdnProtocol* create_plugin_object(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                                              ThreadPool& tp)
 {
   return new NdnProtocol(queue, tp);
@@ -73,7 +73,7 @@ std::string cleanName(Name name)
 
 ///////////////////////////////////////////////////////////////////////////////
 
-NdnProtocol::NdnProtocol(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+NdnProtocol::NdnProtocol(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                          ThreadPool& tp)
     : PluginProtocol(queue, tp)
     , _face(_io_service)
@@ -121,7 +121,15 @@ std::string NdnProtocol::installMapping(const std::string uri)
 
 void NdnProtocol::onInterest(const InterestFilter& filter, const Interest& interest)
 {
-  MetaMessage* in = new MetaMessage();
+  if(isOverloaded()) {
+    FIFU_LOG_WARN("(NDN Protocol) Overloaded. Replying with Nack to " + interest.getName().toUri());
+    lp::Nack nack(interest);
+    nack.setReason(lp::NackReason::CONGESTION);
+    _face.put(nack);
+    return;
+  }
+
+  MetaMessagePtr in = createMetaMessage();
 
   // Remove trailing Version and/or Segment Number
   // TODO: Handle request for an specific chunk, handle request for specific version
@@ -141,7 +149,7 @@ void NdnProtocol::onInterest(const InterestFilter& filter, const Interest& inter
   in->setMessageType(MESSAGE_TYPE_REQUEST);
 
   FIFU_LOG_INFO("(NDN Protocol) Received Interest message to " + in->getUriString());
-  receivedMessage(in);
+  receivedMessage(std::move(in));
 }
 
 void NdnProtocol::sendInterest(const std::string interest_name)
@@ -159,12 +167,12 @@ void NdnProtocol::sendInterest(const std::string interest_name)
   FIFU_LOG_INFO("(NDN Protocol) ProcessEvents finished...");
 }
 
-void NdnProtocol::sendData(const std::string data_name, const std::string content)
+void NdnProtocol::sendData(const std::string data_name, const Buffer& content)
 {
   FIFU_LOG_INFO("(NDN Protocol) Sending Data message to " + data_name);
 
   //Determine number of chunks
-  uint32_t chunk_count = 1 + (content.size() - 1) / MAX_CHUNK_SIZE;
+  uint32_t chunk_count = content.empty() ? 1 : 1 + (content.size() - 1) / MAX_CHUNK_SIZE;
 
   if (chunk_count == 1)
   {
@@ -172,7 +180,7 @@ void NdnProtocol::sendData(const std::string data_name, const std::string conten
     shared_ptr<Data> data = make_shared<Data>();
     data->setName(data_name);
     data->setFreshnessPeriod(time::seconds(100));
-    data->setContent(reinterpret_cast<const uint8_t*>(content.c_str()), content.size());
+    data->setContent(reinterpret_cast<const uint8_t*>(content.data()), content.size());
 
     // Sign Data packet with default identity
     _key_chain.sign(*data);
@@ -184,11 +192,8 @@ void NdnProtocol::sendData(const std::string data_name, const std::string conten
   {
     for (int i = 0; i < chunk_count; i++)
     {
-      //Get chunk from content
-      uint32_t chunkLength = MAX_CHUNK_SIZE;
-      if (i == chunk_count - 1)
-        chunkLength = content.size() % MAX_CHUNK_SIZE;
-      std::string chunk = content.substr(i*MAX_CHUNK_SIZE,chunkLength);
+      //Get chunk from content (a view, not a copy)
+      Buffer chunk = content.slice(i*MAX_CHUNK_SIZE, MAX_CHUNK_SIZE);
 
       //Prepare and send chunk of Data
       shared_ptr<Data> data = make_shared<Data> (
@@ -196,7 +201,7 @@ void NdnProtocol::sendData(const std::string data_name, const std::string conten
       Name(data_name).appendVersion(0).appendSegment(i)
       );
       data->setFreshnessPeriod (time::seconds(100));
-      data->setContent (reinterpret_cast<const uint8_t *>(chunk.c_str()),chunk.size());
+      data->setContent (reinterpret_cast<const uint8_t *>(chunk.data()),chunk.size());
       data->setFinalBlockId (name::Component::fromSegment (chunk_count-1));
       _key_chain.sign(*data);
       _face.put (*data);
@@ -205,6 +210,20 @@ void NdnProtocol::sendData(const std::string data_name, const std::string conten
   }
 }
 
+void NdnProtocol::sendNack(const std::string data_name)
+{
+  FIFU_LOG_INFO("(NDN Protocol) Sending application Nack to " + data_name);
+
+  // Tell the consumer that no content will be available
+  shared_ptr<Data> data = make_shared<Data>();
+  data->setName(Name(data_name).appendVersion(0));
+  data->setContentType(tlv::ContentType_Nack);
+  data->setFreshnessPeriod(time::seconds(0));
+
+  _key_chain.sign(*data);
+  _face.put(*data);
+}
+
 void NdnProtocol::onRegisterFailed(const Name& prefix, const std::string& reason)
 {
   FIFU_LOG_ERROR("(NDN Protocol) ERROR (" + reason + "): Failed to register prefix in local hub's daemon.")
@@ -219,14 +238,15 @@ void NdnProtocol::onData(const Interest& interest, const Data& data)
   else
   {
     Block content = data.getContent();
-    MetaMessage* in = new MetaMessage();
+    MetaMessagePtr in = createMetaMessage();
     in->setUri(std::string(SCHEMA) + ":" + cleanName(interest.getName()));
     in->setMessageType(MESSAGE_TYPE_RESPONSE);
     in->setContent("", std::string(reinterpret_cast<const char*>(content.value()),
                                                                  content.value_size()));
+    in->setFreshness(time::duration_cast<time::seconds>(data.getFreshnessPeriod()).count());
 
     FIFU_LOG_INFO("(NDN Protocol) Received Data message to " + in->getUriString());
-    receivedMessage(in);
+    receivedMessage(std::move(in));
   }
 }
 
@@ -249,38 +269,23 @@ void NdnProtocol::onChunk(const Interest& interest, const Data& data)
   std::string content_name = cleanName(data_name);
   uint64_t last_chunk_no = data.getFinalBlockId().toSegment();
   std::cout << "Chunk " << chunk_no << "/" << last_chunk_no << std::endl;
-  auto it = _chunk_container.find(content_name);
-  if (chunk_no == 0)
-  {
-    _chunk_container[content_name] = std::string(reinterpret_cast<const char *>(data.getContent().value()),
-                                                       data.getContent().value_size());
-  }
-  else if(it != _chunk_container.end())
-  {
-    it->second += std::string(reinterpret_cast<const char *>(data.getContent().value()),
-                                                       data.getContent().value_size());
-  }
-  else
-      FIFU_LOG_ERROR("Something went wrong with the chunk container for " + content_name);
 
+  // Each chunk goes to the Core as it arrives (the Core puts the whole
+  // content together), so it can be streamed to the requester
   //TODO: For now lets assume FinalBlockId will be available in every chunk
-  it = _chunk_container.find(content_name);
-  if(chunk_no==last_chunk_no)
-  {
-    if(it != _chunk_container.end())
-    {
-      std::string content = it->second;
-      MetaMessage* in = new MetaMessage();
-      in->setUri(std::string(SCHEMA) + ":" + content_name);
-      in->setMessageType(MESSAGE_TYPE_RESPONSE);
-      in->setContent("", content);
-      FIFU_LOG_INFO("(NDN Protocol) Received Data message to " + in->getUriString());
-      receivedMessage(in);
-    }
-    else
-      FIFU_LOG_ERROR("Something went wrong with the chunk container for " + content_name);
-  }
-  else
+  MetaMessagePtr in = createMetaMessage();
+  in->setUri(std::string(SCHEMA) + ":" + content_name);
+  in->setMessageType(MESSAGE_TYPE_RESPONSE);
+  in->setContent("", std::string(reinterpret_cast<const char *>(data.getContent().value()),
+                                 data.getContent().value_size()));
+  in->setContentLength(-1);
+  in->setChunkNumber(chunk_no);
+  in->setKeepSession(chunk_no != last_chunk_no);
+  in->setFreshness(time::duration_cast<time::seconds>(data.getFreshnessPeriod()).count());
+  FIFU_LOG_INFO("(NDN Protocol) Received Data message to " + data_name.toUri());
+  receivedMessage(std::move(in));
+
+  if(chunk_no != last_chunk_no)
   {
     const Name next_chunk = data_name.getPrefix(data_name.size() - 1)
                                             .appendSegment(chunk_no + 1);
@@ -294,12 +299,23 @@ void NdnProtocol::onChunkTimeout(const Interest& interest)
   FIFU_LOG_INFO("(NDN Protocol) Chunk request timeout to " +
                 std::string(SCHEMA) + ":" + interest.getName().toUri());
   //TODO: handle retries
+  sendFailure(cleanName(interest.getName()));
 }
 
 void NdnProtocol::onTimeout(const Interest& interest)
 {
   FIFU_LOG_INFO("(NDN Protocol) Interest timeout to " +
                 std::string(SCHEMA) + ":" + interest.getName().toUri());
+  sendFailure(cleanName(interest.getName()));
+}
+
+void NdnProtocol::sendFailure(const std::string content_name)
+{
+  // Let the Core fail the requests waiting for this content
+  MetaMessagePtr in = createMetaMessage();
+  in->setUri(std::string(SCHEMA) + ":" + content_name);
+  in->setMessageType(MESSAGE_TYPE_FAILURE);
+  receivedMessage(std::move(in));
 }
 
 void NdnProtocol::startReceiver()
@@ -309,7 +325,7 @@ void NdnProtocol::startReceiver()
 
 void NdnProtocol::startSender()
 {
-  const MetaMessage* out;
+  MetaMessagePtr out;
 
   while(isRunning) {
     try {
@@ -320,12 +336,11 @@ void NdnProtocol::startSender()
 
     // Schedule message processing
     FIFU_LOG_INFO("(NDN Protocol) Scheduling next message (" + out->getUriString() + ") processing");
-    std::function<void()> func(std::bind(&NdnProtocol::processMessage, this, out));
-    _tp.schedule(std::move(func));
+    _tp.schedule([this, out = std::move(out)]() mutable { processMessage(std::move(out)); });
   }
 }
 
-void NdnProtocol::processMessage(const MetaMessage* msg)
+void NdnProtocol::processMessage(MetaMessagePtr msg)
 {
   FIFU_LOG_INFO("(NDN Protocol) Processing message (" + msg->getUriString() + ")");
   std::string uri_wo_schema = msg->getEncodedUriString().erase(0, strlen(SCHEMA) + 1);
@@ -337,5 +352,9 @@ void NdnProtocol::processMessage(const MetaMessage* msg)
   } else if(msg->getMessageType() == MESSAGE_TYPE_RESPONSE) {
     // Send Data message
     sendData(uri_wo_schema, msg->getContentData());
+
+  } else if(msg->getMessageType() == MESSAGE_TYPE_FAILURE) {
+    // Send application Nack
+    sendNack(uri_wo_schema);
   }
 }
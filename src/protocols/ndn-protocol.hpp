@@ -40,8 +40,6 @@ static const uint32_t MAX_CHUNK_SIZE = ndn::MAX_NDN_PACKET_SIZE >> 1;
 // TODO: implement concurrent requests -> static const int MAX_CONCURRENT_INTERESTS = 3;
 // TODO: implement max retries -> static const int MAX_INTEREST_RETRIES = 3;
 
-typedef std::map <std::string, std::string> ChunkContainer;
-
 class NdnProtocol : public PluginProtocol
 {
 private:
@@ -52,10 +50,9 @@ private:
   Face _face;
   KeyChain _key_chain;
   Scheduler _scheduler;
-  ChunkContainer _chunk_container;
 
 public:
-  NdnProtocol(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+  NdnProtocol(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
               ThreadPool& tp);
   ~NdnProtocol();
 
@@ -66,7 +63,7 @@ public:
   std::string installMapping(const std::string uri);
 
 protected:
-  void processMessage(const MetaMessage* msg);
+  void processMessage(MetaMessagePtr msg);
 
 private:
   void startReceiver();
@@ -76,13 +73,15 @@ private:
   void onRegisterFailed(const Name& prefix, const std::string& reason);
   void onData(const Interest& interest, const Data& data);
   void onTimeout(const Interest& interest);
+  void sendFailure(const std::string content_name);
 
   void requestChunk(const Name& interest_name);
   void onChunk(const Interest& interest, const Data& data);
   void onChunkTimeout(const Interest& interest);
 
   void sendInterest(const std::string interest_name);
-  void sendData(const std::string data_name, const std::string content);
+  void sendData(const std::string data_name, const Buffer& content);
+  void sendNack(const std::string data_name);
 };
 
 #endif /* NDN_PROTOCOL__HPP_ */
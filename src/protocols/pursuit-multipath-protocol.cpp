@@ -20,10 +20,12 @@
 #include "pursuit/chunk.hpp"
 
 #include <cryptopp/sha.h>
+#include <iomanip>
 #include <iostream>
 #include <map>
+#include <sstream>
 
-extern "C" PursuitMultipathProtocol* create_plugin_object(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+extern "C" PursuitMultipathProtocol* create_plugin_object(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                                                  ThreadPool& tp)
 {
   return new PursuitMultipathProtocol(queue, tp);
@@ -52,9 +54,10 @@ std::string createForeignUri(std::string o_uri)
 }
 ///////////////////////////////////////////////////////////////////////////////
 
-PursuitMultipathProtocol::PursuitMultipathProtocol(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+PursuitMultipathProtocol::PursuitMultipathProtocol(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                                  ThreadPool& tp)
-    : PluginProtocol(queue, tp)
+    : PluginProtocol(queue, tp),
+      _deferred(PURSUIT_MAX_DEFERRED, std::chrono::milliseconds(PURSUIT_DEFERRED_TIMEOUT))
 {
   // Blackadder running in user space
   ba = Blackadder::Instance(true);
@@ -73,6 +76,7 @@ void PursuitMultipathProtocol::start()
 
   _msg_receiver = std::thread(&PursuitMultipathProtocol::startReceiver, this);
   _msg_sender = std::thread(&PursuitMultipathProtocol::startSender, this);
+  _flusher = std::thread(&PursuitMultipathProtocol::startFlusher, this);
 }
 
 void PursuitMultipathProtocol::stop()
@@ -82,6 +86,7 @@ void PursuitMultipathProtocol::stop()
 
   _msg_receiver.detach();
   _msg_sender.join();
+  _flusher.join();
 }
 
 std::string PursuitMultipathProtocol::installMapping(const std::string uri)
@@ -100,6 +105,8 @@ std::string PursuitMultipathProtocol::installMapping(const std::string uri)
 void PursuitMultipathProtocol::startReceiver()
 {
   while(isRunning) {
+    flushDeferred();
+
     Event ev;
     ba->getEvent(ev);
     switch (ev.type) {
@@ -119,20 +126,16 @@ void PursuitMultipathProtocol::startReceiver()
           char* rfid = req.getReverseFid();
 
           PcrEntry pcr_entry(chunkuri, path_id, NULL, rfid);
-          auto pcr_it = pending_chunk_requests.find(uri);
-          if(pcr_it != pending_chunk_requests.end()) {
-            pcr_it->second.push_back(pcr_entry);
-          } else {
-            std::vector<PcrEntry> pcr_entry_vec;
-            pcr_entry_vec.push_back(pcr_entry);
-            pending_chunk_requests.emplace(uri, pcr_entry_vec);
+          {
+            std::lock_guard<std::mutex> lock(_pcr_mutex);
+            pending_chunk_requests[uri].push_back(pcr_entry);
           }
 
-          MetaMessage* in = new MetaMessage();
+          MetaMessagePtr in = createMetaMessage();
           in->setUri(uri);
           in->setMessageType(MESSAGE_TYPE_REQUEST);
 
-          receivedMessage(in);
+          admitRequest(std::move(in));
 
         } else if(type == CHUNK_RESPONSE) {
           FIFU_LOG_INFO("(PURSUIT Protocol) Received ChunkResponse for " + chararray_to_hex(ev.id));
@@ -149,17 +152,23 @@ void PursuitMultipathProtocol::startReceiver()
           }
 
           ChunkResponse resp((char*) ev.data, ev.data_len);
-          pcr_it->second._payload += std::string(reinterpret_cast<const char*>(resp.getPayload()),
-                                                 resp.getPayloadLen());
+          bool last = resp.getPayloadLen() < CHUNK_SIZE;
 
-          if(resp.getPayloadLen() < CHUNK_SIZE) {
-            MetaMessage* in = new MetaMessage();
-            in->setUri(uri);
-            in->setMessageType(MESSAGE_TYPE_RESPONSE);
-            in->setContent("application/octet-stream", pcr_it->second._payload);
-
-            FIFU_LOG_INFO("(PURSUIT Protocol) Received all ChunkResponse. Sending payload to core " + chararray_to_hex(ev.id));
-            receivedMessage(in);
+          // Each chunk goes to the Core as it arrives (the Core puts the
+          // whole content together), so it can be streamed to the requester
+          MetaMessagePtr in = createMetaMessage();
+          in->setUri(uri);
+          in->setMessageType(MESSAGE_TYPE_RESPONSE);
+          in->setContent("application/octet-stream",
+                         std::string(reinterpret_cast<const char*>(resp.getPayload()),
+                                     resp.getPayloadLen()));
+          in->setContentLength(-1);
+          in->setChunkNumber(chunk_no);
+          in->setKeepSession(!last);
+          receivedMessage(std::move(in));
+
+          if(last) {
+            FIFU_LOG_INFO("(PURSUIT Protocol) Received all ChunkResponse " + chararray_to_hex(ev.id));
 
             // UNSUBSCRIBE
             pending_requests.erase(pcr_it);
@@ -235,7 +244,7 @@ void PursuitMultipathProtocol::startReceiver()
 
 void PursuitMultipathProtocol::startSender()
 {
-  const MetaMessage* out;
+  MetaMessagePtr out;
 
   while(isRunning) {
     try {
@@ -244,70 +253,118 @@ void PursuitMultipathProtocol::startSender()
       return;
     }
 
+    flushDeferred();
+
     // Schedule message processing
     FIFU_LOG_INFO("(PURSUIT Protocol) Scheduling next message (" + out->getUriString() + ") processing");
-    std::function<void()> func(std::bind(&PursuitMultipathProtocol::processMessage, this, out));
-    _tp.schedule(std::move(func));
+    _tp.schedule([this, out = std::move(out)]() mutable { processMessage(std::move(out)); });
   }
 }
 
-void PursuitMultipathProtocol::processMessage(const MetaMessage* msg)
+// Deferred requests are otherwise only admitted when a new event or
+// message arrives, which may never happen once the traffic stops
+void PursuitMultipathProtocol::startFlusher()
+{
+  while(isRunning) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(PURSUIT_DEFERRED_TICK));
+    flushDeferred();
+  }
+}
+
+void PursuitMultipathProtocol::admitRequest(MetaMessagePtr msg)
+{
+  std::string uri = msg->getUriString();
+  switch(_deferred.admit(std::move(msg), [this](MetaMessagePtr& msg) { return tryAdmit(msg); })) {
+    case ADMISSION_DEFERRED:
+      FIFU_LOG_WARN("(PURSUIT Protocol) Overloaded. Deferring request of " + uri);
+      break;
+    case ADMISSION_DROPPED:
+      FIFU_LOG_WARN("(PURSUIT Protocol) Overloaded. Dropping request of " + uri);
+      break;
+    default:
+      break;
+  }
+}
+
+void PursuitMultipathProtocol::flushDeferred()
+{
+  _deferred.flush([this](MetaMessagePtr& msg) { return tryAdmit(msg); },
+                  [](MetaMessagePtr& msg) {
+                    FIFU_LOG_WARN("(PURSUIT Protocol) Deferred request of " + msg->getUriString() + " expired");
+                  });
+}
+
+// Never blocks the receiver: the message is kept if the Core cannot take it
+bool PursuitMultipathProtocol::tryAdmit(MetaMessagePtr& msg)
+{
+  return !isOverloaded() && tryReceivedMessage(msg);
+}
+
+void PursuitMultipathProtocol::processMessage(MetaMessagePtr msg)
 {
   FIFU_LOG_INFO("(PURSUIT Protocol) Processing message (" + msg->getUriString() + ")");
 
   if(msg->getMessageType() == MESSAGE_TYPE_REQUEST) {
     // Subscribe URI using multipath approach
-    subscribeScope(msg->getUriString().erase(0, strlen(SCHEMA) + 1), IMPLICIT_RENDEZVOUS);
-    subscribeUri(msg->getUriString().append("ffffffffffffffff"), MULTIPATH);
+    subscribeScope(msg->getUriString().substr(strlen(SCHEMA) + 1), IMPLICIT_RENDEZVOUS);
+    subscribeUri(msg->getUriString() + "ffffffffffffffff", MULTIPATH);
 
     PcrEntry pcr("", 0, NULL, NULL);
     pending_requests.emplace(msg->getUriString(), pcr);
   } else if(msg->getMessageType() == MESSAGE_TYPE_RESPONSE) {
-    // Start publishing data
-
-    auto pcr_it = pending_chunk_requests.find(msg->getUriString());
-    if(pcr_it != pending_chunk_requests.end()) {
-      for(auto const& pcr_entry : pcr_it->second) {
-        std::string content_to_send;
-        size_t requested_chunk = pcr_entry.getChunkNumber();
-        bool send_all_chunks = false;
-
-        do {
-          // If this is true, then send all chunks without
-          // being explicitly requested
-          if(requested_chunk == 0xffffffffffffffff) {
-            requested_chunk = 0;
-            send_all_chunks = true;
-          }
+    // Start publishing data. The chunk requests are taken out first, so
+    // that the receiver is not held while publishing
+    std::vector<PcrEntry> pcr_entries;
+    {
+      std::lock_guard<std::mutex> lock(_pcr_mutex);
+      auto pcr_it = pending_chunk_requests.find(msg->getUriString());
+      if(pcr_it != pending_chunk_requests.end()) {
+        pcr_entries.swap(pcr_it->second);
+        pending_chunk_requests.erase(pcr_it);
+      }
+    }
 
-          content_to_send = msg->getContentData().substr(requested_chunk * CHUNK_SIZE, CHUNK_SIZE);
+    for(auto const& pcr_entry : pcr_entries) {
+      Buffer content_to_send;
+      size_t requested_chunk = pcr_entry.getChunkNumber();
+      bool send_all_chunks = false;
+
+      do {
+        // If this is true, then send all chunks without
+        // being explicitly requested
+        if(requested_chunk == 0xffffffffffffffff) {
+          requested_chunk = 0;
+          send_all_chunks = true;
+        }
 
-          ChunkResponse resp(content_to_send.c_str(),
-                             content_to_send.size(),
-                             pcr_entry.getPathId(),
-                             1);
+        content_to_send = msg->getContentData().slice(requested_chunk * CHUNK_SIZE, CHUNK_SIZE);
 
-          char* respBytes;
-          respBytes = new char[resp.size()];
-          resp.toBytes(respBytes);
+        ChunkResponse resp(content_to_send.data(),
+                           content_to_send.size(),
+                           pcr_entry.getPathId(),
+                           1);
 
-          publish_data(pcr_entry.getChunkUri(),
-                       IMPLICIT_RENDEZVOUS,
-                       (unsigned char*) pcr_entry.getReverseFid(),
-                       (void*) respBytes,
-                       resp.size());
+        char* respBytes;
+        respBytes = new char[resp.size()];
+        resp.toBytes(respBytes);
 
-          if(send_all_chunks) {
-            requested_chunk++;
-          }
-        } while(content_to_send.size() == CHUNK_SIZE && send_all_chunks);
-      }
+        publish_data(pcr_entry.getChunkUri(),
+                     IMPLICIT_RENDEZVOUS,
+                     (unsigned char*) pcr_entry.getReverseFid(),
+                     (void*) respBytes,
+                     resp.size());
 
-      pending_chunk_requests.erase(pcr_it);
+        if(send_all_chunks) {
+          requested_chunk++;
+        }
+      } while(content_to_send.size() == CHUNK_SIZE && send_all_chunks);
     }
+  } else if(msg->getMessageType() == MESSAGE_TYPE_FAILURE) {
+    // No content will be published, so drop the chunk requests
+    FIFU_LOG_WARN("(PURSUIT Protocol) Request of " + msg->getUriString() + " failed");
+    std::lock_guard<std::mutex> lock(_pcr_mutex);
+    pending_chunk_requests.erase(msg->getUriString());
   }
-
-  delete msg;
 }
 
 int PursuitMultipathProtocol::publishScope(const std::string name, unsigned char strategy)
@@ -361,7 +418,7 @@ int PursuitMultipathProtocol::publishInfo(const std::string name, unsigned char
 
 int PursuitMultipathProtocol::publish_data(const Uri uri, unsigned char strategy, unsigned char* fid, void* content, size_t content_size)
 {
-  std::string uri_wo_schema = uri.toString().erase(0, strlen(SCHEMA) + 1);
+  std::string uri_wo_schema = uri.toString().substr(strlen(SCHEMA) + 1);
 
   ba->publish_data(hex_to_chararray(uri_wo_schema),
                    strategy,
@@ -20,8 +20,11 @@
 
 #include "../plugin-protocol.hpp"
 #include "concurrent-blocking-queue.hpp"
+#include "deferred-queue.hpp"
 #include "thread-pool.hpp"
 
+#include <chrono>
+#include <mutex>
 #include <thread>
 #include <blackadder.hpp>
 
@@ -30,6 +33,14 @@
 #define DEFAULT_SCOPE "4141414141414141"
 #define CHUNK_SIZE 4400
 
+// Requests held back while the Core is overloaded: at most this many, for
+// at most this long (in milliseconds)
+#define PURSUIT_MAX_DEFERRED 4096
+#define PURSUIT_DEFERRED_TIMEOUT 30000
+
+// Interval (in milliseconds) between attempts to admit deferred requests
+#define PURSUIT_DEFERRED_TICK 100
+
 class PcrEntry; // Class definition below
 
 class PursuitMultipathProtocol : public PluginProtocol
@@ -38,11 +49,19 @@ private:
   Blackadder *ba;
   std::thread _msg_receiver;
   std::thread _msg_sender;
+  std::thread _flusher;
+
+  // Filled by the receiver and emptied by the workers of the pool
   std::map<std::string, std::vector<PcrEntry> > pending_chunk_requests;
+  std::mutex _pcr_mutex;
+
   std::map<std::string, PcrEntry> pending_requests;
 
+  // Requests held back while the Core is overloaded
+  DeferredQueue<MetaMessagePtr> _deferred;
+
 public:
-  PursuitMultipathProtocol(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+  PursuitMultipathProtocol(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                   ThreadPool& tp);
   ~PursuitMultipathProtocol();
 
@@ -53,12 +72,18 @@ public:
   std::string installMapping(const std::string uri);
 
 protected:
-  void processMessage(const MetaMessage* msg);
+  void processMessage(MetaMessagePtr msg);
 
 private:
   void startReceiver();
   void startSender();
 
+  void startFlusher();
+
+  void admitRequest(MetaMessagePtr msg);
+  void flushDeferred();
+  bool tryAdmit(MetaMessagePtr& msg);
+
   int publishScope(const std::string name, unsigned char strategy);
   int subscribeScope(const std::string name, unsigned char strategy);
   int publishInfo(const std::string name, unsigned char strategy);
@@ -78,14 +103,11 @@ private:
   char* _rfid;
 
 public:
-  std::string _payload;
-
   PcrEntry(std::string chunk_uri, unsigned char path_id, char* fid, char* rfid)
   {
     _chunk_uri = chunk_uri;
     _path_id = path_id;
     _rfid = rfid;
-    _payload = "";
   }
 
   void setChunkUri(const std::string chunk_uri)
@@ -21,7 +21,7 @@
 #include <cryptopp/sha.h>
 #include <iostream>
 
-extern "C" PursuitProtocol* create_plugin_object(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+extern "C" PursuitProtocol* create_plugin_object(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                                                  ThreadPool& tp)
 {
   return new PursuitProtocol(queue, tp);
@@ -50,7 +50,7 @@ std::string createForeignUri(std::string o_uri)
 }
 ///////////////////////////////////////////////////////////////////////////////
 
-PursuitProtocol::PursuitProtocol(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+PursuitProtocol::PursuitProtocol(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                                  ThreadPool& tp)
     : PluginProtocol(queue, tp)
 {
@@ -100,16 +100,16 @@ void PursuitProtocol::startReceiver()
     ba->getEvent(ev);
     switch (ev.type) {
       case START_PUBLISH: {
-        MetaMessage* in = new MetaMessage();
+        MetaMessagePtr in = createMetaMessage();
         in->setUri(std::string(SCHEMA) + ":" + chararray_to_hex(ev.id));
         in->setMessageType(MESSAGE_TYPE_REQUEST);
 
         FIFU_LOG_INFO("(PURSUIT Protocol) Received START_PUBLISH to " + in->getUriString());
-        receivedMessage(in);
+        receivedMessage(std::move(in));
       } break;
 
       case PUBLISHED_DATA: {
-        MetaMessage* in = new MetaMessage();
+        MetaMessagePtr in = createMetaMessage();
         in->setUri(std::string(SCHEMA) + ":" + chararray_to_hex(ev.id));
         in->setMessageType(MESSAGE_TYPE_RESPONSE);
         in->setContent("", std::string(reinterpret_cast<const char*>(ev.data),
@@ -117,7 +117,7 @@ void PursuitProtocol::startReceiver()
         in->setKeepAlive(true);
 
         FIFU_LOG_INFO("(PURSUIT Protocol) Received PUBLISH_DATA to " + in->getUriString());
-        receivedMessage(in);
+        receivedMessage(std::move(in));
 
       } break;
     }
@@ -126,7 +126,7 @@ void PursuitProtocol::startReceiver()
 
 void PursuitProtocol::startSender()
 {
-  const MetaMessage* out;
+  MetaMessagePtr out;
 
   while(isRunning) {
     try {
@@ -137,12 +137,11 @@ void PursuitProtocol::startSender()
 
     // Schedule message processing
     FIFU_LOG_INFO("(PURSUIT Protocol) Scheduling next message (" + out->getUriString() + ") processing");
-    std::function<void()> func(std::bind(&PursuitProtocol::processMessage, this, out));
-    _tp.schedule(std::move(func));
+    _tp.schedule([this, out = std::move(out)]() mutable { processMessage(std::move(out)); });
   }
 }
 
-void PursuitProtocol::processMessage(const MetaMessage* msg)
+void PursuitProtocol::processMessage(MetaMessagePtr msg)
 {
   FIFU_LOG_INFO("(PURSUIT Protocol) Processing message (" + msg->getUriString() + ")");
 
@@ -152,10 +151,8 @@ void PursuitProtocol::processMessage(const MetaMessage* msg)
 
   } else if(msg->getMessageType() == MESSAGE_TYPE_RESPONSE) {
     // Start publishing data
-    publishUriContent(msg->getUri(), (void*) msg->getContentData().c_str(), msg->getContentData().size());
+    publishUriContent(msg->getUri(), (void*) msg->getContentData().data(), msg->getContentData().size());
   }
-
-  delete msg;
 }
 
 int PursuitProtocol::publishScope(const std::string name)
@@ -37,7 +37,7 @@ private:
   std::thread _msg_sender;
 
 public:
-  PursuitProtocol(ConcurrentBlockingQueue<const MetaMessage*>& queue,
+  PursuitProtocol(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
                   ThreadPool& tp);
   ~PursuitProtocol();
 
@@ -48,7 +48,7 @@ public:
   std::string installMapping(const std::string uri);
 
 protected:
-  void processMessage(const MetaMessage* msg);
+  void processMessage(MetaMessagePtr msg);
 
 private:
   void startReceiver();
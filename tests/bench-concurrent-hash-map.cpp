@@ -0,0 +1,143 @@
+/** Brief: Benchmark of the concurrent hash map under contention
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: bench-concurrent-hash-map [max threads (default 64)] [ops per thread (default 200000)]
+//
+// Threads look up, update and erase random keys, as the workers of the Core
+// do on the mappings and on the requests waiting for a response. The shards
+// of ConcurrentHashMap are compared with the single lock that guarded each
+// of those tables before.
+
+#include "benchmark.hpp"
+#include "concurrent-hash-map.hpp"
+
+#include <random>
+#include <thread>
+
+#define KEYS 100000
+
+// A single lock for the whole table
+template<typename K, typename V>
+class LockedHashMap
+{
+private:
+  mutable std::shared_timed_mutex _mutex;
+  std::unordered_map<K, V> _map;
+
+public:
+  bool find(const K& key, V& value) const
+  {
+    std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+
+    auto it = _map.find(key);
+    if(it == _map.end()) {
+      return false;
+    }
+
+    value = it->second;
+    return true;
+  }
+
+  template<typename F>
+  void upsert(const K& key, F&& f)
+  {
+    std::unique_lock<std::shared_timed_mutex> lock(_mutex);
+
+    auto ret = _map.emplace(std::piecewise_construct,
+                            std::forward_as_tuple(key),
+                            std::forward_as_tuple());
+    f(ret.first->second, ret.second);
+  }
+
+  template<typename F>
+  bool apply(const K& key, F&& f)
+  {
+    std::unique_lock<std::shared_timed_mutex> lock(_mutex);
+
+    auto it = _map.find(key);
+    if(it == _map.end()) {
+      return false;
+    }
+
+    if(f(it->second)) {
+      _map.erase(it);
+    }
+    return true;
+  }
+};
+
+// Every fourth operation adds a waiter and every fourth one answers it
+template<typename Map>
+static void work(Map& map, const unsigned seed, const size_t ops)
+{
+  std::minstd_rand random(seed);
+  uint64_t value;
+
+  for(size_t i = 0; i < ops; ++i) {
+    uint32_t key = random() % KEYS;
+    switch(i % 4) {
+    case 0:
+      map.upsert(key, [](uint64_t& waiters, bool) { ++waiters; });
+      break;
+    case 1:
+      map.apply(key, [](uint64_t& waiters) { return --waiters == 0; });
+      break;
+    default:
+      keep(map.find(key, value));
+    }
+  }
+}
+
+template<typename Map>
+static double run(Map& map, const int threads, const size_t ops)
+{
+  for(uint32_t key = 0; key < KEYS; ++key) {
+    map.upsert(key, [](uint64_t& waiters, bool) { waiters = 1000000; });
+  }
+
+  std::vector<std::thread> workers;
+  Stopwatch watch;
+  for(int i = 0; i < threads; ++i) {
+    workers.emplace_back(work<Map>, std::ref(map), i + 1, ops);
+  }
+  for(auto& worker : workers) {
+    worker.join();
+  }
+
+  return watch.seconds();
+}
+
+int main(int argc, char** argv)
+{
+  int max = argument(argc, argv, 1, 64);
+  size_t ops = argument(argc, argv, 2, 200000);
+
+  printf("%d hardware threads\n", std::thread::hardware_concurrency());
+  printf("%8s %14s %14s\n", "threads", "sharded", "single lock");
+
+  for(int threads = 1; threads <= max; threads *= 2) {
+    ConcurrentHashMap<uint32_t, uint64_t> sharded;
+    LockedHashMap<uint32_t, uint64_t> locked;
+
+    double s = run(sharded, threads, ops);
+    double l = run(locked, threads, ops);
+    printf("%8d %14s %14s\n", threads,
+           rate(threads * ops, s).c_str(), rate(threads * ops, l).c_str());
+  }
+
+  return 0;
+}
@@ -0,0 +1,236 @@
+/** Brief: Benchmark of the memory used to fan a large content out
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: bench-content-fanout [content size in MB (default 50)]
+//
+// A response is handed from the network to the Core, which sends it on to
+// NDN (in segments), PURSUIT and HTTP requesters, as in Core::processMessage
+// and the sendMessage path of each plugin. Each way of doing it runs in a
+// child process, whose peak RSS is reported together with the copies of
+// the whole content it made (allocations of at least 1 MB).
+//
+// "string" follows the calls made when MetaMessage kept the content in a
+// std::string returned by value; "buffer" the ones made with the shared
+// Buffer. The chunks sent by pursuit-multipath are left out, as each one
+// used to copy the whole content (over 10000 copies of 50 MB).
+
+#include "benchmark.hpp"
+#include "metamessage.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define BIG_ALLOCATION (1 << 20)
+
+// Size of NDN segments and PURSUIT chunks
+#define CHUNK_SIZE 4400
+
+static std::atomic<size_t> big_allocations(0);
+
+void* operator new(size_t size)
+{
+  if(size >= BIG_ALLOCATION) {
+    ++big_allocations;
+  }
+
+  void* ptr = malloc(size ? size : 1);
+  if(ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+// Content kept in strings, as before
+class StringMessage
+{
+private:
+  std::string _type;
+  std::string _data;
+
+public:
+  void setContent(const std::string type, const std::string data)
+  {
+    _type = type;
+    _data = data;
+  }
+
+  std::string getContentData() const
+  {
+    return _data;
+  }
+
+  std::string getContentType() const
+  {
+    return _type;
+  }
+};
+
+// What a plugin does with the content of a message it sends
+static void sendString(const std::string& scheme, const StringMessage& msg)
+{
+  if(scheme == "ndn") {
+    // sendData(name, msg->getContentData()), which takes it by value
+    std::string content = msg.getContentData();
+    for(size_t offset = 0; offset < content.size(); offset += CHUNK_SIZE) {
+      std::string chunk = content.substr(offset, CHUNK_SIZE);
+      keep(chunk);
+    }
+  } else if(scheme == "pursuit") {
+    // publishUriContent(uri, msg->getContentData().c_str(), msg->getContentData().size())
+    keep(msg.getContentData().c_str());
+    keep(msg.getContentData().size());
+  } else {
+    // MHD_create_response_from_buffer(msg->getContentData().size(),
+    //                                 msg->getContentData().c_str(), MHD_RESPMEM_MUST_COPY)
+    size_t size = msg.getContentData().size();
+    std::string copy(msg.getContentData().c_str(), size);
+    keep(copy);
+  }
+}
+
+static void fanOutString(const char* network, const size_t size,
+                         const std::vector<std::string>& schemes)
+{
+  StringMessage in;
+  in.setContent("", std::string(network, size));
+
+  std::vector<std::unique_ptr<StringMessage>> outs;
+  for(auto& scheme : schemes) {
+    std::unique_ptr<StringMessage> out(new StringMessage());
+
+    std::string contentType = in.getContentType();
+    if(contentType == "") {
+      contentType = discoverContentType(Buffer(in.getContentData()));
+    }
+
+    // No converter for the type
+    out->setContent(contentType, in.getContentData());
+    outs.push_back(std::move(out));
+  }
+
+  // Plugins take the messages from their queues
+  for(size_t i = 0; i < schemes.size(); ++i) {
+    sendString(schemes[i], *outs[i]);
+  }
+}
+
+static void sendBuffer(const std::string& scheme, const MetaMessage& msg)
+{
+  const Buffer& content = msg.getContentData();
+  if(scheme == "ndn") {
+    for(size_t offset = 0; offset < content.size(); offset += CHUNK_SIZE) {
+      Buffer chunk = content.slice(offset, CHUNK_SIZE);
+      keep(chunk);
+    }
+  } else if(scheme == "pursuit") {
+    keep(content.data());
+    keep(content.size());
+  } else {
+    // The response holds on to the bytes until MHD is done with them
+    Buffer response(content);
+    keep(response);
+  }
+}
+
+static void fanOutBuffer(const char* network, const size_t size,
+                         const std::vector<std::string>& schemes)
+{
+  MetaMessagePtr in = createMetaMessage();
+  in->setContent("", Buffer(network, size));
+
+  std::vector<MetaMessagePtr> outs;
+  for(size_t i = 0; i < schemes.size(); ++i) {
+    MetaMessagePtr out = createMetaMessage();
+
+    std::string contentType = in->getContentType();
+    if(contentType == "") {
+      contentType = discoverContentType(in->getContentData());
+    }
+
+    out->setContent(contentType, in->getContentData());
+    outs.push_back(std::move(out));
+  }
+
+  for(size_t i = 0; i < schemes.size(); ++i) {
+    sendBuffer(schemes[i], *outs[i]);
+  }
+}
+
+struct Result
+{
+  size_t copies;
+  double seconds;
+};
+
+template<typename F>
+static void run(const char* name, const size_t size, F&& fanOut)
+{
+  Result* result = static_cast<Result*>(mmap(NULL, sizeof(Result), PROT_READ | PROT_WRITE,
+                                             MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+
+  pid_t pid = fork();
+  if(pid == 0) {
+    // Bytes as received from the network
+    char* network = static_cast<char*>(malloc(size));
+    memset(network, 'a', size);
+    memcpy(network, "%PDF-1.4\n", 9);
+
+    std::vector<std::string> schemes = {"ndn", "pursuit", "http"};
+    big_allocations = 0;
+    Stopwatch watch;
+    fanOut(network, size, schemes);
+    result->seconds = watch.seconds();
+    result->copies = big_allocations;
+
+    free(network);
+    _exit(0);
+  }
+
+  int status;
+  struct rusage usage;
+  wait4(pid, &status, 0, &usage);
+
+  printf("%-8s %8zu %12.0f %10.1f\n", name, result->copies, usage.ru_maxrss / 1024.0,
+         result->seconds * 1e3);
+  munmap(result, sizeof(Result));
+}
+
+int main(int argc, char** argv)
+{
+  size_t size = argument(argc, argv, 1, 50) << 20;
+
+  printf("%zu MB sent to ndn, pursuit and http\n", size >> 20);
+  printf("%-8s %8s %12s %10s\n", "content", "copies", "peak RSS MB", "time (ms)");
+  run("string", size, fanOutString);
+  run("buffer", size, fanOutBuffer);
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+/** Brief: Benchmark of the escaping of strings
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: bench-escape [milliseconds per case (default 200)]
+//
+// Throughput (in MB of input per second) of escapeString() and
+// unescapeString() on inputs of several sizes: URI-like text that needs
+// little escaping, binary data, and fully escaped strings. The functions
+// of ostringstream and replace() used before are measured the same way.
+
+#include "benchmark.hpp"
+#include "utils.hpp"
+#include "legacy/utils.hpp"
+
+#include <random>
+
+template<typename F>
+static std::string throughput(const std::string& input, const double seconds, F&& f)
+{
+  size_t calls = 0;
+  Stopwatch watch;
+  do {
+    keep(f(input));
+    ++calls;
+  } while(watch.seconds() < seconds);
+
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.1f", calls * input.size() / watch.seconds() / 1e6);
+  return buf;
+}
+
+static std::string text(const size_t size)
+{
+  static const std::string words[] = {"fixp", "index.html", "information", "centric",
+                                      "network", "path/to", "q=1", "a b", "2016"};
+  std::mt19937 random(7);
+  std::string ret;
+  while(ret.size() < size) {
+    ret += words[random() % 9];
+    ret += '-';
+  }
+
+  return ret.substr(0, size);
+}
+
+static std::string binary(const size_t size)
+{
+  std::mt19937 random(7);
+  std::string ret(size, '\0');
+  for(auto& c : ret) {
+    c = (char) random();
+  }
+
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  double seconds = argument(argc, argv, 1, 200) / 1e3;
+
+  printf("MB/s %27s %10s %10s %10s\n", "escape", "(before)", "unescape", "(before)");
+  for(size_t size : {64, 1024, 65536}) {
+    std::string inputs[] = {text(size), binary(size), escapeString(binary(size / 3))};
+    const char* names[] = {"text", "binary", "escaped"};
+
+    for(int i = 0; i < 3; ++i) {
+      const std::string& input = inputs[i];
+      printf("%-8s %6zu bytes %10s %10s %10s %10s\n", names[i], input.size(),
+             throughput(input, seconds, [](const std::string& s) { return escapeString(s); }).c_str(),
+             throughput(input, seconds, [](const std::string& s) { return legacy::escapeString(s); }).c_str(),
+             throughput(input, seconds, [](const std::string& s) { return unescapeString(s); }).c_str(),
+             throughput(input, seconds, [](const std::string& s) { return legacy::unescapeString(s); }).c_str());
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,150 @@
+/** Brief: Benchmark of the upstream HTTP client
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: bench-http-client [max workers (default 8)] [fetches per worker (default 500)]
+//
+// Workers fetch a page from an origin server on the loopback interface, one
+// fetch after the other, as the workers of the HTTP plugin do for the
+// requests they get. Reports fetches per second, the p50 and p99 latency
+// of each fetch and the connections the origin accepted, for HttpClient
+// and for a new easy handle per fetch (as requestHttpUri did before).
+
+#include "benchmark.hpp"
+#include "origin.hpp"
+#include "logger.hpp"
+#include "protocols/http/http-client.hpp"
+
+#include <future>
+
+static size_t append(const void* content, const size_t size, const size_t nmemb, std::string* data)
+{
+  data->append((const char*) content, size * nmemb);
+  return size * nmemb;
+}
+
+// As requestHttpUri did before
+static bool fetchWithNewHandle(const std::string& uri, std::string& type, std::string& content)
+{
+  CURL* curl = curl_easy_init();
+  if(!curl) {
+    return false;
+  }
+
+  curl_easy_setopt(curl, CURLOPT_URL, uri.c_str());
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, append);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &content);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+
+  CURLcode res = curl_easy_perform(curl);
+  if(res != CURLE_OK) {
+    curl_easy_cleanup(curl);
+    return false;
+  }
+
+  char* t;
+  if(curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &t) == CURLE_OK && t) {
+    type = t;
+    type = type.substr(0, type.find(";"));
+  }
+
+  curl_easy_cleanup(curl);
+  return true;
+}
+
+static bool fetchWithClient(HttpClient& client, const std::string& uri,
+                            std::string& type, std::string& content)
+{
+  std::promise<bool> done;
+  client.get(uri, 30000, [&](HttpResult& result) {
+               type = result.type;
+               content = std::move(result.content);
+               done.set_value(result.ok);
+             });
+
+  return done.get_future().get();
+}
+
+template<typename F>
+static void run(const char* name, const int workers, const size_t fetches, F&& fetch)
+{
+  Origin origin(std::string(8192, 'x'), "text/html");
+  std::string uri = origin.uri("/index.html");
+
+  std::vector<Latencies> latencies(workers);
+  std::atomic<size_t> failures(0);
+  std::vector<std::thread> threads;
+
+  Stopwatch watch;
+  for(int w = 0; w < workers; ++w) {
+    threads.emplace_back([&, w]() {
+                           latencies[w].reserve(fetches);
+                           for(size_t i = 0; i < fetches; ++i) {
+                             std::string type, content;
+                             uint64_t start = Stopwatch::now();
+                             if(!fetch(uri, type, content) || content.size() != 8192) {
+                               ++failures;
+                             }
+                             latencies[w].add(Stopwatch::now() - start);
+                           }
+                         });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+  double seconds = watch.seconds();
+
+  Latencies all;
+  for(auto& l : latencies) {
+    all.add(l);
+  }
+
+  printf("%7d %-12s %11s %9.1f %9.1f %12zu %9zu\n", workers, name,
+         rate(workers * fetches, seconds).c_str(),
+         all.percentile(50) / 1e3, all.percentile(99) / 1e3, origin.getConnections(),
+         failures.load());
+}
+
+int main(int argc, char** argv)
+{
+  int max = argument(argc, argv, 1, 8);
+  size_t fetches = argument(argc, argv, 2, 500);
+
+  // Every request is logged at INFO
+  Logger::getInstance().setLevel(LOG_LEVEL_WARN);
+  curl_global_init(CURL_GLOBAL_ALL);
+
+  printf("%d hardware threads, latencies in us\n", std::thread::hardware_concurrency());
+  printf("%7s %-12s %11s %9s %9s %12s %9s\n", "workers", "client", "fetches", "p50", "p99",
+         "connections", "failures");
+
+  for(int workers = 1; workers <= max; workers *= 2) {
+    {
+      HttpClient client;
+      client.start();
+      run("HttpClient", workers, fetches,
+          [&client](const std::string& uri, std::string& type, std::string& content) {
+            return fetchWithClient(client, uri, type, content);
+          });
+      client.stop();
+    }
+
+    run("new handle", workers, fetches, fetchWithNewHandle);
+  }
+
+  curl_global_cleanup();
+  return 0;
+}
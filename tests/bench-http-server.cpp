@@ -0,0 +1,257 @@
+/** Brief: Load test of an HTTP server over keep-alive connections
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: bench-http-server [uri (default http://127.0.0.1:8000/)] [connections (default 64)]
+//                          [seconds (default 5)] [threads (default 1)]
+//
+// Loads the server in the manner of wrk: each thread keeps its share of the
+// connections open (keep-alive) and sends the next GET on a connection as
+// soon as the response to the previous one arrived. Reports responses per
+// second, their p50, p99 and p99.9 latency and the errors (responses other
+// than 2xx and connections closed by the server).
+//
+// The URI names the server and the content to get, e.g. with FIXP started as
+//   fixp -o http.port=8000 -o http.threads=4
+// and some content it can serve. If nothing listens at the URI, the load
+// goes to an origin on the loopback interface instead, which shows what
+// the load generator itself can do.
+
+#include "benchmark.hpp"
+#include "origin.hpp"
+#include "uri.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <netdb.h>
+#include <sys/epoll.h>
+
+struct Connection
+{
+  int socket;
+  std::string received;
+  uint64_t sent;
+};
+
+struct Load
+{
+  Latencies latencies;
+  size_t errors = 0;
+};
+
+// Connected socket, or -1
+static int connectTo(const struct addrinfo* addr)
+{
+  int s = socket(addr->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if(s < 0) {
+    return -1;
+  }
+
+  if(connect(s, addr->ai_addr, addr->ai_addrlen) != 0) {
+    close(s);
+    return -1;
+  }
+
+  int on = 1;
+  setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+  return s;
+}
+
+// Size of the first response received whole (or 0), and whether it is a 2xx
+static size_t parseResponse(const std::string& received, bool& ok)
+{
+  size_t end = received.find("\r\n\r\n");
+  if(end == std::string::npos) {
+    return 0;
+  }
+  end += 4;
+
+  std::string headers = received.substr(0, end);
+  std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+  ok = headers.compare(0, 10, "http/1.1 2") == 0 || headers.compare(0, 10, "http/1.0 2") == 0;
+
+  size_t pos = headers.find("\r\ncontent-length:");
+  if(pos != std::string::npos) {
+    size_t size = end + strtoul(headers.c_str() + pos + strlen("\r\ncontent-length:"), NULL, 10);
+    return received.size() >= size ? size : 0;
+  }
+
+  if(headers.find("\r\ntransfer-encoding: chunked") != std::string::npos) {
+    size_t last = received.find("\r\n0\r\n\r\n", end - 2);
+    return last != std::string::npos ? last + 7 : 0;
+  }
+
+  // Neither, so the body ends with the connection (and it is not kept open)
+  ok = false;
+  return received.size();
+}
+
+static void load(const struct addrinfo* addr, const std::string& request,
+                 const int connections, const double seconds, Load& result)
+{
+  int epoll = epoll_create1(EPOLL_CLOEXEC);
+  std::vector<Connection> conns(connections);
+
+  auto start = [&](const int i) {
+    conns[i].socket = connectTo(addr);
+    conns[i].received.clear();
+    conns[i].sent = Stopwatch::now();
+    if(conns[i].socket < 0) {
+      return false;
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u32 = i;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, conns[i].socket, &ev);
+    return send(conns[i].socket, request.data(), request.size(), MSG_NOSIGNAL) > 0;
+  };
+
+  auto reopen = [&](const int i) {
+    ++result.errors;
+    close(conns[i].socket);
+    start(i);
+  };
+
+  for(int i = 0; i < connections; ++i) {
+    start(i);
+  }
+
+  struct epoll_event events[64];
+  char buf[16384];
+  Stopwatch watch;
+  while(watch.seconds() < seconds) {
+    int n = epoll_wait(epoll, events, 64, 100);
+    for(int e = 0; e < n; ++e) {
+      Connection& conn = conns[events[e].data.u32];
+
+      ssize_t r = recv(conn.socket, buf, sizeof(buf), 0);
+      if(r <= 0) {
+        if(r < 0 && errno == EAGAIN) {
+          continue;
+        }
+        reopen(events[e].data.u32);
+        continue;
+      }
+      conn.received.append(buf, r);
+
+      bool ok = false;
+      size_t size = parseResponse(conn.received, ok);
+      if(size == 0) {
+        continue;
+      }
+
+      uint64_t now = Stopwatch::now();
+      result.latencies.add(now - conn.sent);
+      if(!ok) {
+        ++result.errors;
+      }
+
+      // Responses are not pipelined, so nothing follows this one
+      conn.received.clear();
+      conn.sent = now;
+      if(send(conn.socket, request.data(), request.size(), MSG_NOSIGNAL) <= 0) {
+        reopen(events[e].data.u32);
+      }
+    }
+  }
+
+  for(auto& conn : conns) {
+    if(conn.socket >= 0) {
+      close(conn.socket);
+    }
+  }
+  close(epoll);
+}
+
+int main(int argc, char** argv)
+{
+  Uri uri(argc > 1 ? argv[1] : "http://127.0.0.1:8000/");
+  int connections = argument(argc, argv, 2, 64);
+  double seconds = argument(argc, argv, 3, 5);
+  int threads = argument(argc, argv, 4, 1);
+
+  std::unique_ptr<Origin> origin;
+  struct addrinfo* addr = NULL;
+  for(int attempt = 0; attempt < 2; ++attempt) {
+    std::string authority = uri.getAuthority();
+    size_t colon = authority.rfind(':');
+    std::string host = authority.substr(0, colon);
+    std::string port = colon != std::string::npos ? authority.substr(colon + 1) : "80";
+
+    struct addrinfo hints = {};
+    hints.ai_socktype = SOCK_STREAM;
+    int s = -1;
+    if(getaddrinfo(host.c_str(), port.c_str(), &hints, &addr) == 0) {
+      s = connectTo(addr);
+    }
+    if(s >= 0) {
+      close(s);
+      break;
+    }
+
+    if(addr) {
+      freeaddrinfo(addr);
+      addr = NULL;
+    }
+    if(origin) {
+      fprintf(stderr, "Unable to reach the origin on the loopback interface\n");
+      return 1;
+    }
+
+    printf("Nothing listens at %s, loading an origin on the loopback interface\n",
+           uri.toString().c_str());
+    origin.reset(new Origin(std::string(8192, 'x'), "text/html"));
+    uri = Uri(origin->uri("/index.html"));
+  }
+
+  std::string path = uri.getPath().empty() ? "/" : uri.getPath();
+  if(!uri.getQuery().empty()) {
+    path += "?" + uri.getQuery();
+  }
+  std::string request = "GET " + path + " HTTP/1.1\r\n"
+                        "Host: " + uri.getAuthority() + "\r\n"
+                        "\r\n";
+
+  std::vector<Load> loads(threads);
+  std::vector<std::thread> loaders;
+  for(int t = 0; t < threads; ++t) {
+    int share = connections / threads + (t < connections % threads ? 1 : 0);
+    loaders.emplace_back(load, addr, std::cref(request), share, seconds, std::ref(loads[t]));
+  }
+  for(auto& loader : loaders) {
+    loader.join();
+  }
+  freeaddrinfo(addr);
+
+  Load all;
+  for(auto& l : loads) {
+    all.latencies.add(l.latencies);
+    all.errors += l.errors;
+  }
+
+  printf("%d hardware threads, latencies in us\n", std::thread::hardware_concurrency());
+  printf("%7s %11s %10s %11s %9s %9s %9s %8s\n", "threads", "connections", "responses",
+         "rate", "p50", "p99", "p99.9", "errors");
+  printf("%7d %11d %10zu %11s %9.1f %9.1f %9.1f %8zu\n", threads, connections,
+         all.latencies.size(), rate(all.latencies.size(), seconds).c_str(),
+         all.latencies.percentile(50) / 1e3, all.latencies.percentile(99) / 1e3,
+         all.latencies.percentile(99.9) / 1e3, all.errors);
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+/** Brief: Benchmark of the logger
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: bench-logger [max threads (default 16)] [messages per thread (default 100000)] [log file (default /dev/null)]
+//
+// Threads log INFO messages like the ones the Core logs for each message,
+// with INFO enabled (the default level). Reports the messages logged per
+// second, i.e., until the last FIFU_LOG_INFO returned, and for the
+// background writer also until all of them were written. The logger that
+// wrote each message to std::clog under a mutex is measured the same way.
+// The log goes to the given file, which is truncated.
+
+#include "benchmark.hpp"
+#include "logger.hpp"
+#include "legacy/logger.hpp"
+
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+
+template<typename F>
+static double logFrom(const int threads, const size_t messages, F&& log)
+{
+  std::vector<std::thread> workers;
+  Stopwatch watch;
+  for(int t = 0; t < threads; ++t) {
+    workers.emplace_back([&log, messages]() {
+                           std::string uri = "http://www.example.org/page/";
+                           for(size_t i = 0; i < messages; ++i) {
+                             log(uri, i);
+                           }
+                         });
+  }
+  for(auto& worker : workers) {
+    worker.join();
+  }
+
+  return watch.seconds();
+}
+
+int main(int argc, char** argv)
+{
+  int max = argument(argc, argv, 1, 16);
+  size_t messages = argument(argc, argv, 2, 100000);
+  const char* path = argc > 3 ? argv[3] : "/dev/null";
+
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0 || dup2(fd, STDERR_FILENO) < 0) {
+    perror(path);
+    return 1;
+  }
+  close(fd);
+
+  printf("%d hardware threads, INFO messages per second to %s\n",
+         std::thread::hardware_concurrency(), path);
+  printf("%8s %12s %12s %12s\n", "threads", "logged", "written", "mutex+clog");
+
+  for(int threads = 1; threads <= max; threads *= 2) {
+    size_t n = threads * messages;
+
+    Stopwatch watch;
+    double logged = logFrom(threads, messages, [](const std::string& uri, const size_t i) {
+                              FIFU_LOG_INFO("(Core) Processing message (" + uri + std::to_string(i) + ")");
+                            });
+    Logger::getInstance().flush();
+    double written = watch.seconds();
+
+    double legacy = logFrom(threads, messages, [](const std::string& uri, const size_t i) {
+                              LEGACY_FIFU_LOG_INFO("(Core) Processing message (" + uri + std::to_string(i) + ")");
+                            });
+
+    printf("%8d %12s %12s %12s\n", threads, rate(n, logged).c_str(), rate(n, written).c_str(),
+           rate(n, legacy).c_str());
+  }
+
+  return 0;
+}
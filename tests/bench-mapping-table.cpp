@@ -0,0 +1,141 @@
+/** Brief: Benchmark of the URI mapping table as it grows
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: bench-mapping-table [max exponent (default 6)] [lookups (default 100000)]
+//
+// Fills the table with 10^3 up to 10^<max exponent> mappings and measures
+// the cost of each operation at every size. 10^7 mappings take a few GB.
+//
+// The linear scan of the mappings done by Core::createMapping before the
+// table existed (a std::map of foreign to original URIs) is measured up to
+// 10^6 mappings, the largest size it finishes at in reasonable time.
+
+#include "benchmark.hpp"
+#include "mapping-table.hpp"
+
+#include <map>
+#include <random>
+
+static std::string original(const size_t i)
+{
+  return "http://www.example" + std::to_string(i % 1000) + ".org/page/" + std::to_string(i);
+}
+
+static std::string foreign(const size_t i)
+{
+  return "ndn:/fixp/www.example" + std::to_string(i % 1000) + ".org/page/" + std::to_string(i);
+}
+
+// Foreign URIs of the original URI, as found before the table existed
+static size_t scan(const std::map<Uri, Uri>& mappings, const Uri& o_uri)
+{
+  size_t found = 0;
+  for(auto& item : mappings) {
+    if(item.second == o_uri) {
+      ++found;
+    }
+  }
+
+  return found;
+}
+
+int main(int argc, char** argv)
+{
+  int max = argument(argc, argv, 1, 6);
+  size_t lookups = argument(argc, argv, 2, 100000);
+
+  printf("%10s %12s %12s %12s %12s %12s %10s\n", "mappings", "insert", "getOriginal",
+         "getForeign", "getOrInst.", "legacy scan", "RSS (MB)");
+
+  MappingTable table;
+  std::map<Uri, Uri> legacy;
+  std::mt19937_64 random(42);
+  size_t size = 0;
+
+  for(int e = 3; e <= max; ++e) {
+    size_t target = 1;
+    for(int i = 0; i < e; ++i) {
+      target *= 10;
+    }
+
+    // Only the new mappings are inserted at each size
+    std::vector<std::pair<Uri, Uri>> batch;
+    for(size_t i = size; i < target; ++i) {
+      batch.emplace_back(Uri(foreign(i)), Uri(original(i)));
+    }
+
+    Stopwatch watch;
+    for(auto& item : batch) {
+      table.insert(item.first, item.second);
+    }
+    double insert = watch.seconds();
+
+    if(e <= 6) {
+      for(auto& item : batch) {
+        legacy.emplace(item.first, item.second);
+      }
+    }
+    size_t inserted = batch.size();
+    size = target;
+    batch.clear();
+
+    // Random existing URIs, parsed beforehand
+    std::vector<Uri> f_uris, o_uris;
+    for(size_t i = 0; i < lookups; ++i) {
+      size_t n = random() % size;
+      f_uris.emplace_back(foreign(n));
+      o_uris.emplace_back(original(n));
+    }
+
+    watch.restart();
+    Uri o_uri;
+    for(auto& f_uri : f_uris) {
+      keep(table.getOriginal(f_uri, o_uri));
+    }
+    double getOriginal = watch.seconds();
+
+    watch.restart();
+    for(auto& uri : o_uris) {
+      keep(table.getForeign(uri));
+    }
+    double getForeign = watch.seconds();
+
+    watch.restart();
+    for(auto& uri : o_uris) {
+      keep(table.getOrInstallForeign(uri, {"ndn"},
+                                     [](const std::string&) { return Uri(); }));
+    }
+    double getOrInstall = watch.seconds();
+
+    std::string scanned = "-";
+    if(e <= 6) {
+      size_t n = std::max<size_t>(1, std::min<size_t>(lookups, 100000000 / size));
+      watch.restart();
+      for(size_t i = 0; i < n; ++i) {
+        keep(scan(legacy, o_uris[i]));
+      }
+      scanned = rate(n, watch.seconds());
+    }
+
+    printf("%10zu %12s %12s %12s %12s %12s %10.0f\n", size,
+           rate(inserted, insert).c_str(),
+           rate(lookups, getOriginal).c_str(), rate(lookups, getForeign).c_str(),
+           rate(lookups, getOrInstall).c_str(), scanned.c_str(), peakRssMb());
+  }
+
+  return 0;
+}
@@ -0,0 +1,85 @@
+/** Brief: Benchmark of the metadata accessors of MetaMessage
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: bench-metadata [calls (default 1000000)]
+//
+// Cost of each accessor called by the Core and the plugins on every
+// message, with the typed fields and with the std::map of strings used
+// before. Messages are a chunked response (all fields set) and a request
+// that only has its type set (the others are missing).
+
+#include "benchmark.hpp"
+#include "legacy/metadata.hpp"
+
+template<typename F>
+static double nsPerCall(const size_t calls, F&& f)
+{
+  Stopwatch watch;
+  for(size_t i = 0; i < calls; ++i) {
+    keep(f());
+  }
+
+  return watch.seconds() * 1e9 / calls;
+}
+
+template<typename Message>
+static void fill(Message& response, Message& request)
+{
+  response.setMessageType(MESSAGE_TYPE_RESPONSE);
+  response.setKeepSession(true);
+  response.setChunkNumber(42);
+  request.setMessageType(MESSAGE_TYPE_REQUEST);
+}
+
+int main(int argc, char** argv)
+{
+  size_t calls = argument(argc, argv, 1, 1000000);
+
+  MetaMessage response, request;
+  legacy::Metadata legacy_response, legacy_request;
+  fill(response, request);
+  fill(legacy_response, legacy_request);
+
+  // Copied into every message sent out by the Core
+  MetaMessage out;
+  legacy::Metadata legacy_out;
+
+  printf("%-26s %10s %10s\n", "ns per call", "typed", "map");
+  printf("%-26s %10.1f %10.1f\n", "getMessageType",
+         nsPerCall(calls, [&]() { return response.getMessageType(); }),
+         nsPerCall(calls, [&]() { return legacy_response.getMessageType(); }));
+  printf("%-26s %10.1f %10.1f\n", "getKeepSession",
+         nsPerCall(calls, [&]() { return response.getKeepSession(); }),
+         nsPerCall(calls, [&]() { return legacy_response.getKeepSession(); }));
+  printf("%-26s %10.1f %10.1f\n", "getChunkNumber",
+         nsPerCall(calls, [&]() { return response.getChunkNumber(); }),
+         nsPerCall(calls, [&]() { return legacy_response.getChunkNumber(); }));
+  printf("%-26s %10.1f %10.1f\n", "getKeepSession (missing)",
+         nsPerCall(calls, [&]() { return request.getKeepSession(); }),
+         nsPerCall(calls, [&]() { return legacy_request.getKeepSession(); }));
+  printf("%-26s %10.1f %10.1f\n", "getChunkNumber (missing)",
+         nsPerCall(calls, [&]() { return request.getChunkNumber(); }),
+         nsPerCall(calls, [&]() { return legacy_request.getChunkNumber(); }));
+  printf("%-26s %10.1f %10.1f\n", "setMetadata(getMetadata())",
+         nsPerCall(calls, [&]() { out.setMetadata(response.getMetadata()); return &out; }),
+         nsPerCall(calls, [&]() {
+                     legacy_out.setMetadata(legacy_response.getMetadata());
+                     return &legacy_out;
+                   }));
+
+  return 0;
+}
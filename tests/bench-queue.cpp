@@ -0,0 +1,92 @@
+/** Brief: Benchmark of the concurrent blocking queue
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: bench-queue [max threads on each side (default 32)] [elements per producer (default 200000)]
+//
+// Producers push timestamps that consumers pop, at 1 to <max threads>
+// producers and as many consumers. Reports the elements moved per second
+// and the time each one spent in the queue. The queue of a std::queue
+// behind a mutex used before is measured the same way.
+
+#include "benchmark.hpp"
+#include "concurrent-blocking-queue.hpp"
+#include "legacy/concurrent-blocking-queue.hpp"
+
+#include <thread>
+
+// Consumers stop at the first 0 they pop
+template<typename Queue>
+static std::string run(const int threads, const size_t elements)
+{
+  Queue queue;
+  std::vector<Latencies> latencies(threads);
+  std::vector<std::thread> consumers, producers;
+
+  Stopwatch watch;
+  for(int i = 0; i < threads; ++i) {
+    consumers.emplace_back([&queue, &latencies, elements, i]() {
+                             latencies[i].reserve(elements);
+                             for(uint64_t start; (start = queue.pop()) != 0; ) {
+                               latencies[i].add(Stopwatch::now() - start);
+                             }
+                           });
+    producers.emplace_back([&queue, elements]() {
+                             for(size_t n = 0; n < elements; ++n) {
+                               queue.push(Stopwatch::now());
+                             }
+                           });
+  }
+
+  for(auto& producer : producers) {
+    producer.join();
+  }
+  for(int i = 0; i < threads; ++i) {
+    queue.push(0);
+  }
+  for(auto& consumer : consumers) {
+    consumer.join();
+  }
+  double seconds = watch.seconds();
+
+  Latencies all;
+  for(auto& l : latencies) {
+    all.add(l);
+  }
+
+  char buf[96];
+  snprintf(buf, sizeof(buf), "%11s %9.1f %9.1f", rate(threads * elements, seconds).c_str(),
+           all.percentile(50) / 1e3, all.percentile(99) / 1e3);
+  return buf;
+}
+
+int main(int argc, char** argv)
+{
+  int max = argument(argc, argv, 1, 32);
+  size_t elements = argument(argc, argv, 2, 200000);
+
+  printf("%d hardware threads, latencies in us\n", std::thread::hardware_concurrency());
+  printf("%8s   %11s %9s %9s   %11s %9s %9s\n", "threads", "ring", "p50", "p99",
+         "legacy", "p50", "p99");
+
+  for(int threads = 1; threads <= max; threads *= 2) {
+    printf("%4dx%-3d   %s   %s\n", threads, threads,
+           run<ConcurrentBlockingQueue<uint64_t>>(threads, elements).c_str(),
+           run<legacy::ConcurrentBlockingQueue<uint64_t>>(threads, elements).c_str());
+  }
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+/** Brief: Benchmark of the thread pool
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: bench-thread-pool [max workers (default 64)] [jobs (default 200000)]
+//
+// Measures, at 1 to <max workers> workers, the jobs run per second and the
+// time from scheduling to running each job, for:
+//  - external jobs, scheduled from outside the pool (as the Core and the
+//    plugins do), with at most IN_FLIGHT of them waiting at any time (the
+//    jobs per second are also given when all of them are scheduled at once);
+//  - nested jobs, each scheduling two more until the given number ran.
+// The pool of a single locked queue of std::function used before is
+// measured the same way.
+
+#include "benchmark.hpp"
+#include "thread-pool.hpp"
+#include "legacy/thread-pool.hpp"
+
+#include <thread>
+
+#define IN_FLIGHT 64
+
+struct Run
+{
+  std::vector<uint64_t> latencies;
+  std::atomic<size_t> scheduled;
+  std::atomic<size_t> done;
+
+  Run(const size_t jobs)
+    : latencies(jobs), scheduled(0), done(0)
+  { }
+};
+
+template<typename Pool>
+static void nested(Pool& pool, Run& run, const uint64_t start)
+{
+  size_t i = run.done.fetch_add(1);
+  run.latencies[i] = Stopwatch::now() - start;
+
+  for(int n = 0; n < 2; ++n) {
+    if(run.scheduled.fetch_add(1) < run.latencies.size()) {
+      pool.schedule([&pool, &run, now = Stopwatch::now()]() { nested(pool, run, now); });
+    }
+  }
+}
+
+template<typename Pool>
+static void wait(Run& run)
+{
+  while(run.done.load() < run.latencies.size()) {
+    std::this_thread::yield();
+  }
+}
+
+template<typename Pool>
+static std::string burst(const int workers, const size_t jobs)
+{
+  Pool pool(workers);
+  Run run(jobs);
+
+  Stopwatch watch;
+  for(size_t i = 0; i < jobs; ++i) {
+    pool.schedule([&run]() { run.done.fetch_add(1); });
+  }
+  wait<Pool>(run);
+
+  return rate(jobs, watch.seconds());
+}
+
+template<typename Pool>
+static std::string external(const int workers, const size_t jobs)
+{
+  Pool pool(workers);
+  Run run(jobs);
+
+  Stopwatch watch;
+  for(size_t i = 0; i < jobs; ++i) {
+    while(i - run.done.load() >= IN_FLIGHT) {
+      std::this_thread::yield();
+    }
+
+    pool.schedule([&run, i, start = Stopwatch::now()]() {
+                    run.latencies[i] = Stopwatch::now() - start;
+                    run.done.fetch_add(1);
+                  });
+  }
+  wait<Pool>(run);
+  double seconds = watch.seconds();
+
+  Latencies latencies;
+  for(auto ns : run.latencies) {
+    latencies.add(ns);
+  }
+
+  char buf[96];
+  snprintf(buf, sizeof(buf), "%11s %8.1f %8.1f", rate(jobs, seconds).c_str(),
+           latencies.percentile(50) / 1e3, latencies.percentile(99) / 1e3);
+  return buf;
+}
+
+template<typename Pool>
+static std::string fork(const int workers, const size_t jobs)
+{
+  Pool pool(workers);
+  Run run(jobs);
+
+  Stopwatch watch;
+  run.scheduled = 1;
+  pool.schedule([&pool, &run, now = Stopwatch::now()]() { nested(pool, run, now); });
+  wait<Pool>(run);
+  double seconds = watch.seconds();
+
+  Latencies latencies;
+  for(auto ns : run.latencies) {
+    latencies.add(ns);
+  }
+
+  char buf[96];
+  snprintf(buf, sizeof(buf), "%11s %8.1f %8.1f", rate(jobs, seconds).c_str(),
+           latencies.percentile(50) / 1e3, latencies.percentile(99) / 1e3);
+  return buf;
+}
+
+int main(int argc, char** argv)
+{
+  int max = argument(argc, argv, 1, 64);
+  size_t jobs = argument(argc, argv, 2, 200000);
+
+  printf("%d hardware threads, latencies in us\n", std::thread::hardware_concurrency());
+  printf("%7s %-8s %11s   %11s %8s %8s   %11s %8s %8s\n", "workers", "pool", "at once",
+         "external", "p50", "p99", "nested", "p50", "p99");
+
+  for(int workers = 1; workers <= max; workers *= 2) {
+    printf("%7d %-8s %11s   %s   %s\n", workers, "stealing",
+           burst<ThreadPool>(workers, jobs).c_str(),
+           external<ThreadPool>(workers, jobs).c_str(), fork<ThreadPool>(workers, jobs).c_str());
+    printf("%7s %-8s %11s   %s   %s\n", "", "legacy",
+           burst<legacy::ThreadPool>(workers, jobs).c_str(),
+           external<legacy::ThreadPool>(workers, jobs).c_str(),
+           fork<legacy::ThreadPool>(workers, jobs).c_str());
+  }
+
+  return 0;
+}
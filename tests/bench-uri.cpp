@@ -0,0 +1,86 @@
+/** Brief: Benchmark of the URI parser
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: bench-uri [rounds over the links (default 200)]
+//
+// Parses the links in data/links.txt (taken from real web pages and from
+// the other networks), and resolves them against the page they were found
+// in, as the HTML converter does. The regex-based parser used before is
+// measured the same way.
+
+#include "benchmark.hpp"
+#include "uri.hpp"
+#include "legacy/uri.hpp"
+
+#include <fstream>
+
+template<typename U>
+static double parse(const std::vector<std::string>& links, const size_t rounds)
+{
+  Stopwatch watch;
+  for(size_t r = 0; r < rounds; ++r) {
+    for(auto& link : links) {
+      U uri(link);
+      keep(uri);
+    }
+  }
+
+  return watch.seconds();
+}
+
+template<typename U>
+static double resolve(const std::vector<std::string>& links, const size_t rounds)
+{
+  U base("http://www.example.org/dir/sub/page.html");
+
+  Stopwatch watch;
+  for(size_t r = 0; r < rounds; ++r) {
+    for(auto& link : links) {
+      U uri(base, U(link));
+      keep(uri);
+    }
+  }
+
+  return watch.seconds();
+}
+
+int main(int argc, char** argv)
+{
+  size_t rounds = argument(argc, argv, 1, 200);
+
+  std::vector<std::string> links;
+  std::ifstream file(DATA_DIR "/links.txt");
+  for(std::string line; std::getline(file, line); ) {
+    links.push_back(line);
+  }
+  if(links.empty()) {
+    fprintf(stderr, "Unable to read " DATA_DIR "/links.txt\n");
+    return 1;
+  }
+
+  size_t n = links.size() * rounds;
+  printf("%zu links, URIs per second\n", links.size());
+  printf("%-10s %12s %12s\n", "", "hand-written", "regex");
+  printf("%-10s %12s %12s\n", "parse",
+         rate(n, parse<Uri>(links, rounds)).c_str(),
+         rate(n, parse<legacy::Uri>(links, rounds)).c_str());
+  printf("%-10s %12s %12s\n", "resolve",
+         rate(n, resolve<Uri>(links, rounds)).c_str(),
+         rate(n, resolve<legacy::Uri>(links, rounds)).c_str());
+
+  return 0;
+}
@@ -0,0 +1,164 @@
+/** Brief: Helpers shared by the benchmarks
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARK__HPP_
+#define BENCHMARK__HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+// Usage example:
+// '''
+//  (...)
+//
+//  Stopwatch watch;
+//  for(size_t i = 0; i < n; ++i) {
+//    keep(work(i));               // Not optimized away
+//  }
+//  printf("%s\n", rate(n, watch.seconds()).c_str());
+//
+//  Latencies latencies;
+//  latencies.add(Stopwatch::now() - start);
+//  printf("p99 %.1f us\n", latencies.percentile(99) / 1e3);
+//
+//  (...)
+// '''
+//
+// Benchmarks print plain tables to stdout. They take their sizes from the
+// command line (see each one), with defaults that run in a few seconds.
+//
+
+class Stopwatch
+{
+private:
+  std::chrono::steady_clock::time_point _start;
+
+public:
+  Stopwatch()
+    : _start(std::chrono::steady_clock::now())
+  { }
+
+  // Nanoseconds since some fixed point
+  static uint64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  void restart()
+  {
+    _start = std::chrono::steady_clock::now();
+  }
+
+  double seconds() const
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+  }
+};
+
+// Samples (in nanoseconds) of the latency of some operation
+class Latencies
+{
+private:
+  std::vector<uint64_t> _samples;
+  bool _sorted = true;
+
+public:
+  void reserve(const size_t n)
+  {
+    _samples.reserve(n);
+  }
+
+  void add(const uint64_t ns)
+  {
+    _samples.push_back(ns);
+    _sorted = false;
+  }
+
+  void add(const Latencies& other)
+  {
+    _samples.insert(_samples.end(), other._samples.begin(), other._samples.end());
+    _sorted = false;
+  }
+
+  size_t size() const
+  {
+    return _samples.size();
+  }
+
+  // Percentile in [0, 100]
+  uint64_t percentile(const double p)
+  {
+    if(_samples.empty()) {
+      return 0;
+    }
+
+    if(!_sorted) {
+      std::sort(_samples.begin(), _samples.end());
+      _sorted = true;
+    }
+
+    size_t i = (size_t) (p / 100 * (_samples.size() - 1) + 0.5);
+    return _samples[std::min(i, _samples.size() - 1)];
+  }
+};
+
+// Keeps the compiler from optimizing away the computation of a value
+template<typename T>
+inline void keep(const T& value)
+{
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+// Operations per second, with a metric prefix
+inline std::string rate(const double ops, const double seconds)
+{
+  char buf[32];
+  double r = seconds > 0 ? ops / seconds : 0;
+  if(r >= 1e9) {
+    snprintf(buf, sizeof(buf), "%.2fG/s", r / 1e9);
+  } else if(r >= 1e6) {
+    snprintf(buf, sizeof(buf), "%.2fM/s", r / 1e6);
+  } else if(r >= 1e3) {
+    snprintf(buf, sizeof(buf), "%.2fk/s", r / 1e3);
+  } else {
+    snprintf(buf, sizeof(buf), "%.2f/s", r);
+  }
+
+  return buf;
+}
+
+// Peak resident set size of the process, in megabytes
+inline double peakRssMb()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0;
+}
+
+// Numeric command line argument, or the default if not given
+inline long argument(const int argc, char** argv, const int i, const long value)
+{
+  return argc > i ? strtol(argv[i], NULL, 10) : value;
+}
+
+#endif /* BENCHMARK__HPP_ */
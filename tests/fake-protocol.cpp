@@ -0,0 +1,32 @@
+/** Brief: Protocol plugin driven by the tests of the Core (one per scheme)
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fake-protocol.hpp"
+
+static FakeProtocol* instance = nullptr;
+
+extern "C" PluginProtocol* create_plugin_object(ConcurrentBlockingQueue<MetaMessagePtr>& queue,
+                                                ThreadPool& tp)
+{
+  instance = new FakeProtocol(FAKE_SCHEME, queue, tp);
+  return instance;
+}
+
+extern "C" FakeProtocol* fake_protocol_instance()
+{
+  return instance;
+}
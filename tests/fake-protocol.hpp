@@ -0,0 +1,198 @@
+/** Brief: Protocol plugin driven by the tests of the Core
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FAKE_PROTOCOL__HPP_
+#define FAKE_PROTOCOL__HPP_
+
+#include "plugin-protocol.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <dlfcn.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Message sent by the Core to the plugin
+struct Sent
+{
+  std::string uri;
+  MetadataMessageType type;
+  std::string content;
+  size_t chunk;
+  bool keepSession;
+};
+
+// Usage example:
+// '''
+//  (...)
+//
+//  core.loadProtocol(dir + "/fake-protocol-a.so");
+//  FakeProtocol* a = FakeProtocol::get(dir + "/fake-protocol-a.so");
+//
+//  a->request(f_uri);                  // As if a client asked for it
+//  CHECK(a->waitFor(1));               // The response of the Core
+//  CHECK_EQUAL(a->sent()[0].content, "...");
+//
+//  (...)
+// '''
+//
+// Each scheme is a shared object of its own (fake-protocol-<scheme>.so),
+// loaded by the Core as any other plugin. The tests inject messages as if
+// they came from the network of the plugin and check what the Core sent to
+// it.
+//
+class FakeProtocol : public PluginProtocol
+{
+private:
+  std::string _scheme;
+  bool _streaming;
+  size_t _mappings;
+  std::thread _sender;
+
+  std::mutex _mutex;
+  std::condition_variable _cond;
+  std::vector<Sent> _sent;
+
+public:
+  FakeProtocol(const std::string scheme, ConcurrentBlockingQueue<MetaMessagePtr>& queue,
+               ThreadPool& tp)
+    : PluginProtocol(queue, tp), _scheme(scheme), _streaming(false), _mappings(0)
+  { }
+
+  // The plugin loaded by the Core from the given path (shared objects
+  // loaded twice share their state)
+  static FakeProtocol* get(const std::string path)
+  {
+    void* handle = dlopen(path.c_str(), RTLD_LAZY);
+    FakeProtocol* (*instance)() = (FakeProtocol* (*)()) dlsym(handle, "fake_protocol_instance");
+    return instance ? instance() : nullptr;
+  }
+
+  // Rejects the option fail=1, as a plugin does with invalid values
+  bool configure(const std::map<std::string, std::string>& options)
+  {
+    auto it = options.find("fail");
+    return it == options.end() || it->second != "1";
+  }
+
+  bool running() const
+  {
+    return isRunning;
+  }
+
+  void start()
+  {
+    isRunning = true;
+    _sender = std::thread([this]() {
+                            while(isRunning) {
+                              try {
+                                processMessage(_msg_to_send.pop());
+                              } catch(...) {
+                                return;
+                              }
+                            }
+                          });
+  }
+
+  void stop()
+  {
+    isRunning = false;
+    _msg_to_send.stop();
+    if(_sender.joinable()) {
+      _sender.join();
+    }
+  }
+
+  std::string getProtocol() const
+  {
+    return _scheme;
+  }
+
+  std::string installMapping(const std::string)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _scheme + "://fake/" + std::to_string(++_mappings);
+  }
+
+  bool supportsStreaming() const
+  {
+    return _streaming;
+  }
+
+  void setStreaming(const bool streaming)
+  {
+    _streaming = streaming;
+  }
+
+  void request(const std::string uri)
+  {
+    MetaMessagePtr msg = createMetaMessage();
+    msg->setUri(uri);
+    msg->setMessageType(MESSAGE_TYPE_REQUEST);
+    receivedMessage(std::move(msg));
+  }
+
+  // Chunk number -1 for a whole content
+  void respond(const std::string uri, const std::string content, const long freshness = 60,
+               const size_t chunk = -1, const bool last = true)
+  {
+    MetaMessagePtr msg = createMetaMessage();
+    msg->setUri(uri);
+    msg->setMessageType(MESSAGE_TYPE_RESPONSE);
+    msg->setContent("text/plain", Buffer(content));
+    msg->setFreshness(freshness);
+    msg->setChunkNumber(chunk);
+    msg->setKeepSession(!last);
+    receivedMessage(std::move(msg));
+  }
+
+  void fail(const std::string uri)
+  {
+    MetaMessagePtr msg = createMetaMessage();
+    msg->setUri(uri);
+    msg->setMessageType(MESSAGE_TYPE_FAILURE);
+    receivedMessage(std::move(msg));
+  }
+
+  // Waits until the Core sent at least n messages. Returns false on timeout
+  bool waitFor(const size_t n, const std::chrono::milliseconds timeout = std::chrono::seconds(5))
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _cond.wait_for(lock, timeout, [this, n]() { return _sent.size() >= n; });
+  }
+
+  std::vector<Sent> sent()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _sent;
+  }
+
+protected:
+  void processMessage(MetaMessagePtr msg)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _sent.push_back({msg->getUriString(), msg->getMessageType(),
+                     msg->getContentData().toString(), msg->getChunkNumber(),
+                     msg->getKeepSession()});
+    _cond.notify_all();
+  }
+};
+
+#endif /* FAKE_PROTOCOL__HPP_ */
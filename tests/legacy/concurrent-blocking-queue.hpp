@@ -0,0 +1,93 @@
+/** Brief: Concurrent Blocking Queue, as it was before the bounded ring
+ *  (kept to compare against in the benchmarks)
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LEGACY_CONCURRENT_BLOCKING_QUEUE__HPP_
+#define LEGACY_CONCURRENT_BLOCKING_QUEUE__HPP_
+
+#include <atomic>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+
+namespace legacy {
+
+template<typename T>
+class ConcurrentBlockingQueue
+{
+private:
+  std::atomic<bool> _interrupted;
+
+  std::queue<T> _queue;
+  mutable std::mutex _mutex;
+  std::condition_variable _notifier;
+
+public:
+  ConcurrentBlockingQueue()
+    : _interrupted(false)
+  { }
+
+  ~ConcurrentBlockingQueue()
+  { }
+
+  void stop()
+  {
+    _interrupted = true;
+    _notifier.notify_all();
+  }
+
+  bool empty() const
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _queue.empty();
+  }
+
+  size_t size() const
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _queue.size();
+  }
+
+  void push(const T& v)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _queue.push(v);
+
+    lock.unlock();
+    _notifier.notify_one();
+  }
+
+  // Returns by value, as the reference returned originally was left dangling
+  T pop()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _notifier.wait(lock, [this](){return !_queue.empty() || _interrupted;});
+    if(_interrupted) {
+      throw std::exception();
+    }
+
+    T v = std::move(_queue.front());
+    _queue.pop();
+
+    return v;
+  }
+};
+
+} // namespace legacy
+
+#endif /* LEGACY_CONCURRENT_BLOCKING_QUEUE__HPP_ */
+
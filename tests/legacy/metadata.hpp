@@ -0,0 +1,124 @@
+/** Brief: Metadata of a MetaMessage, as kept before the typed fields
+ *  (kept to compare against in the benchmarks)
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LEGACY_METADATA__HPP_
+#define LEGACY_METADATA__HPP_
+
+#include "metamessage.hpp"
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace legacy {
+
+// Accessors of the metadata, as in MetaMessage
+class Metadata
+{
+private:
+  std::map<std::string, std::string> _metadata;
+
+public:
+  std::map<std::string, std::string> getMetadata() const
+  {
+    return _metadata;
+  }
+
+  void setMetadata(const std::map<std::string, std::string> metadata)
+  {
+    _metadata = metadata;
+  }
+
+  bool getKeepSession() const
+  {
+    std::string value;
+    try {
+      value = _metadata.at("KeepSession");
+    } catch(const std::out_of_range& e) {
+      return false;
+    }
+
+    if(value == "True") {
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  void setKeepSession(const bool val)
+  {
+    if(val) {
+      _metadata.emplace("KeepSession", "True");
+    } else {
+      _metadata.emplace("KeepSession", "False");
+    }
+  }
+
+  size_t getChunkNumber() const
+  {
+    std::string value;
+    try {
+      value = _metadata.at("ChunkNumber");
+    } catch(const std::out_of_range& e) {
+      return -1;
+    }
+
+    return atoll(value.c_str());
+  }
+
+  void setChunkNumber(const size_t val)
+  {
+    _metadata.emplace("ChunkNumber", std::to_string(val));
+  }
+
+  MetadataMessageType getMessageType() const
+  {
+    std::string messageType;
+
+    try {
+      messageType = _metadata.at("MessageType");
+    } catch(const std::out_of_range& e) {
+      return MESSAGE_TYPE_UNKNOWN;
+    }
+
+    std::vector<std::string> typeStr = {"request", "response", "indication"};
+    for(size_t i = 0; i < typeStr.size(); ++i) {
+      if(messageType == typeStr[i]) {
+        return (MetadataMessageType) i;
+      }
+    }
+
+    return MESSAGE_TYPE_UNKNOWN;
+  }
+
+  void setMessageType(const MetadataMessageType type)
+  {
+    if(type == MESSAGE_TYPE_REQUEST
+       || type == MESSAGE_TYPE_RESPONSE
+       || type == MESSAGE_TYPE_INDICATION) {
+      std::vector<std::string> typeStr = {"request", "response", "indication"};
+
+      _metadata.emplace("MessageType", typeStr[type]);
+    }
+  }
+};
+
+} // namespace legacy
+
+#endif /* LEGACY_METADATA__HPP_ */
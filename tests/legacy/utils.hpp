@@ -0,0 +1,74 @@
+/** Brief: String utilities, as they were before the lookup tables
+ *  (kept to compare against in the tests and benchmarks)
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LEGACY_UTILS__HPP_
+#define LEGACY_UTILS__HPP_
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <stdlib.h>
+#include <string>
+
+namespace legacy {
+
+inline
+std::string trimString(std::string str)
+{
+  str.erase(str.begin(), std::find_if(str.begin(), str.end(), std::not1(std::ptr_fun<int, int>(std::isspace))));
+  str.erase(std::find_if(str.rbegin(), str.rend(), std::not1(std::ptr_fun<int, int>(std::isspace))).base(), str.end());
+
+  return str;
+}
+
+inline
+std::string escapeString(const std::string str)
+{
+  std::ostringstream ret;
+  ret << std::setfill('0') << std::hex;
+
+  for(const char& c : str) {
+    if(std::isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~') {
+      ret << std::nouppercase << c;
+    } else {
+      ret << std::uppercase << '%' << std::setw(2) << int((unsigned char) c);
+    }
+  }
+
+  return ret.str();
+}
+
+inline
+std::string unescapeString(const std::string str)
+{
+  std::string res = str;
+
+  // Unescape string
+  size_t pos = 0;
+  while((pos = res.find("%", pos)) != std::string::npos) {
+    res.replace(pos, 3, 1, (char)(int)strtol(res.substr(pos + 1, 2).c_str(), NULL, 16));
+  }
+
+  return res;
+}
+
+} // namespace legacy
+
+#endif /* LEGACY_UTILS__HPP_ */
@@ -0,0 +1,197 @@
+/** Brief: HTTP origin server on the loopback interface, for the tests and benchmarks
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ORIGIN__HPP_
+#define ORIGIN__HPP_
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <map>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Usage example:
+// '''
+//  (...)
+//
+//  Origin origin("<html></html>", "text/html");
+//  std::string uri = origin.uri("/index.html");   // http://localhost:<port>/index.html
+//
+//  (...)
+//
+//  origin.getConnections();                        // Connections accepted so far
+//
+//  (...)
+// '''
+//
+// Answers every GET with the same content, keeping connections open for
+// further requests (HTTP/1.1 keep-alive). A single thread serves all
+// connections.
+//
+class Origin
+{
+private:
+  std::string _response;
+
+  int _socket;
+  int _wakeup;
+  int _port;
+  std::thread _server;
+
+  std::atomic<bool> _isRunning;
+  std::atomic<size_t> _connections;
+  std::atomic<size_t> _requests;
+
+public:
+  Origin(const std::string& content, const std::string& type)
+    : _socket(-1), _wakeup(eventfd(0, EFD_CLOEXEC)), _port(0),
+      _isRunning(true), _connections(0), _requests(0)
+  {
+    _response = "HTTP/1.1 200 OK\r\n"
+                "Content-Type: " + type + "; charset=utf-8\r\n"
+                "Content-Length: " + std::to_string(content.size()) + "\r\n"
+                "Cache-Control: max-age=60\r\n"
+                "\r\n" + content;
+
+    _socket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int on = 1;
+    setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if(bind(_socket, (struct sockaddr*) &addr, len) != 0
+       || listen(_socket, 1024) != 0
+       || getsockname(_socket, (struct sockaddr*) &addr, &len) != 0) {
+      perror("origin");
+      return;
+    }
+    _port = ntohs(addr.sin_port);
+
+    _server = std::thread(&Origin::serve, this);
+  }
+
+  ~Origin()
+  {
+    _isRunning = false;
+    uint64_t one = 1;
+    if(write(_wakeup, &one, sizeof(one)) < 0) {
+      perror("origin");
+    }
+
+    if(_server.joinable()) {
+      _server.join();
+    }
+    close(_socket);
+    close(_wakeup);
+  }
+
+  std::string uri(const std::string& path) const
+  {
+    return "http://localhost:" + std::to_string(_port) + path;
+  }
+
+  size_t getConnections() const
+  {
+    return _connections;
+  }
+
+  size_t getRequests() const
+  {
+    return _requests;
+  }
+
+  Origin(const Origin&) = delete;
+  void operator=(const Origin&) = delete;
+
+private:
+  void serve()
+  {
+    // Requests received so far on each connection
+    std::map<int, std::string> clients;
+    std::vector<struct pollfd> fds;
+
+    while(_isRunning) {
+      fds.clear();
+      fds.push_back({_wakeup, POLLIN, 0});
+      fds.push_back({_socket, POLLIN, 0});
+      for(auto& client : clients) {
+        fds.push_back({client.first, POLLIN, 0});
+      }
+
+      if(poll(fds.data(), fds.size(), -1) < 0) {
+        continue;
+      }
+
+      if(fds[1].revents & POLLIN) {
+        int client = accept4(_socket, NULL, NULL, SOCK_CLOEXEC);
+        if(client >= 0) {
+          int on = 1;
+          setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+          clients[client];
+          ++_connections;
+        }
+      }
+
+      for(size_t i = 2; i < fds.size(); ++i) {
+        if(fds[i].revents != 0 && !receive(fds[i].fd, clients[fds[i].fd])) {
+          close(fds[i].fd);
+          clients.erase(fds[i].fd);
+        }
+      }
+    }
+
+    for(auto& client : clients) {
+      close(client.first);
+    }
+  }
+
+  // Answers the requests received whole. Returns false once the
+  // connection is closed
+  bool receive(const int client, std::string& request)
+  {
+    char buf[4096];
+    ssize_t n = recv(client, buf, sizeof(buf), 0);
+    if(n <= 0) {
+      return false;
+    }
+    request.append(buf, n);
+
+    // Requests carry no body
+    size_t end;
+    while((end = request.find("\r\n\r\n")) != std::string::npos) {
+      request.erase(0, end + 4);
+      ++_requests;
+
+      if(send(client, _response.data(), _response.size(), MSG_NOSIGNAL) < 0) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+#endif /* ORIGIN__HPP_ */
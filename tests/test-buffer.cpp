@@ -0,0 +1,86 @@
+/** Brief: Tests of the shared content buffers
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "metamessage.hpp"
+
+TEST(shares_bytes_between_copies)
+{
+  std::string data(1000, 'x');
+  const char* bytes = data.data();
+
+  Buffer buffer(std::move(data));
+  CHECK(buffer.data() == bytes);
+
+  Buffer copy = buffer;
+  CHECK(copy.data() == buffer.data());
+  CHECK_EQUAL(buffer.storage().use_count(), long(2));
+}
+
+TEST(slices_within_bounds)
+{
+  Buffer buffer(std::string("0123456789"));
+
+  Buffer chunk = buffer.slice(2, 3);
+  CHECK_EQUAL(chunk.toString(), "234");
+  CHECK(chunk.data() == buffer.data() + 2);
+  CHECK_EQUAL(chunk.offset(), size_t(2));
+
+  CHECK_EQUAL(buffer.slice(8, 100).toString(), "89");
+  CHECK(buffer.slice(20, 5).empty());
+  CHECK_EQUAL(chunk.slice(1).toString(), "34");
+  CHECK_EQUAL(chunk.slice(1).offset(), size_t(3));
+}
+
+TEST(keeps_bytes_while_any_view_is_left)
+{
+  Buffer chunk;
+  std::weak_ptr<const std::string> storage;
+  {
+    Buffer buffer(std::string("0123456789"));
+    storage = buffer.storage();
+    chunk = buffer.slice(5);
+  }
+
+  CHECK(!storage.expired());
+  CHECK_EQUAL(chunk.toString(), "56789");
+
+  chunk = Buffer();
+  CHECK(storage.expired());
+  CHECK_EQUAL(chunk.size(), size_t(0));
+  CHECK(chunk.data() != nullptr);
+}
+
+TEST(fans_content_out_without_copies)
+{
+  MetaMessagePtr in = createMetaMessage();
+  in->setContent("text/plain", Buffer(std::string(1 << 20, 'y')));
+
+  std::vector<MetaMessagePtr> outs;
+  for(int i = 0; i < 3; ++i) {
+    MetaMessagePtr out = createMetaMessage();
+    out->setContent(in->getContentType(), in->getContentData());
+    outs.push_back(std::move(out));
+  }
+
+  for(auto& out : outs) {
+    CHECK(out->getContentData().data() == in->getContentData().data());
+  }
+  CHECK_EQUAL(in->getContentData().storage().use_count(), long(4));
+}
+
+TEST_MAIN()
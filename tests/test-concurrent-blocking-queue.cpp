@@ -0,0 +1,236 @@
+/** Brief: Tests of the concurrent blocking queue
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "concurrent-blocking-queue.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+TEST(pops_in_push_order)
+{
+  ConcurrentBlockingQueue<int> queue(16);
+  for(int i = 0; i < 10; ++i) {
+    CHECK(queue.push(i));
+  }
+  CHECK_EQUAL(queue.size(), size_t(10));
+
+  for(int i = 0; i < 10; ++i) {
+    CHECK_EQUAL(queue.pop(), i);
+  }
+  CHECK(queue.empty());
+
+  int value;
+  CHECK(!queue.try_pop(value));
+}
+
+TEST(fails_to_try_push_when_full)
+{
+  ConcurrentBlockingQueue<int> queue(3);
+  CHECK_EQUAL(queue.capacity(), size_t(4));
+
+  for(int i = 0; i < 4; ++i) {
+    CHECK(queue.try_push(i));
+  }
+  CHECK(!queue.try_push(4));
+
+  int value;
+  CHECK(queue.try_pop(value));
+  CHECK_EQUAL(value, 0);
+  CHECK(queue.try_push(4));
+}
+
+TEST(keeps_move_only_elements)
+{
+  ConcurrentBlockingQueue<std::unique_ptr<int>> queue(2);
+  std::unique_ptr<int> value(new int(1));
+  CHECK(queue.try_push(std::move(value)));
+
+  // Nothing is moved out of an element that could not be pushed
+  std::unique_ptr<int> other(new int(2));
+  CHECK(queue.try_push(std::unique_ptr<int>(new int(3))));
+  CHECK(!queue.try_push(std::move(other)));
+  CHECK(other != nullptr);
+
+  CHECK_EQUAL(*queue.pop(), 1);
+  CHECK_EQUAL(*queue.pop(), 3);
+}
+
+TEST(stops_blocked_consumers)
+{
+  ConcurrentBlockingQueue<int> queue(4);
+  std::atomic<int> stopped(0);
+
+  std::vector<std::thread> consumers;
+  for(int i = 0; i < 3; ++i) {
+    consumers.emplace_back([&]() {
+                             try {
+                               queue.pop();
+                             } catch(...) {
+                               ++stopped;
+                             }
+                           });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  queue.stop();
+  for(auto& consumer : consumers) {
+    consumer.join();
+  }
+  CHECK_EQUAL(stopped.load(), 3);
+}
+
+TEST(stops_blocked_producers)
+{
+  ConcurrentBlockingQueue<int> queue(2);
+  queue.push(1);
+  queue.push(2);
+
+  bool pushed = true;
+  std::thread producer([&]() { pushed = queue.push(3); });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  queue.stop();
+  producer.join();
+  CHECK(!pushed);
+}
+
+TEST(unblocks_producers_as_consumers_pop)
+{
+  ConcurrentBlockingQueue<int> queue(2);
+  std::thread producer([&]() {
+                         for(int i = 0; i < 1000; ++i) {
+                           queue.push(i);
+                         }
+                       });
+
+  bool ordered = true;
+  for(int i = 0; i < 1000; ++i) {
+    ordered = ordered && queue.pop() == i;
+  }
+  producer.join();
+  CHECK(ordered);
+}
+
+TEST(becomes_overloaded_between_watermarks)
+{
+  ConcurrentBlockingQueue<int> queue(16);
+  queue.setWatermarks(8, 4);
+
+  for(int i = 0; i < 7; ++i) {
+    queue.push(i);
+  }
+  CHECK(!queue.isOverloaded());
+  queue.push(7);
+  CHECK(queue.isOverloaded());
+
+  // Stays overloaded until the depth drops to the low watermark
+  for(int i = 0; i < 3; ++i) {
+    queue.pop();
+  }
+  CHECK(queue.isOverloaded());
+  queue.pop();
+  CHECK(!queue.isOverloaded());
+}
+
+TEST(goes_through_overload_cycles)
+{
+  ConcurrentBlockingQueue<int> queue(16);
+  queue.setWatermarks(8, 4);
+
+  for(int cycle = 0; cycle < 3; ++cycle) {
+    // Rising from the low watermark, not overloaded until the high one
+    while(queue.size() < 7) {
+      queue.push(0);
+      CHECK(!queue.isOverloaded());
+    }
+    queue.push(0);
+    CHECK(queue.isOverloaded());
+
+    // Falling from the high watermark, overloaded until the low one
+    while(queue.size() > 5) {
+      queue.pop();
+      CHECK(queue.isOverloaded());
+    }
+    queue.pop();
+    CHECK(!queue.isOverloaded());
+  }
+}
+
+TEST(keeps_watermarks_within_capacity)
+{
+  ConcurrentBlockingQueue<int> queue(16);
+  queue.setWatermarks(100, 200);
+  CHECK_EQUAL(queue.getHighWatermark(), queue.capacity());
+  CHECK_EQUAL(queue.getLowWatermark(), queue.capacity());
+}
+
+TEST(delivers_each_element_once_to_many_consumers)
+{
+  ConcurrentBlockingQueue<int> queue(64);
+  const int producers = 4, consumers = 4, count = 50000;
+
+  // Each consumer stops at the first 0 it pops
+  std::vector<std::vector<int>> popped(consumers);
+  std::vector<std::thread> threads;
+  for(int c = 0; c < consumers; ++c) {
+    threads.emplace_back([&queue, &popped, c]() {
+                           for(int v; (v = queue.pop()) != 0; ) {
+                             popped[c].push_back(v);
+                           }
+                         });
+  }
+
+  std::vector<std::thread> pushers;
+  for(int p = 0; p < producers; ++p) {
+    pushers.emplace_back([&queue, p]() {
+                           for(int i = 1; i <= count; ++i) {
+                             queue.push(p * count + i);
+                           }
+                         });
+  }
+  for(auto& pusher : pushers) {
+    pusher.join();
+  }
+  for(int c = 0; c < consumers; ++c) {
+    queue.push(0);
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<int> seen(producers * count + 1, 0);
+  bool ordered = true;
+  for(auto& values : popped) {
+    std::vector<int> last(producers, 0);
+    for(auto v : values) {
+      ++seen[v];
+
+      // Elements of the same producer keep their order
+      int p = (v - 1) / count;
+      ordered = ordered && v > last[p];
+      last[p] = v;
+    }
+  }
+
+  CHECK(std::count(seen.begin() + 1, seen.end(), 1) == producers * count);
+  CHECK(ordered);
+}
+
+TEST_MAIN()
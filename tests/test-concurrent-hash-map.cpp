@@ -0,0 +1,102 @@
+/** Brief: Tests of the concurrent hash map
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "concurrent-hash-map.hpp"
+
+#include <thread>
+
+TEST(inserts_finds_and_erases)
+{
+  ConcurrentHashMap<std::string, int> map;
+  CHECK(map.insert("a", 1));
+  CHECK(!map.insert("a", 2));
+
+  int value = 0;
+  CHECK(map.find("a", value));
+  CHECK_EQUAL(value, 1);
+  CHECK(map.contains("a"));
+  CHECK(!map.find("b", value));
+
+  CHECK(map.erase("a"));
+  CHECK(!map.erase("a"));
+  CHECK_EQUAL(map.size(), size_t(0));
+}
+
+TEST(upserts_and_applies_in_place)
+{
+  ConcurrentHashMap<std::string, int> map;
+  bool created = false;
+  map.upsert("a", [&created](int& value, bool inserted) { created = inserted; value = 1; });
+  CHECK(created);
+  map.upsert("a", [&created](int& value, bool inserted) { created = inserted; ++value; });
+  CHECK(!created);
+
+  bool visited = map.visit("a", [](const int& value) { CHECK_EQUAL(value, 2); });
+  CHECK(visited);
+  CHECK(!map.apply("b", [](int&) { return true; }));
+  CHECK(map.apply("a", [](int& value) { return --value == 0; }));
+  CHECK(map.contains("a"));
+  CHECK(map.apply("a", [](int& value) { return --value == 0; }));
+  CHECK(!map.contains("a"));
+}
+
+TEST(applies_to_all_entries)
+{
+  ConcurrentHashMap<int, int> map;
+  for(int i = 0; i < 1000; ++i) {
+    map.insert(i, i);
+  }
+
+  size_t visited = 0;
+  map.applyAll([&visited](const int& key, int& value) {
+                 ++visited;
+                 return key != value || key % 2 == 0;
+               });
+  CHECK_EQUAL(visited, size_t(1000));
+  CHECK_EQUAL(map.size(), size_t(500));
+  CHECK(!map.contains(10));
+  CHECK(map.contains(11));
+}
+
+TEST(updates_concurrently_without_losing_any)
+{
+  ConcurrentHashMap<int, int> map;
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 8; ++t) {
+    threads.emplace_back([&map, t]() {
+                           for(int i = 0; i < 20000; ++i) {
+                             map.upsert(i % 100, [](int& value, bool) { ++value; });
+                             map.insert(100000 * (t + 1) + i, i);
+                           }
+                         });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+
+  int total = 0;
+  for(int i = 0; i < 100; ++i) {
+    int value = 0;
+    map.find(i, value);
+    total += value;
+  }
+  CHECK_EQUAL(total, 8 * 20000);
+  CHECK_EQUAL(map.size(), size_t(100 + 8 * 20000));
+}
+
+TEST_MAIN()
@@ -0,0 +1,204 @@
+/** Brief: Tests of the content cache
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "content-cache.hpp"
+#include "metrics.hpp"
+
+#include <thread>
+
+static bool cached(ContentCache& cache, const std::string uri, std::string& content)
+{
+  std::string type;
+  Buffer data;
+  uint64_t version;
+  if(!cache.get(Uri(uri), type, data, version)) {
+    return false;
+  }
+
+  content = data.toString();
+  return true;
+}
+
+static bool cached(ContentCache& cache, const std::string uri)
+{
+  std::string content;
+  return cached(cache, uri, content);
+}
+
+TEST(answers_what_was_put)
+{
+  ContentCache cache(1024);
+  uint64_t version = cache.put(Uri("http://example.org/a"), "text/plain", Buffer("alpha"),
+                               std::chrono::seconds(60));
+  CHECK(version != 0);
+
+  std::string type;
+  Buffer data;
+  uint64_t got;
+  CHECK(cache.get(Uri("http://example.org/a"), type, data, got));
+  CHECK_EQUAL(type, std::string("text/plain"));
+  CHECK_EQUAL(data.toString(), std::string("alpha"));
+  CHECK_EQUAL(got, version);
+  CHECK(!cached(cache, "http://example.org/missing"));
+  CHECK_EQUAL(cache.size(), size_t(5));
+}
+
+TEST(evicts_least_recently_used_by_bytes)
+{
+  ContentCache cache(10);
+  cache.put(Uri("http://example.org/1"), "text/plain", Buffer("1111"), std::chrono::seconds(60));
+  cache.put(Uri("http://example.org/2"), "text/plain", Buffer("2222"), std::chrono::seconds(60));
+
+  // 1 is now more recently used than 2
+  CHECK(cached(cache, "http://example.org/1"));
+
+  cache.put(Uri("http://example.org/3"), "text/plain", Buffer("3333"), std::chrono::seconds(60));
+  CHECK(cached(cache, "http://example.org/1"));
+  CHECK(!cached(cache, "http://example.org/2"));
+  CHECK(cached(cache, "http://example.org/3"));
+  CHECK_EQUAL(cache.size(), size_t(8));
+
+  // Makes room for a bigger content, however many entries it takes
+  cache.put(Uri("http://example.org/4"), "text/plain", Buffer("4444444444"),
+            std::chrono::seconds(60));
+  CHECK(!cached(cache, "http://example.org/1"));
+  CHECK(!cached(cache, "http://example.org/3"));
+  CHECK(cached(cache, "http://example.org/4"));
+  CHECK_EQUAL(cache.size(), size_t(10));
+
+  // Contents bigger than the cache are not kept, nor evict anything
+  CHECK_EQUAL(cache.put(Uri("http://example.org/5"), "text/plain", Buffer("55555555555"),
+                        std::chrono::seconds(60)), uint64_t(0));
+  CHECK(cached(cache, "http://example.org/4"));
+}
+
+TEST(expires_after_freshness)
+{
+  ContentCache cache(1024);
+  cache.put(Uri("http://example.org/fresh"), "text/plain", Buffer("fresh"),
+            std::chrono::seconds(1));
+  CHECK(cached(cache, "http://example.org/fresh"));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  CHECK(!cached(cache, "http://example.org/fresh"));
+  CHECK_EQUAL(cache.size(), size_t(0));
+
+  // Not fresh at all
+  CHECK_EQUAL(cache.put(Uri("http://example.org/stale"), "text/plain", Buffer("stale"),
+                        std::chrono::seconds(0)), uint64_t(0));
+  CHECK(!cached(cache, "http://example.org/stale"));
+}
+
+TEST(replaced_key_drops_old_size)
+{
+  ContentCache cache(1024);
+  uint64_t first = cache.put(Uri("http://example.org/r"), "text/plain", Buffer("long content"),
+                             std::chrono::seconds(60));
+  uint64_t second = cache.put(Uri("http://example.org/r"), "text/plain", Buffer("short"),
+                              std::chrono::seconds(60));
+  CHECK(second != first);
+  CHECK_EQUAL(cache.size(), size_t(5));
+
+  std::string content;
+  CHECK(cached(cache, "http://example.org/r", content));
+  CHECK_EQUAL(content, std::string("short"));
+}
+
+TEST(drops_converted_contents_with_the_original)
+{
+  ContentCache cache(1024);
+  Uri uri("http://example.org/page");
+  uint64_t first = cache.put(uri, "text/html", Buffer("<a href='x'>"), std::chrono::seconds(60));
+  cache.putConverted(uri, "ndn", first, Buffer("<a href='ndn:/x'>"));
+
+  Buffer data;
+  CHECK(cache.getConverted(uri, "ndn", first, data));
+  CHECK_EQUAL(data.toString(), std::string("<a href='ndn:/x'>"));
+  CHECK(!cache.getConverted(uri, "pursuit", first, data));
+
+  // Replaced: the old conversion is gone, whatever the version asked for
+  uint64_t second = cache.put(uri, "text/html", Buffer("<a href='y'>"), std::chrono::seconds(60));
+  CHECK(!cache.getConverted(uri, "ndn", first, data));
+  CHECK(!cache.getConverted(uri, "ndn", second, data));
+  CHECK_EQUAL(cache.size(), size_t(12));
+
+  // Conversions of an outdated version are not kept
+  cache.putConverted(uri, "ndn", first, Buffer("<a href='ndn:/x'>"));
+  CHECK(!cache.getConverted(uri, "ndn", second, data));
+  CHECK_EQUAL(cache.size(), size_t(12));
+
+  // Erased
+  cache.putConverted(uri, "ndn", second, Buffer("<a href='ndn:/y'>"));
+  CHECK(cache.getConverted(uri, "ndn", second, data));
+  cache.erase(uri);
+  CHECK(!cache.getConverted(uri, "ndn", second, data));
+  CHECK_EQUAL(cache.size(), size_t(0));
+}
+
+TEST(counts_converted_contents_against_capacity)
+{
+  ContentCache cache(20);
+  Uri a("http://example.org/conv-a");
+  Uri b("http://example.org/conv-b");
+
+  uint64_t version_a = cache.put(a, "text/plain", Buffer("aaaaa"), std::chrono::seconds(60));
+  cache.putConverted(a, "ndn", version_a, Buffer("AAAAA"));
+  CHECK_EQUAL(cache.size(), size_t(10));
+
+  // The original and its conversion are evicted together
+  uint64_t version_b = cache.put(b, "text/plain", Buffer("bbbbbbbbbbbb"), std::chrono::seconds(60));
+  Buffer data;
+  CHECK(!cached(cache, "http://example.org/conv-a"));
+  CHECK(!cache.getConverted(a, "ndn", version_a, data));
+  CHECK_EQUAL(cache.size(), size_t(12));
+
+  // A conversion that does not fit next to its original is not kept
+  cache.putConverted(b, "ndn", version_b, Buffer("BBBBBBBBBBBB"));
+  CHECK(!cache.getConverted(b, "ndn", version_b, data));
+  CHECK(cached(cache, "http://example.org/conv-b"));
+  CHECK_EQUAL(cache.size(), size_t(12));
+
+  // Conversions make room by evicting other entries
+  cache.put(a, "text/plain", Buffer("aaaaa"), std::chrono::seconds(60));
+  CHECK_EQUAL(cache.size(), size_t(17));
+  cache.putConverted(b, "ndn", version_b, Buffer("BBBBBBBB"));
+  CHECK(cache.getConverted(b, "ndn", version_b, data));
+  CHECK(!cached(cache, "http://example.org/conv-a"));
+  CHECK_EQUAL(cache.size(), size_t(20));
+}
+
+TEST(does_nothing_without_capacity)
+{
+  std::atomic<uint64_t>& hits = Metrics::getInstance().getCounter("cache.hits");
+  std::atomic<uint64_t>& misses = Metrics::getInstance().getCounter("cache.misses");
+  uint64_t hits_before = hits;
+  uint64_t misses_before = misses;
+
+  ContentCache cache(0);
+  CHECK_EQUAL(cache.put(Uri("http://example.org/none"), "text/plain", Buffer(""),
+                        std::chrono::seconds(60)), uint64_t(0));
+  CHECK(!cached(cache, "http://example.org/none"));
+
+  Buffer data;
+  CHECK(!cache.getConverted(Uri("http://example.org/none"), "ndn", 1, data));
+  CHECK_EQUAL(cache.size(), size_t(0));
+  CHECK_EQUAL(uint64_t(hits), hits_before);
+  CHECK_EQUAL(uint64_t(misses), misses_before);
+}
+
+TEST_MAIN()
@@ -0,0 +1,112 @@
+/** Brief: Tests of the content type discovery
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "utils.hpp"
+
+#include <memory>
+
+struct Sample
+{
+  std::string content;
+  std::string type;
+
+  // Bytes that must be in for the type to be told
+  size_t signature;
+};
+
+static const std::vector<Sample> samples = {
+  {std::string("\x89PNG\r\n\x1a\n\0\0\0\rIHDR", 16), "image/png", 8},
+  {std::string("\xff\xd8\xff\xe0\0\x10JFIF\0", 11), "image/jpeg", 3},
+  {"GIF87a\x01\0\x01\0", "image/gif", 6},
+  {"GIF89a\x01\0\x01\0", "image/gif", 6},
+  {std::string("RIFF\x24\0\0\0WEBPVP8 ", 16), "image/webp", 12},
+  {std::string("\x1f\x8b\x08\0\0\0\0\0", 8), "application/gzip", 2},
+  {"%PDF-1.4\n%", "application/pdf", 5},
+  {"<!DOCTYPE html><html></html>", "text/html", 14},
+  {"\xef\xbb\xbf  <html><body></body></html>", "text/html", 10},
+  {"\n\t<HEAD><title>t</title></HEAD>", "text/html", 7},
+  {"<body>text</body>", "text/html", 5},
+  {"{\"a\": [1, 2]}", "application/json", 13},
+  {"[ {\"a\": 1} ]\n", "application/json", 12},
+};
+
+// Sniffs a copy of the given bytes in a buffer of their exact size, so that
+// reading past them is caught when running under AddressSanitizer
+static std::string sniff(const std::string& bytes)
+{
+  std::unique_ptr<char[]> copy(new char[bytes.size()]);
+  memcpy(copy.get(), bytes.data(), bytes.size());
+
+  return sniffContentType(copy.get(), bytes.size());
+}
+
+TEST(sniffs_common_types)
+{
+  for(auto& sample : samples) {
+    CHECK_EQUAL(sniff(sample.content), sample.type);
+  }
+}
+
+TEST(sniffs_truncated_contents_within_bounds)
+{
+  for(auto& sample : samples) {
+    for(size_t size = 0; size < sample.signature; ++size) {
+      std::string type = sniff(sample.content.substr(0, size));
+      if(type == sample.type) {
+        std::cerr << "  told " << sample.type << " from " << size << " bytes" << std::endl;
+      }
+      CHECK(type != sample.type);
+    }
+
+    // Every prefix longer than the signature is still recognized (but JSON,
+    // which must be closed)
+    for(size_t size = sample.signature; size <= sample.content.size(); ++size) {
+      std::string type = sniff(sample.content.substr(0, size));
+      CHECK(type == sample.type || sample.type == "application/json");
+    }
+  }
+}
+
+TEST(sniffs_short_riff_contents)
+{
+  CHECK_EQUAL(sniff("RIFF"), "");
+  CHECK_EQUAL(sniff("RIFF1"), "");
+  CHECK_EQUAL(sniff("RIFF1234"), "");
+  CHECK_EQUAL(sniff("RIFF1234WEB"), "");
+  CHECK_EQUAL(sniff("RIFF1234WAVE"), "");
+  CHECK_EQUAL(sniff("RIFF1234WEBP"), "image/webp");
+}
+
+TEST(sniffs_empty_and_unknown_contents)
+{
+  CHECK_EQUAL(sniff(""), "application/x-empty");
+  CHECK_EQUAL(sniff("   "), "");
+  CHECK_EQUAL(sniff("{"), "");
+  CHECK_EQUAL(sniff("["), "");
+  CHECK_EQUAL(sniff("{ }x"), "");
+  CHECK_EQUAL(sniff("[ x ]"), "");
+  CHECK_EQUAL(sniff("plain text"), "");
+}
+
+TEST(falls_back_to_libmagic)
+{
+  CHECK_EQUAL(discoverContentType(Buffer(std::string("plain text\n"))), "text/plain");
+  CHECK_EQUAL(discoverContentType(Buffer(samples[0].content)), "image/png");
+}
+
+TEST_MAIN()
@@ -0,0 +1,486 @@
+/** Brief: Tests of the Core, driven through fake protocol plugins
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "fake-protocol.hpp"
+#include "core.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+
+#include <iostream>
+#include <limits.h>
+#include <memory>
+#include <unistd.h>
+
+// Fake plugins are next to the test program
+static std::string pluginPath(const std::string scheme)
+{
+  char path[PATH_MAX];
+  ssize_t size = readlink("/proc/self/exe", path, sizeof(path) - 1);
+  std::string exe(path, size > 0 ? size : 0);
+  return exe.substr(0, exe.rfind('/') + 1) + "fake-protocol-" + scheme + ".so";
+}
+
+static uint64_t counter(const std::string name)
+{
+  return Metrics::getInstance().getCounter(name);
+}
+
+static double gauge(const std::string name)
+{
+  std::string metrics = " " + Metrics::getInstance().toString();
+  size_t pos = metrics.find(" " + name + "=");
+  return pos == std::string::npos ? -1 : std::stod(metrics.substr(pos + name.size() + 2));
+}
+
+// Polls until the condition holds. Returns false on timeout
+template<typename Condition>
+static bool eventually(Condition condition,
+                       const std::chrono::milliseconds timeout = std::chrono::seconds(5))
+{
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while(!condition()) {
+    if(std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+// Core running on a thread of its own, with a fake protocol per scheme
+// (a, b, c and d). Each test gets a Core of its own, whose plugins start
+// with nothing sent.
+class Harness
+{
+public:
+  std::unique_ptr<ThreadPool> tp;
+  Core core;
+  std::map<std::string, FakeProtocol*> protocols;
+  std::thread thread;
+
+  Harness(const size_t cacheSize = DEFAULT_CACHE_SIZE,
+          const long requestTimeout = DEFAULT_REQUEST_TIMEOUT)
+    : tp(new ThreadPool(2)), core(*tp, cacheSize, DEFAULT_CACHE_TTL, requestTimeout)
+  {
+    for(auto scheme : {"a", "b", "c", "d"}) {
+      core.loadProtocol(pluginPath(scheme));
+      protocols[scheme] = FakeProtocol::get(pluginPath(scheme));
+    }
+    thread = std::thread(&Core::start, &core);
+  }
+
+  ~Harness()
+  {
+    core.stop();
+    thread.join();
+
+    // Jobs of the pool use the Core
+    tp.reset();
+  }
+
+  FakeProtocol& operator[](const std::string scheme)
+  {
+    return *protocols[scheme];
+  }
+};
+
+// Thread-safe capture of what is written to a stream
+class Capture : public std::streambuf
+{
+private:
+  std::ostream& _stream;
+  std::streambuf* _original;
+  std::mutex _mutex;
+  std::string _text;
+
+public:
+  Capture(std::ostream& stream)
+    : _stream(stream), _original(stream.rdbuf(this))
+  { }
+
+  ~Capture()
+  {
+    _stream.rdbuf(_original);
+  }
+
+  std::string text()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _text;
+  }
+
+protected:
+  int overflow(int c)
+  {
+    if(c != EOF) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _text.push_back(char(c));
+    }
+    return c;
+  }
+
+  std::streamsize xsputn(const char* s, std::streamsize n)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _text.append(s, n);
+    return n;
+  }
+};
+
+static size_t count(const std::string& text, const std::string& what)
+{
+  size_t n = 0;
+  for(size_t pos = text.find(what); pos != std::string::npos; pos = text.find(what, pos + 1)) {
+    ++n;
+  }
+  return n;
+}
+
+TEST(loads_a_plugin_per_scheme)
+{
+  Harness h;
+  for(auto& item : h.protocols) {
+    CHECK(item.second != nullptr);
+    CHECK_EQUAL(item.second->getProtocol(), item.first);
+  }
+
+  std::vector<Uri> f_uris = h.core.createMapping(Uri("b://origin/mapped"));
+  CHECK_EQUAL(f_uris.size(), size_t(3));
+  for(auto& f_uri : f_uris) {
+    CHECK(f_uri.getSchema() != "b");
+  }
+}
+
+// Clients of each foreign network ask at once for the same content. A
+// single request goes upstream and each foreign URI is answered once,
+// with the response its plugin hands to all of its clients.
+TEST(coalesces_concurrent_requests)
+{
+  const int N = 20;
+
+  Harness h;
+  uint64_t requests = counter("core.requests");
+  uint64_t upstream = counter("core.upstream_requests");
+
+  std::vector<Uri> f_uris = h.core.createMapping(Uri("b://origin/x"));
+  CHECK_EQUAL(f_uris.size(), size_t(3));
+
+  std::vector<std::thread> clients;
+  for(auto& f_uri : f_uris) {
+    for(int i = 0; i < N; ++i) {
+      clients.emplace_back([&h, f_uri]() {
+                             h[f_uri.getSchema()].request(f_uri.toString());
+                           });
+    }
+  }
+  for(auto& client : clients) {
+    client.join();
+  }
+
+  CHECK(eventually([&]() { return counter("core.requests") - requests == 3 * N; }));
+  CHECK(h["b"].waitFor(1));
+  h["b"].respond("b://origin/x", "hello");
+
+  for(auto& f_uri : f_uris) {
+    CHECK(h[f_uri.getSchema()].waitFor(1));
+  }
+
+  // Nothing else arrives late
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  std::vector<Sent> sent = h["b"].sent();
+  CHECK_EQUAL(sent.size(), size_t(1));
+  CHECK_EQUAL(sent[0].uri, std::string("b://origin/x"));
+  CHECK(sent[0].type == MESSAGE_TYPE_REQUEST);
+  CHECK_EQUAL(counter("core.upstream_requests") - upstream, uint64_t(1));
+
+  for(auto& f_uri : f_uris) {
+    sent = h[f_uri.getSchema()].sent();
+    CHECK_EQUAL(sent.size(), size_t(1));
+    CHECK_EQUAL(sent[0].uri, f_uri.toString());
+    CHECK_EQUAL(sent[0].content, std::string("hello"));
+  }
+}
+
+// Nothing is left behind by requests to an origin that never answers
+TEST(expires_requests_of_a_blackholed_origin)
+{
+  Harness h(DEFAULT_CACHE_SIZE, 1);
+  uint64_t expired = counter("core.expired_requests");
+
+  for(int round = 1; round <= 3; ++round) {
+    std::vector<std::string> a_uris;
+    for(int i = 0; i < 50; ++i) {
+      std::vector<Uri> f_uris = h.core.createMapping(Uri("b://blackhole/" + std::to_string(i)));
+      for(auto& f_uri : f_uris) {
+        if(f_uri.getSchema() == "a") {
+          a_uris.push_back(f_uri.toString());
+          h["a"].request(f_uri.toString());
+        }
+      }
+    }
+
+    CHECK(h["b"].waitFor(50 * round));
+    CHECK(gauge("core.pending_responses") > 0);
+
+    // A single failure per foreign URI
+    CHECK(h["a"].waitFor(50 * round, std::chrono::seconds(3)));
+    std::vector<Sent> sent = h["a"].sent();
+    CHECK_EQUAL(sent.size(), size_t(50 * round));
+    for(size_t i = 0; i < a_uris.size(); ++i) {
+      CHECK(sent[50 * (round - 1) + i].type == MESSAGE_TYPE_FAILURE);
+    }
+
+    CHECK(eventually([]() { return gauge("core.pending_responses") == 0
+                                   && gauge("core.expiry_timers") == 0; }));
+    CHECK_EQUAL(counter("core.expired_requests") - expired, uint64_t(50 * round));
+  }
+
+  // The same URIs were asked for again, so nothing new was interned
+  double interned = gauge("core.interned_uris");
+  for(int i = 0; i < 50; ++i) {
+    h.core.createMapping(Uri("b://blackhole/" + std::to_string(i)));
+  }
+  CHECK_EQUAL(gauge("core.interned_uris"), interned);
+}
+
+TEST(fails_a_foreign_uri_once_its_last_request_expires)
+{
+  Harness h(DEFAULT_CACHE_SIZE, 1);
+  uint64_t expired = counter("core.expired_requests");
+
+  std::vector<Uri> f_uris = h.core.createMapping(Uri("b://blackhole/twice"));
+  std::string a_uri = f_uris[0].toString();
+  h["a"].request(a_uri);
+  h["a"].request(a_uri);
+
+  CHECK(eventually([&]() { return counter("core.expired_requests") - expired == 2; }));
+  CHECK(h["a"].waitFor(1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(3 * EXPIRY_TIMER_TICK));
+
+  std::vector<Sent> sent = h["a"].sent();
+  CHECK_EQUAL(sent.size(), size_t(1));
+  CHECK_EQUAL(sent[0].uri, a_uri);
+  CHECK(sent[0].type == MESSAGE_TYPE_FAILURE);
+}
+
+// Timers of answered requests are ignored when they fire
+TEST(does_not_expire_answered_requests)
+{
+  Harness h(DEFAULT_CACHE_SIZE, 1);
+  uint64_t expired = counter("core.expired_requests");
+
+  std::vector<Uri> f_uris = h.core.createMapping(Uri("b://origin/answered"));
+  h["a"].request(f_uris[0].toString());
+  CHECK(h["b"].waitFor(1));
+  h["b"].respond("b://origin/answered", "answer");
+  CHECK(h["a"].waitFor(1));
+
+  CHECK(eventually([]() { return gauge("core.expiry_timers") == 0; }));
+  CHECK_EQUAL(counter("core.expired_requests"), expired);
+
+  std::vector<Sent> sent = h["a"].sent();
+  CHECK_EQUAL(sent.size(), size_t(1));
+  CHECK(sent[0].type == MESSAGE_TYPE_RESPONSE);
+}
+
+// Foreign URI of each scheme mapped to the original URI
+static std::map<std::string, std::string> mapping(Core& core, const std::string o_uri)
+{
+  std::map<std::string, std::string> ret;
+  for(auto& f_uri : core.createMapping(Uri(o_uri))) {
+    ret[f_uri.getSchema()] = f_uri.toString();
+  }
+  return ret;
+}
+
+// Waits a bit for messages that should not come
+static bool nothingMore(FakeProtocol& protocol, const size_t n)
+{
+  return !protocol.waitFor(n + 1, std::chrono::milliseconds(200));
+}
+
+TEST(does_not_start_plugins_with_invalid_options)
+{
+  // Misconfigured plugins are logged as errors
+  Logger::getInstance().setLevel(LOG_LEVEL_FATAL);
+
+  ThreadPool tp(2);
+  {
+    Core core(tp);
+    core.setProtocolOptions({{"a.fail", "1"}, {"b.fail", "0"}, {"c.other", "x"}});
+
+    // Dropped without being started
+    CHECK(!core.loadProtocol(pluginPath("a")));
+
+    CHECK(core.loadProtocol(pluginPath("b")));
+    CHECK(core.loadProtocol(pluginPath("c")));
+    CHECK(FakeProtocol::get(pluginPath("b"))->running());
+    CHECK(!core.loadProtocol(pluginPath("missing")));
+
+    // Only the plugins started get mappings
+    std::vector<Uri> f_uris = core.createMapping(Uri("b://origin/options"));
+    CHECK_EQUAL(f_uris.size(), size_t(1));
+    CHECK_EQUAL(f_uris[0].getSchema(), "c");
+
+    // Stopped without being started, as fixp does when giving up
+    core.stop();
+  }
+
+  Logger::getInstance().setLevel(LOG_LEVEL_ERROR);
+}
+
+// Clients of plugins that do not stream get the whole content once, with
+// its chunks in order and duplicates dropped
+TEST(puts_chunks_together_in_order)
+{
+  Harness h;
+  std::map<std::string, std::string> f_uris = mapping(h.core, "b://origin/chunked");
+
+  h["a"].request(f_uris["a"]);
+  CHECK(h["b"].waitFor(1));
+
+  h["b"].respond("b://origin/chunked", "ghi", 60, 2, true);
+  h["b"].respond("b://origin/chunked", "abc", 60, 0, false);
+  h["b"].respond("b://origin/chunked", "ghi", 60, 2, true);
+  CHECK(nothingMore(h["a"], 0));
+
+  h["b"].respond("b://origin/chunked", "def", 60, 1, false);
+  CHECK(h["a"].waitFor(1));
+  h["b"].respond("b://origin/chunked", "def", 60, 1, false);
+  CHECK(nothingMore(h["a"], 1));
+
+  std::vector<Sent> sent = h["a"].sent();
+  CHECK(sent[0].type == MESSAGE_TYPE_RESPONSE);
+  CHECK_EQUAL(sent[0].uri, f_uris["a"]);
+  CHECK_EQUAL(sent[0].content, "abcdefghi");
+  CHECK_EQUAL(sent[0].chunk, size_t(-1));
+  CHECK(!sent[0].keepSession);
+
+  // The whole content is cached
+  h["c"].request(f_uris["c"]);
+  CHECK(h["c"].waitFor(1));
+  CHECK_EQUAL(h["c"].sent()[0].content, "abcdefghi");
+  CHECK_EQUAL(h["b"].sent().size(), size_t(1));
+}
+
+// Clients of plugins that stream get each chunk as soon as it is in order,
+// while the others still get the whole content at the end
+TEST(streams_chunks_in_order_to_streaming_plugins)
+{
+  Harness h;
+  h["a"].setStreaming(true);
+  std::map<std::string, std::string> f_uris = mapping(h.core, "b://origin/streamed");
+
+  h["a"].request(f_uris["a"]);
+  h["c"].request(f_uris["c"]);
+  CHECK(h["b"].waitFor(1));
+
+  h["b"].respond("b://origin/streamed", "def", 60, 1, false);
+  CHECK(nothingMore(h["a"], 0));
+
+  h["b"].respond("b://origin/streamed", "abc", 60, 0, false);
+  CHECK(h["a"].waitFor(2));
+  h["b"].respond("b://origin/streamed", "abc", 60, 0, false);
+  CHECK(nothingMore(h["a"], 2));
+  CHECK(nothingMore(h["c"], 0));
+
+  h["b"].respond("b://origin/streamed", "ghi", 60, 2, true);
+  CHECK(h["a"].waitFor(3));
+  CHECK(h["c"].waitFor(1));
+  CHECK(nothingMore(h["a"], 3));
+
+  std::vector<Sent> sent = h["a"].sent();
+  for(size_t i = 0; i < 3; ++i) {
+    CHECK(sent[i].type == MESSAGE_TYPE_RESPONSE);
+    CHECK_EQUAL(sent[i].uri, f_uris["a"]);
+    CHECK_EQUAL(sent[i].chunk, i);
+    CHECK_EQUAL(sent[i].keepSession, i != 2);
+  }
+  CHECK_EQUAL(sent[0].content, "abc");
+  CHECK_EQUAL(sent[1].content, "def");
+  CHECK_EQUAL(sent[2].content, "ghi");
+
+  sent = h["c"].sent();
+  CHECK_EQUAL(sent.size(), size_t(1));
+  CHECK_EQUAL(sent[0].content, "abcdefghi");
+  CHECK_EQUAL(sent[0].chunk, size_t(-1));
+}
+
+// Streaming only starts for the clients waiting from the first chunk on
+TEST(sends_the_whole_content_to_late_streaming_clients)
+{
+  Harness h;
+  h["a"].setStreaming(true);
+  h["d"].setStreaming(true);
+  std::map<std::string, std::string> f_uris = mapping(h.core, "b://origin/late");
+
+  h["a"].request(f_uris["a"]);
+  CHECK(h["b"].waitFor(1));
+  h["b"].respond("b://origin/late", "abc", 60, 0, false);
+  CHECK(h["a"].waitFor(1));
+
+  h["d"].request(f_uris["d"]);
+  CHECK(nothingMore(h["b"], 1));
+  h["b"].respond("b://origin/late", "def", 60, 1, true);
+  CHECK(h["a"].waitFor(2));
+  CHECK(h["d"].waitFor(1));
+
+  std::vector<Sent> sent = h["a"].sent();
+  CHECK_EQUAL(sent[1].content, "def");
+  CHECK_EQUAL(sent[1].chunk, size_t(1));
+  CHECK(!sent[1].keepSession);
+
+  sent = h["d"].sent();
+  CHECK_EQUAL(sent.size(), size_t(1));
+  CHECK_EQUAL(sent[0].content, "abcdef");
+  CHECK_EQUAL(sent[0].chunk, size_t(-1));
+}
+
+TEST(dumps_metrics_when_asked)
+{
+  Capture capture(std::cerr);
+  Harness h;
+
+  // The line is written in pieces
+  h.core.dumpMetrics();
+  CHECK(eventually([&]() { return capture.text().find('\n') != std::string::npos; }));
+  CHECK(capture.text().find("[METRICS]") != std::string::npos);
+  CHECK(capture.text().find("core.coalescing_ratio=") != std::string::npos);
+
+  // Once per request
+  std::this_thread::sleep_for(std::chrono::milliseconds(3 * EXPIRY_TIMER_TICK));
+  CHECK_EQUAL(count(capture.text(), "[METRICS]"), size_t(1));
+}
+
+TEST(dumps_metrics_periodically)
+{
+  Capture capture(std::cerr);
+  Harness h;
+  h.core.setMetricsInterval(1);
+
+  CHECK(eventually([&]() { return count(capture.text(), "[METRICS]") >= 2; },
+                   std::chrono::seconds(4)));
+}
+
+int main()
+{
+  // Expired requests are warned about
+  Logger::getInstance().setLevel(LOG_LEVEL_ERROR);
+  return TestRegistry::getInstance().run();
+}
@@ -0,0 +1,149 @@
+/** Brief: Tests of the queue of deferred requests
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "concurrent-blocking-queue.hpp"
+#include "deferred-queue.hpp"
+
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Stands for the Core, admitting values while not overloaded
+class Admitter
+{
+public:
+  ConcurrentBlockingQueue<int> queue;
+
+  Admitter(const size_t high, const size_t low)
+    : queue(64)
+  {
+    queue.setWatermarks(high, low);
+  }
+
+  bool operator()(int& value)
+  {
+    return !queue.isOverloaded() && queue.try_push(value);
+  }
+
+  std::vector<int> drain()
+  {
+    std::vector<int> values;
+    int value;
+    while(queue.try_pop(value)) {
+      values.push_back(value);
+    }
+    return values;
+  }
+};
+
+static void ignore(int&)
+{ }
+
+TEST(admits_straight_away_while_not_overloaded)
+{
+  Admitter core(4, 2);
+  DeferredQueue<int> deferred(16, std::chrono::seconds(30));
+
+  for(int i = 0; i < 3; ++i) {
+    CHECK_EQUAL(deferred.admit(i, core), ADMISSION_ADMITTED);
+  }
+  CHECK_EQUAL(deferred.size(), size_t(0));
+  CHECK_EQUAL(core.drain(), std::vector<int>({0, 1, 2}));
+}
+
+TEST(admits_deferred_values_in_arrival_order)
+{
+  Admitter core(4, 2);
+  DeferredQueue<int> deferred(16, std::chrono::seconds(30));
+
+  for(int i = 0; i < 8; ++i) {
+    CHECK_EQUAL(deferred.admit(i, core), i < 4 ? ADMISSION_ADMITTED : ADMISSION_DEFERRED);
+  }
+  CHECK_EQUAL(deferred.size(), size_t(4));
+
+  // Still overloaded above the low watermark
+  int value;
+  core.queue.try_pop(value);
+  deferred.flush(core, ignore);
+  CHECK_EQUAL(deferred.size(), size_t(4));
+
+  // Back at the low watermark, the deferred values go first, and in order,
+  // until the high watermark is reached again
+  core.queue.try_pop(value);
+  deferred.flush(core, ignore);
+  CHECK_EQUAL(deferred.size(), size_t(2));
+  CHECK_EQUAL(deferred.admit(8, core), ADMISSION_DEFERRED);
+
+  CHECK_EQUAL(core.drain(), std::vector<int>({2, 3, 4, 5}));
+  deferred.flush(core, ignore);
+  CHECK_EQUAL(deferred.size(), size_t(0));
+  CHECK_EQUAL(core.drain(), std::vector<int>({6, 7, 8}));
+}
+
+TEST(drops_values_beyond_its_size)
+{
+  Admitter core(1, 0);
+  DeferredQueue<int> deferred(3, std::chrono::seconds(30));
+
+  CHECK_EQUAL(deferred.admit(0, core), ADMISSION_ADMITTED);
+  for(int i = 1; i <= 3; ++i) {
+    CHECK_EQUAL(deferred.admit(i, core), ADMISSION_DEFERRED);
+  }
+  CHECK_EQUAL(deferred.admit(4, core), ADMISSION_DROPPED);
+  CHECK_EQUAL(deferred.size(), size_t(3));
+
+  // Only the dropped value is lost
+  std::vector<int> admitted;
+  for(int i = 0; i < 5; ++i) {
+    for(int value : core.drain()) {
+      admitted.push_back(value);
+    }
+    deferred.flush(core, ignore);
+  }
+  CHECK_EQUAL(admitted, std::vector<int>({0, 1, 2, 3}));
+}
+
+TEST(expires_values_past_their_deadline)
+{
+  Clock::time_point start = Clock::now();
+  Admitter core(1, 0);
+  DeferredQueue<int> deferred(16, std::chrono::seconds(10));
+
+  deferred.admit(0, core, start);
+  deferred.admit(1, core, start);
+  deferred.admit(2, core, start + std::chrono::seconds(5));
+  deferred.admit(3, core, start + std::chrono::seconds(20));
+
+  // Expired values go, whether or not the others can be admitted
+  std::vector<int> expired;
+  auto collect = [&expired](int& value) { expired.push_back(value); };
+  deferred.flush(core, collect, start + std::chrono::seconds(12));
+  CHECK_EQUAL(expired, std::vector<int>({1}));
+  CHECK_EQUAL(deferred.size(), size_t(2));
+
+  core.drain();
+  deferred.flush(core, collect, start + std::chrono::seconds(14));
+  CHECK_EQUAL(expired, std::vector<int>({1}));
+  CHECK_EQUAL(core.drain(), std::vector<int>({2}));
+
+  deferred.flush(core, collect, start + std::chrono::seconds(31));
+  CHECK_EQUAL(expired, std::vector<int>({1, 3}));
+  CHECK_EQUAL(deferred.size(), size_t(0));
+}
+
+TEST_MAIN()
@@ -0,0 +1,115 @@
+/** Brief: Tests of the escaping of strings
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "utils.hpp"
+#include "legacy/utils.hpp"
+
+#include <random>
+
+#define FUZZ_ROUNDS 200000
+
+// Random strings of up to 64 characters from the given alphabet
+class Fuzzer
+{
+private:
+  std::mt19937 _random;
+  std::string _alphabet;
+
+public:
+  Fuzzer(const std::string& alphabet)
+    : _random(1234), _alphabet(alphabet)
+  { }
+
+  std::string next()
+  {
+    std::string ret(_random() % 65, '\0');
+    for(auto& c : ret) {
+      c = _alphabet[_random() % _alphabet.size()];
+    }
+
+    return ret;
+  }
+};
+
+static std::string allBytes()
+{
+  std::string ret;
+  for(int c = 0; c < 256; ++c) {
+    ret.push_back((char) c);
+  }
+
+  return ret;
+}
+
+TEST(escapes_as_before)
+{
+  Fuzzer fuzzer(allBytes());
+  for(int i = 0; i < FUZZ_ROUNDS; ++i) {
+    std::string str = fuzzer.next();
+    CHECK_EQUAL(escapeString(str), legacy::escapeString(str));
+  }
+}
+
+TEST(unescapes_as_before)
+{
+  // Mostly escapes, valid or not (strtol() accepts signs, spaces and 0x)
+  Fuzzer fuzzer("%%%%0123456789abcdefABCDEFxX+- \tg/");
+  for(int i = 0; i < FUZZ_ROUNDS; ++i) {
+    std::string str = fuzzer.next();
+    std::string expected = legacy::unescapeString(str);
+    if(unescapeString(str) != expected) {
+      std::cerr << "  differs: " << str << std::endl;
+    }
+    CHECK_EQUAL(unescapeString(str), expected);
+  }
+}
+
+TEST(unescapes_any_bytes_as_before)
+{
+  Fuzzer fuzzer(allBytes());
+  for(int i = 0; i < FUZZ_ROUNDS; ++i) {
+    std::string str = fuzzer.next();
+    CHECK_EQUAL(unescapeString(str), legacy::unescapeString(str));
+  }
+}
+
+TEST(unescapes_what_was_escaped)
+{
+  // But '%', which is decoded twice
+  std::string alphabet = allBytes();
+  alphabet.erase(alphabet.find('%'), 1);
+
+  Fuzzer fuzzer(alphabet);
+  for(int i = 0; i < FUZZ_ROUNDS; ++i) {
+    std::string str = fuzzer.next();
+    CHECK_EQUAL(unescapeString(escapeString(str)), str);
+  }
+}
+
+TEST(keeps_the_old_quirks)
+{
+  CHECK_EQUAL(escapeString("a b/~"), "a%20b%2F~");
+  CHECK_EQUAL(unescapeString("%41%4a%4A"), "AJJ");
+
+  // A decoded '%' is decoded again, and short escapes are taken as they are
+  CHECK_EQUAL(unescapeString("%2541"), "A");
+  CHECK_EQUAL(unescapeString("a%4"), std::string("a\x04"));
+  CHECK_EQUAL(unescapeString("a%"), std::string("a\0", 2));
+}
+
+TEST_MAIN()
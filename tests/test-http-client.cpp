@@ -0,0 +1,151 @@
+/** Brief: Tests of the upstream HTTP client
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "origin.hpp"
+#include "logger.hpp"
+#include "protocols/http/http-client.hpp"
+
+#include <future>
+
+static HttpResult fetch(HttpClient& client, const std::string& uri)
+{
+  std::promise<HttpResult> done;
+  client.get(uri, 5000, [&done](HttpResult& result) {
+               done.set_value(std::move(result));
+             });
+
+  return done.get_future().get();
+}
+
+// URI of a port nothing listens on
+static std::string closedUri()
+{
+  int s = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  bind(s, (struct sockaddr*) &addr, len);
+  getsockname(s, (struct sockaddr*) &addr, &len);
+  close(s);
+
+  return "http://localhost:" + std::to_string(ntohs(addr.sin_port)) + "/";
+}
+
+TEST(fetches_content_type_and_freshness)
+{
+  Origin origin("<html></html>", "text/html");
+  HttpClient client;
+  client.start();
+
+  HttpResult result = fetch(client, origin.uri("/index.html"));
+  CHECK(result.ok);
+  CHECK_EQUAL(result.content, "<html></html>");
+  CHECK_EQUAL(result.type, "text/html");
+  CHECK_EQUAL(result.freshness, 60L);
+
+  client.stop();
+}
+
+TEST(reuses_the_connection)
+{
+  Origin origin(std::string(4096, 'x'), "text/plain");
+  HttpClient client;
+  client.start();
+
+  for(int i = 0; i < 20; ++i) {
+    HttpResult result = fetch(client, origin.uri("/" + std::to_string(i)));
+    CHECK(result.ok);
+    CHECK_EQUAL(result.content.size(), size_t(4096));
+  }
+  CHECK_EQUAL(origin.getRequests(), size_t(20));
+  CHECK_EQUAL(origin.getConnections(), size_t(1));
+
+  client.stop();
+}
+
+TEST(fetches_many_at_once)
+{
+  Origin origin("content", "text/plain");
+  HttpClient client;
+  client.start();
+
+  std::vector<std::promise<HttpResult>> done(200);
+  for(auto& d : done) {
+    std::promise<HttpResult>* p = &d;
+    client.get(origin.uri("/"), 5000, [p](HttpResult& result) {
+                 p->set_value(std::move(result));
+               });
+  }
+
+  for(auto& d : done) {
+    HttpResult result = d.get_future().get();
+    CHECK(result.ok);
+    CHECK_EQUAL(result.content, "content");
+  }
+  CHECK_EQUAL(origin.getRequests(), size_t(200));
+
+  // Some of the connections opened for them are kept for the next ones
+  size_t connections = origin.getConnections();
+  for(int i = 0; i < 20; ++i) {
+    CHECK(fetch(client, origin.uri("/")).ok);
+  }
+  CHECK_EQUAL(origin.getConnections(), connections);
+
+  client.stop();
+}
+
+TEST(fails_without_a_server)
+{
+  HttpClient client;
+  client.start();
+
+  HttpResult result = fetch(client, closedUri());
+  CHECK(!result.ok);
+  CHECK(result.content.empty());
+  CHECK_EQUAL(result.freshness, -1L);
+
+  client.stop();
+}
+
+TEST(fails_transfers_once_stopped)
+{
+  std::promise<HttpResult> done;
+  {
+    HttpClient client;
+    client.start();
+    client.stop();
+
+    client.get(closedUri(), 5000, [&done](HttpResult& result) {
+                 done.set_value(std::move(result));
+               });
+  }
+
+  std::future<HttpResult> future = done.get_future();
+  CHECK(future.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+  CHECK(!future.get().ok);
+}
+
+int main()
+{
+  Logger::getInstance().setLevel(LOG_LEVEL_WARN);
+  curl_global_init(CURL_GLOBAL_ALL);
+  int failures = TestRegistry::getInstance().run();
+  curl_global_cleanup();
+  return failures;
+}
@@ -0,0 +1,144 @@
+/** Brief: Tests of the HTTP connections waiting for responses
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "metrics.hpp"
+#include "protocols/http/http-pending.hpp"
+
+#include <algorithm>
+
+typedef std::chrono::steady_clock Clock;
+
+// Connections are only handed around, so any distinct addresses will do
+static struct MHD_Connection* connection(const int n)
+{
+  static char connections[16];
+  return reinterpret_cast<struct MHD_Connection*>(&connections[n]);
+}
+
+static std::vector<struct MHD_Connection*> sorted(std::vector<struct MHD_Connection*> connections)
+{
+  std::sort(connections.begin(), connections.end());
+  return connections;
+}
+
+TEST(asks_once_for_each_uri)
+{
+  HttpPending pending;
+  uint64_t coalesced = Metrics::getInstance().getCounter("http.coalesced_requests");
+  auto deadline = Clock::now() + std::chrono::seconds(10);
+
+  CHECK(pending.add(Uri("http://example.org/a"), connection(0), deadline));
+  CHECK(!pending.add(Uri("http://example.org/a"), connection(1), deadline));
+  CHECK(!pending.add(Uri("http://example.org/a"), connection(2), deadline));
+  CHECK(pending.add(Uri("http://example.org/b"), connection(3), deadline));
+
+  CHECK_EQUAL(pending.size(), size_t(4));
+  CHECK_EQUAL(Metrics::getInstance().getCounter("http.coalesced_requests") - coalesced,
+              uint64_t(2));
+}
+
+TEST(takes_all_connections_waiting_for_a_uri)
+{
+  HttpPending pending;
+  auto deadline = Clock::now() + std::chrono::seconds(10);
+
+  pending.add(Uri("http://example.org/a"), connection(0), deadline);
+  pending.add(Uri("http://example.org/b"), connection(1), deadline);
+  pending.add(Uri("http://example.org/a"), connection(2), deadline);
+
+  std::vector<struct MHD_Connection*> taken = pending.take(Uri("http://example.org/a"));
+  CHECK_EQUAL(taken.size(), size_t(2));
+  CHECK(taken[0] == connection(0));
+  CHECK(taken[1] == connection(2));
+  CHECK_EQUAL(pending.size(), size_t(1));
+
+  // Nothing left for that URI, so the next one asks again
+  CHECK(pending.take(Uri("http://example.org/a")).empty());
+  CHECK(pending.add(Uri("http://example.org/a"), connection(3), deadline));
+
+  CHECK_EQUAL(pending.take(Uri("http://example.org/b")).size(), size_t(1));
+  CHECK_EQUAL(pending.size(), size_t(1));
+}
+
+TEST(expires_each_connection_by_its_own_deadline)
+{
+  HttpPending pending;
+  auto now = Clock::now();
+
+  pending.add(Uri("http://example.org/a"), connection(0), now + std::chrono::milliseconds(200));
+  pending.add(Uri("http://example.org/a"), connection(1), now + std::chrono::seconds(2));
+  pending.add(Uri("http://example.org/b"), connection(2), now + std::chrono::milliseconds(300));
+
+  CHECK(pending.expire(now).empty());
+
+  std::vector<struct MHD_Connection*> expired = pending.expire(now + std::chrono::milliseconds(500));
+  CHECK(sorted(expired) == sorted({connection(0), connection(2)}));
+  CHECK_EQUAL(pending.size(), size_t(1));
+
+  // The one left still gets the response
+  std::vector<struct MHD_Connection*> taken = pending.take(Uri("http://example.org/a"));
+  CHECK_EQUAL(taken.size(), size_t(1));
+  CHECK(taken[0] == connection(1));
+
+  // and is not expired later on
+  CHECK(pending.expire(now + std::chrono::seconds(3)).empty());
+  CHECK_EQUAL(pending.size(), size_t(0));
+}
+
+// The timers of connections taken do not expire others waiting for the
+// same URI afterwards
+TEST(does_not_expire_later_connections_of_the_same_uri)
+{
+  HttpPending pending;
+  auto now = Clock::now();
+
+  pending.add(Uri("http://example.org/a"), connection(0), now + std::chrono::milliseconds(200));
+  CHECK_EQUAL(pending.take(Uri("http://example.org/a")).size(), size_t(1));
+
+  pending.add(Uri("http://example.org/a"), connection(1), now + std::chrono::seconds(2));
+  CHECK(pending.expire(now + std::chrono::milliseconds(500)).empty());
+  CHECK_EQUAL(pending.size(), size_t(1));
+
+  std::vector<struct MHD_Connection*> expired = pending.expire(now + std::chrono::seconds(3));
+  CHECK_EQUAL(expired.size(), size_t(1));
+  CHECK(expired[0] == connection(1));
+}
+
+TEST(takes_all_connections_when_stopping)
+{
+  HttpPending pending;
+  auto now = Clock::now();
+
+  for(int i = 0; i < 8; ++i) {
+    pending.add(Uri("http://example.org/" + std::to_string(i % 3)), connection(i),
+                now + std::chrono::seconds(1 + i));
+  }
+
+  std::vector<struct MHD_Connection*> all;
+  for(int i = 0; i < 8; ++i) {
+    all.push_back(connection(i));
+  }
+  CHECK(sorted(pending.takeAll()) == all);
+  CHECK_EQUAL(pending.size(), size_t(0));
+
+  CHECK(pending.takeAll().empty());
+  CHECK(pending.take(Uri("http://example.org/0")).empty());
+  CHECK(pending.expire(now + std::chrono::seconds(10)).empty());
+}
+
+TEST_MAIN()
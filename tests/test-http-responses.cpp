@@ -0,0 +1,253 @@
+/** Brief: Tests of the creation of HTTP responses
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "metrics.hpp"
+#include "protocols/http/http-responses.hpp"
+
+#include <thread>
+#include <unistd.h>
+
+// Stand-ins for the functions of libmicrohttpd used by HttpResponses, so
+// the tests see how each response sends its body
+
+struct MHD_Response
+{
+  size_t size;
+  int fd;                 // -1 if sent from memory
+  uint64_t offset;
+  const void* data;
+  MHD_ContentReaderFreeCallback free;
+  void* cls;
+};
+
+struct MHD_Response* MHD_create_response_from_fd_at_offset64(uint64_t size, int fd,
+                                                             uint64_t offset)
+{
+  return new MHD_Response{size_t(size), fd, offset, nullptr, nullptr, nullptr};
+}
+
+#if MHD_VERSION >= 0x00097400
+struct MHD_Response* MHD_create_response_from_buffer_with_free_callback_cls(size_t size,
+                                                                            const void* data,
+                                                                            MHD_ContentReaderFreeCallback free,
+                                                                            void* cls)
+{
+  return new MHD_Response{size, -1, 0, data, free, cls};
+}
+#else
+struct MHD_Response* MHD_create_response_from_buffer(size_t size, void* data,
+                                                     enum MHD_ResponseMemoryMode)
+{
+  return new MHD_Response{size, -1, 0, data, nullptr, nullptr};
+}
+#endif
+
+// What the server does once it is done with the response
+static void destroy(MHD_Response* response)
+{
+  if(response->fd >= 0) {
+    close(response->fd);
+  }
+  if(response->free) {
+    response->free(response->cls);
+  }
+  delete response;
+}
+
+// Whether the response sends the body from a file holding its bytes
+static bool fromFile(MHD_Response* response, const Buffer& data)
+{
+  if(response->fd < 0) {
+    return false;
+  }
+
+  std::string bytes(data.size(), '\0');
+  ssize_t ret = pread(response->fd, &bytes[0], bytes.size(), response->offset);
+  return ret == ssize_t(data.size()) && bytes == data.toString();
+}
+
+// Whether the response sends the body straight from its buffer
+static bool fromMemory(MHD_Response* response, const Buffer& data)
+{
+  return response->fd < 0 && response->size == data.size()
+#if MHD_VERSION >= 0x00097400
+         && response->data == data.data()
+#endif
+         ;
+}
+
+// Creates a response of the body and tells whether it is sent from a file
+static bool sendsFile(HttpResponses& responses, const Buffer& data)
+{
+  MHD_Response* response = responses.create(data);
+  bool ret = fromFile(response, data);
+  CHECK(ret || fromMemory(response, data));
+  destroy(response);
+
+  return ret;
+}
+
+static Buffer body(const size_t size, const char c)
+{
+  return Buffer(std::string(size, c));
+}
+
+TEST(sends_big_bodies_from_a_file_once_seen_twice)
+{
+  HttpResponses responses;
+  uint64_t sendfile = Metrics::getInstance().getCounter("http.sendfile_responses");
+
+  Buffer small = body(HTTP_SENDFILE_MIN_SIZE - 1, 's');
+  CHECK(!sendsFile(responses, small));
+  CHECK(!sendsFile(responses, small));
+
+  Buffer big = body(2 * HTTP_SENDFILE_MIN_SIZE, 'b');
+  CHECK(!sendsFile(responses, big));
+  CHECK(sendsFile(responses, big));
+  CHECK(sendsFile(responses, big));
+
+  // Slices are sent from the file of their bytes
+  Buffer slice = big.slice(100, HTTP_SENDFILE_MIN_SIZE);
+  CHECK(sendsFile(responses, slice));
+  CHECK(!sendsFile(responses, slice.slice(0, 100)));
+
+  CHECK_EQUAL(Metrics::getInstance().getCounter("http.sendfile_responses") - sendfile,
+              uint64_t(3));
+}
+
+// Bytes freed and others put at the same address are not taken for the
+// ones that were there
+TEST(does_not_send_the_file_of_bytes_gone_from_the_same_address)
+{
+  HttpResponses responses;
+  std::string bytes(HTTP_SENDFILE_MIN_SIZE, 'a');
+  auto noop = [](const std::string*) { };
+
+  {
+    Buffer first(std::shared_ptr<const std::string>(&bytes, noop));
+    CHECK(!sendsFile(responses, first));
+    CHECK(sendsFile(responses, first));
+  }
+
+  bytes.assign(HTTP_SENDFILE_MIN_SIZE, 'b');
+  Buffer second(std::shared_ptr<const std::string>(&bytes, noop));
+  CHECK(second.storage().get() == &bytes);
+
+  // Seen for the first time, and then sent from a file of its own
+  CHECK(!sendsFile(responses, second));
+  CHECK(sendsFile(responses, second));
+}
+
+// Responses created while the file is written are sent from memory, and
+// a single file is written
+TEST(writes_the_file_once_for_concurrent_responses)
+{
+  const int THREADS = 8;
+  const int RESPONSES = 200;
+
+  HttpResponses responses;
+  Buffer data = body(4 * HTTP_SENDFILE_MIN_SIZE, 'c');
+  CHECK(!sendsFile(responses, data));
+
+  std::vector<int> files(THREADS, 0);
+  std::vector<int> wrong(THREADS, 0);
+  std::vector<std::thread> threads;
+  for(int t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&, t]() {
+      for(int i = 0; i < RESPONSES; ++i) {
+        MHD_Response* response = responses.create(data);
+        if(fromFile(response, data)) {
+          ++files[t];
+        } else if(!fromMemory(response, data)) {
+          ++wrong[t];
+        }
+        destroy(response);
+      }
+    });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+
+  int sent = 0;
+  for(int t = 0; t < THREADS; ++t) {
+    CHECK_EQUAL(wrong[t], 0);
+    sent += files[t];
+  }
+  CHECK(sent > 0);
+  CHECK(sendsFile(responses, data));
+
+  // A single descriptor, dup()ed by each response, shares its offset
+  MHD_Response* first = responses.create(data);
+  MHD_Response* second = responses.create(data);
+  CHECK(lseek(first->fd, 0, SEEK_CUR) == lseek(second->fd, 0, SEEK_CUR));
+  lseek(first->fd, 10, SEEK_SET);
+  CHECK_EQUAL(lseek(second->fd, 0, SEEK_CUR), off_t(10));
+  destroy(first);
+  destroy(second);
+}
+
+// Files are evicted, least recently used first, to keep within the bytes
+// allowed
+TEST(keeps_files_within_their_size)
+{
+  const size_t SIZE = (HTTP_FILES_MAX_SIZE) / 8 * 3;
+
+  HttpResponses responses;
+  Buffer a = body(SIZE, 'a');
+  Buffer b = body(SIZE, 'b');
+  Buffer c = body(SIZE, 'c');
+
+  for(auto& data : {a, b}) {
+    CHECK(!sendsFile(responses, data));
+    CHECK(sendsFile(responses, data));
+  }
+
+  // The file of a makes room for the one of c
+  CHECK(!sendsFile(responses, c));
+  CHECK(sendsFile(responses, c));
+  CHECK(sendsFile(responses, b));
+  CHECK(!sendsFile(responses, a));
+
+  // Used more recently than c, so b stays when a is back
+  CHECK(sendsFile(responses, b));
+  CHECK(sendsFile(responses, a));
+  CHECK(sendsFile(responses, b));
+  CHECK(!sendsFile(responses, c));
+
+  // Bodies bigger than all files allowed are never sent from one
+  Buffer huge = body(HTTP_FILES_MAX_SIZE + 1, 'h');
+  CHECK(!sendsFile(responses, huge));
+  CHECK(!sendsFile(responses, huge));
+}
+
+TEST(keeps_a_bounded_number_of_entries)
+{
+  HttpResponses responses;
+  std::vector<Buffer> bodies;
+  for(int i = 0; i <= HTTP_FILES_MAX_ENTRIES; ++i) {
+    bodies.push_back(body(HTTP_SENDFILE_MIN_SIZE, 'e'));
+    CHECK(!sendsFile(responses, bodies.back()));
+  }
+
+  // The first one seen was dropped to make room for the last one
+  CHECK(!sendsFile(responses, bodies.front()));
+  CHECK(sendsFile(responses, bodies.back()));
+}
+
+TEST_MAIN()
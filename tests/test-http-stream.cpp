@@ -0,0 +1,286 @@
+/** Brief: Tests of the streaming of HTTP response bodies
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "protocols/http/http-stream.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <random>
+#include <thread>
+
+// Stand-ins for the functions of libmicrohttpd used by HttpStream, so the
+// tests play the server
+
+struct MHD_Response
+{
+  uint64_t size;
+  MHD_ContentReaderCallback read;
+  void* cls;
+  MHD_ContentReaderFreeCallback free;
+};
+
+struct MHD_Connection
+{
+  std::mutex mutex;
+  std::condition_variable resumed;
+  bool suspended = false;
+  int suspends = 0;
+  int resumes = 0;
+};
+
+struct MHD_Response* MHD_create_response_from_callback(uint64_t size, size_t,
+                                                       MHD_ContentReaderCallback read, void* cls,
+                                                       MHD_ContentReaderFreeCallback free)
+{
+  return new MHD_Response{size, read, cls, free};
+}
+
+void MHD_suspend_connection(struct MHD_Connection* connection)
+{
+  std::lock_guard<std::mutex> lock(connection->mutex);
+  connection->suspended = true;
+  ++connection->suspends;
+}
+
+void MHD_resume_connection(struct MHD_Connection* connection)
+{
+  std::lock_guard<std::mutex> lock(connection->mutex);
+  connection->suspended = false;
+  ++connection->resumes;
+  connection->resumed.notify_all();
+}
+
+// What the server does once it is done with the response
+static void destroy(MHD_Response* response)
+{
+  response->free(response->cls);
+  delete response;
+}
+
+// Reads the body as the server does, waiting while the connection is
+// suspended. Returns how the body ended, or 0 if it stalled.
+static ssize_t readBody(MHD_Response* response, MHD_Connection& connection,
+                        std::string& body, const size_t max = 7)
+{
+  char buf[64];
+  while(true) {
+    {
+      std::unique_lock<std::mutex> lock(connection.mutex);
+      if(!connection.resumed.wait_for(lock, std::chrono::seconds(5),
+                                      [&connection] { return !connection.suspended; })) {
+        return 0;
+      }
+    }
+
+    ssize_t ret = response->read(response->cls, body.size(), buf, std::min(max, sizeof(buf)));
+    if(ret < 0) {
+      return ret;
+    }
+    body.append(buf, ret);
+  }
+}
+
+// Reads what the body has so far, without waiting
+static std::string readReady(MHD_Response* response)
+{
+  char buf[64];
+  std::string ret;
+  ssize_t len;
+  while((len = response->read(response->cls, ret.size(), buf, sizeof(buf))) > 0) {
+    ret.append(buf, len);
+  }
+
+  return ret;
+}
+
+TEST(sends_chunks_back_in_order)
+{
+  MHD_Connection connection;
+  auto stream = std::make_shared<HttpStream>(&connection);
+  MHD_Response* response = HttpStream::createResponse(stream, MHD_SIZE_UNKNOWN);
+  CHECK_EQUAL(response->size, MHD_SIZE_UNKNOWN);
+
+  CHECK(!stream->push(2, Buffer("ghi"), true));
+  CHECK(!stream->push(1, Buffer("def"), false));
+
+  // Nothing in order yet, so the server is told to wait
+  CHECK_EQUAL(readReady(response), "");
+  CHECK(connection.suspended);
+  CHECK_EQUAL(connection.suspends, 1);
+
+  CHECK(stream->push(0, Buffer("abc"), false));
+  CHECK(!connection.suspended);
+  CHECK_EQUAL(connection.resumes, 1);
+
+  std::string body;
+  CHECK_EQUAL(readBody(response, connection, body), MHD_CONTENT_READER_END_OF_STREAM);
+  CHECK_EQUAL(body, "abcdefghi");
+
+  destroy(response);
+}
+
+TEST(sends_chunks_as_soon_as_they_are_in_order)
+{
+  MHD_Connection connection;
+  auto stream = std::make_shared<HttpStream>(&connection);
+  MHD_Response* response = HttpStream::createResponse(stream, 6);
+
+  CHECK(!stream->push(0, Buffer("abc"), false));
+  CHECK_EQUAL(readReady(response), "abc");
+  CHECK(connection.suspended);
+
+  CHECK(stream->push(1, Buffer("def"), true));
+  CHECK(!connection.suspended);
+  CHECK_EQUAL(readReady(response), "def");
+  CHECK_EQUAL(response->read(response->cls, 6, nullptr, 0), MHD_CONTENT_READER_END_OF_STREAM);
+
+  destroy(response);
+}
+
+TEST(drops_duplicate_chunks)
+{
+  MHD_Connection connection;
+  auto stream = std::make_shared<HttpStream>(&connection);
+  MHD_Response* response = HttpStream::createResponse(stream, MHD_SIZE_UNKNOWN);
+
+  CHECK(!stream->push(0, Buffer("abc"), false));
+  CHECK(!stream->push(2, Buffer("ghi"), true));
+  CHECK(!stream->push(0, Buffer("xxx"), false));   // Already sent
+  CHECK(!stream->push(2, Buffer("yyy"), true));    // Already waiting
+  CHECK(stream->push(1, Buffer("def"), false));
+  CHECK(stream->push(1, Buffer("zzz"), false));    // Complete anyway
+
+  std::string body;
+  CHECK_EQUAL(readBody(response, connection, body), MHD_CONTENT_READER_END_OF_STREAM);
+  CHECK_EQUAL(body, "abcdefghi");
+
+  destroy(response);
+}
+
+TEST(skips_empty_chunks)
+{
+  MHD_Connection connection;
+  auto stream = std::make_shared<HttpStream>(&connection);
+  MHD_Response* response = HttpStream::createResponse(stream, MHD_SIZE_UNKNOWN);
+
+  CHECK(!stream->push(0, Buffer(), false));
+  CHECK(!stream->push(1, Buffer("abc"), false));
+  CHECK(stream->push(2, Buffer(), true));
+
+  std::string body;
+  CHECK_EQUAL(readBody(response, connection, body, 2), MHD_CONTENT_READER_END_OF_STREAM);
+  CHECK_EQUAL(body, "abc");
+  destroy(response);
+
+  // A single empty chunk is an empty body
+  MHD_Connection other;
+  stream = std::make_shared<HttpStream>(&other);
+  response = HttpStream::createResponse(stream, 0);
+  CHECK(stream->push(0, Buffer(), true));
+  body.clear();
+  CHECK_EQUAL(readBody(response, other, body), MHD_CONTENT_READER_END_OF_STREAM);
+  CHECK_EQUAL(body, "");
+  CHECK_EQUAL(other.suspends, 0);
+  destroy(response);
+}
+
+TEST(cuts_the_body_short_on_failure)
+{
+  MHD_Connection connection;
+  auto stream = std::make_shared<HttpStream>(&connection);
+  MHD_Response* response = HttpStream::createResponse(stream, MHD_SIZE_UNKNOWN);
+
+  stream->push(0, Buffer("abc"), false);
+  CHECK_EQUAL(readReady(response), "abc");
+  CHECK(connection.suspended);
+
+  // The waiting server is woken up to end the body with an error, not as
+  // if it were complete
+  stream->fail();
+  CHECK(!connection.suspended);
+  std::string body;
+  CHECK_EQUAL(readBody(response, connection, body), MHD_CONTENT_READER_END_WITH_ERROR);
+  CHECK_EQUAL(body, "");
+
+  // Chunks arriving later do not change that
+  stream->push(1, Buffer("def"), true);
+  CHECK_EQUAL(readBody(response, connection, body), MHD_CONTENT_READER_END_WITH_ERROR);
+  CHECK_EQUAL(body, "");
+
+  destroy(response);
+}
+
+TEST(does_not_resume_a_closed_connection)
+{
+  MHD_Connection connection;
+  auto stream = std::make_shared<HttpStream>(&connection);
+  MHD_Response* response = HttpStream::createResponse(stream, MHD_SIZE_UNKNOWN);
+
+  CHECK_EQUAL(readReady(response), "");
+  CHECK(connection.suspended);
+
+  // The client went away, but the stream lives on with its producer
+  destroy(response);
+  stream->push(0, Buffer("abc"), true);
+  stream->fail();
+  CHECK_EQUAL(connection.resumes, 0);
+}
+
+TEST(streams_chunks_pushed_from_many_threads)
+{
+  const size_t CHUNKS = 2000;
+  const int THREADS = 4;
+
+  MHD_Connection connection;
+  auto stream = std::make_shared<HttpStream>(&connection);
+  MHD_Response* response = HttpStream::createResponse(stream, MHD_SIZE_UNKNOWN);
+
+  std::string expected;
+  for(size_t i = 0; i < CHUNKS; ++i) {
+    expected += std::to_string(i) + ",";
+  }
+
+  // Each thread pushes every THREADS-th chunk, in a shuffled order
+  std::vector<std::thread> threads;
+  for(int t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&stream, t, CHUNKS, THREADS]() {
+      std::vector<size_t> numbers;
+      for(size_t i = t; i < CHUNKS; i += THREADS) {
+        numbers.push_back(i);
+      }
+      std::shuffle(numbers.begin(), numbers.end(), std::mt19937(t));
+      for(auto i : numbers) {
+        stream->push(i, Buffer(std::to_string(i) + ","), i == CHUNKS - 1);
+      }
+    });
+  }
+
+  std::string body;
+  ssize_t ret = readBody(response, connection, body, 13);
+  for(auto& thread : threads) {
+    thread.join();
+  }
+
+  CHECK_EQUAL(ret, MHD_CONTENT_READER_END_OF_STREAM);
+  CHECK(body == expected);
+
+  destroy(response);
+}
+
+TEST_MAIN()
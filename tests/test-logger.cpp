@@ -0,0 +1,110 @@
+/** Brief: Tests of the logger
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Messages of less severe levels than WARN are not compiled in
+#define FIFU_LOG_MIN_LEVEL LOG_LEVEL_WARN
+
+#include "test.hpp"
+#include "logger.hpp"
+
+#include <sstream>
+#include <thread>
+
+// Written log, captured before the logger starts
+static std::ostringstream output;
+static std::streambuf* captured = std::clog.rdbuf(output.rdbuf());
+
+// Lines written since the last call
+static std::vector<std::string> written()
+{
+  Logger::getInstance().flush();
+
+  std::vector<std::string> lines;
+  std::istringstream in(output.str());
+  for(std::string line; std::getline(in, line); ) {
+    lines.push_back(line);
+  }
+  output.str("");
+
+  return lines;
+}
+
+TEST(writes_messages_of_enabled_levels)
+{
+  Logger::getInstance().setLevel(LOG_LEVEL_WARN);
+  FIFU_LOG_ERROR("an error");
+  FIFU_LOG_WARN("a warning");
+
+  std::vector<std::string> lines = written();
+  CHECK_EQUAL(lines.size(), size_t(2));
+  CHECK(lines[0].find(" [ERROR] an error") != std::string::npos);
+  CHECK(lines[1].find(" [WARN] a warning") != std::string::npos);
+
+  Logger::getInstance().setLevel(LOG_LEVEL_ERROR);
+  FIFU_LOG_WARN("not written");
+  CHECK(written().empty());
+}
+
+TEST(leaves_out_levels_below_the_minimum)
+{
+  Logger::getInstance().setLevel(LOG_LEVEL_ALL);
+
+  size_t built = 0;
+  auto message = [&built]() { ++built; return std::string("built"); };
+  FIFU_LOG_INFO(message());
+  FIFU_LOG_DEBUG(message());
+  FIFU_LOG_WARN(message());
+
+  CHECK_EQUAL(built, size_t(1));
+  CHECK_EQUAL(written().size(), size_t(1));
+}
+
+TEST(writes_messages_of_each_thread_in_order)
+{
+  Logger::getInstance().setLevel(LOG_LEVEL_WARN);
+
+  // More than a ring holds, from threads that are gone by the time the
+  // messages are written
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 4; ++t) {
+    threads.emplace_back([t]() {
+                           for(int i = 0; i < 2 * LOGGER_RING_SIZE; ++i) {
+                             FIFU_LOG_WARN(std::to_string(t) + " " + std::to_string(i));
+                           }
+                         });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<std::string> lines = written();
+  CHECK_EQUAL(lines.size(), size_t(4 * 2 * LOGGER_RING_SIZE));
+
+  // Messages of different threads are only sorted by time within the
+  // batch they were written in
+  std::vector<int> next(4, 0);
+  bool ordered = true;
+  for(auto& line : lines) {
+    int t = -1, i = -1;
+    sscanf(line.c_str() + line.find("] ") + 2, "%d %d", &t, &i);
+
+    ordered = ordered && t >= 0 && t < 4 && i == next[t]++;
+  }
+  CHECK(ordered);
+}
+
+TEST_MAIN()
@@ -0,0 +1,163 @@
+/** Brief: Tests of the URI mapping table
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "mapping-table.hpp"
+
+#include <thread>
+
+TEST(resolves_both_directions)
+{
+  MappingTable table;
+  CHECK(table.insert(Uri("ndn:/a/b"), Uri("http://example.org/b")));
+  CHECK(table.insert(Uri("pursuit:ABCD"), Uri("http://example.org/b")));
+
+  Uri o_uri;
+  CHECK(table.getOriginal(Uri("ndn:/a/b"), o_uri));
+  CHECK_EQUAL(o_uri.toString(), "http://example.org/b");
+  CHECK(!table.getOriginal(Uri("ndn:/a/c"), o_uri));
+
+  std::map<std::string, Uri> f_uris = table.getForeign(Uri("http://example.org/b"));
+  CHECK_EQUAL(f_uris.size(), size_t(2));
+  CHECK_EQUAL(f_uris["ndn"].toString(), "ndn:/a/b");
+  CHECK_EQUAL(f_uris["pursuit"].toString(), "pursuit:ABCD");
+  CHECK(table.getForeign(Uri("http://example.org/c")).empty());
+  CHECK_EQUAL(table.size(), size_t(2));
+}
+
+TEST(keeps_one_original_per_foreign_uri)
+{
+  MappingTable table;
+  CHECK(table.insert(Uri("ndn:/x"), Uri("http://example.org/1")));
+  CHECK(!table.insert(Uri("ndn:/x"), Uri("http://example.org/2")));
+
+  Uri o_uri;
+  CHECK(table.getOriginal(Uri("ndn:/x"), o_uri));
+  CHECK_EQUAL(o_uri.toString(), "http://example.org/1");
+  CHECK(table.getForeign(Uri("http://example.org/2")).empty());
+}
+
+TEST(installs_only_missing_mappings)
+{
+  MappingTable table;
+  table.insert(Uri("ndn:/y"), Uri("http://example.org/y"));
+
+  std::vector<std::string> installed;
+  auto install = [&installed](const std::string& scheme) {
+    installed.push_back(scheme);
+    return Uri(scheme + ":/installed/y");
+  };
+
+  std::map<std::string, Uri> f_uris =
+    table.getOrInstallForeign(Uri("http://example.org/y"), {"ndn", "pursuit"}, install);
+  CHECK_EQUAL(installed.size(), size_t(1));
+  CHECK_EQUAL(installed.front(), "pursuit");
+  CHECK_EQUAL(f_uris["ndn"].toString(), "ndn:/y");
+  CHECK_EQUAL(f_uris["pursuit"].toString(), "pursuit:/installed/y");
+
+  // All of them exist now
+  table.getOrInstallForeign(Uri("http://example.org/y"), {"ndn", "pursuit"}, install);
+  CHECK_EQUAL(installed.size(), size_t(1));
+
+  Uri o_uri;
+  CHECK(table.getOriginal(Uri("pursuit:/installed/y"), o_uri));
+  CHECK_EQUAL(o_uri.toString(), "http://example.org/y");
+}
+
+TEST(installs_outside_the_table_lock)
+{
+  MappingTable table;
+
+  // The installer uses the table itself, which would deadlock if it was
+  // called with a lock held. What it inserted meanwhile wins.
+  auto install = [&table](const std::string& scheme) {
+    table.insert(Uri(scheme + ":/first/z"), Uri("http://example.org/z"));
+    return Uri(scheme + ":/second/z");
+  };
+
+  std::map<std::string, Uri> f_uris =
+    table.getOrInstallForeign(Uri("http://example.org/z"), {"ndn"}, install);
+  CHECK_EQUAL(f_uris["ndn"].toString(), "ndn:/first/z");
+
+  Uri o_uri;
+  CHECK(!table.getOriginal(Uri("ndn:/second/z"), o_uri));
+  CHECK_EQUAL(table.getForeign(Uri("http://example.org/z")).size(), size_t(1));
+}
+
+TEST(agrees_on_one_installed_mapping)
+{
+  MappingTable table;
+  std::vector<std::map<std::string, Uri>> results(8);
+  std::vector<std::thread> threads;
+  for(size_t t = 0; t < results.size(); ++t) {
+    threads.emplace_back([&table, &results, t]() {
+                           auto install = [t](const std::string& scheme) {
+                             return Uri(scheme + ":/thread/" + std::to_string(t));
+                           };
+                           results[t] = table.getOrInstallForeign(Uri("http://example.org/w"),
+                                                                  {"ndn"}, install);
+                         });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+
+  std::string winner = table.getForeign(Uri("http://example.org/w"))["ndn"].toString();
+  for(auto& result : results) {
+    CHECK_EQUAL(result["ndn"].toString(), winner);
+  }
+  CHECK_EQUAL(table.size(), size_t(1));
+}
+
+TEST(leaves_out_installed_uris_of_other_originals)
+{
+  MappingTable table;
+  table.insert(Uri("ndn:/taken"), Uri("http://example.org/taken"));
+
+  auto install = [](const std::string& scheme) {
+    return Uri(scheme == "ndn" ? "ndn:/taken" : "pursuit:0123");
+  };
+  std::map<std::string, Uri> f_uris =
+    table.getOrInstallForeign(Uri("http://example.org/other"), {"ndn", "pursuit"}, install);
+  CHECK_EQUAL(f_uris.size(), size_t(1));
+  CHECK_EQUAL(f_uris["pursuit"].toString(), "pursuit:0123");
+
+  Uri o_uri;
+  CHECK(table.getOriginal(Uri("ndn:/taken"), o_uri));
+  CHECK_EQUAL(o_uri.toString(), "http://example.org/taken");
+  CHECK_EQUAL(table.getForeign(o_uri).size(), size_t(1));
+  CHECK_EQUAL(table.size(), size_t(2));
+}
+
+TEST(scales_to_many_mappings)
+{
+  MappingTable table;
+  for(int i = 0; i < 100000; ++i) {
+    table.insert(Uri("ndn:/many/" + std::to_string(i)),
+                 Uri("http://example.org/many/" + std::to_string(i)));
+  }
+  CHECK_EQUAL(table.size(), size_t(100000));
+
+  Uri o_uri;
+  for(int i = 0; i < 100000; i += 997) {
+    CHECK(table.getOriginal(Uri("ndn:/many/" + std::to_string(i)), o_uri));
+    CHECK_EQUAL(o_uri.toString(), "http://example.org/many/" + std::to_string(i));
+    CHECK_EQUAL(table.getForeign(o_uri)["ndn"].toString(), "ndn:/many/" + std::to_string(i));
+  }
+}
+
+TEST_MAIN()
@@ -0,0 +1,88 @@
+/** Brief: Tests of the metadata of MetaMessage
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "metamessage.hpp"
+
+TEST(defaults_missing_metadata)
+{
+  MetaMessage msg;
+  CHECK_EQUAL(msg.getMessageType(), MESSAGE_TYPE_UNKNOWN);
+  CHECK(!msg.getKeepSession());
+  CHECK_EQUAL(msg.getChunkNumber(), size_t(-1));
+  CHECK_EQUAL(msg.getContentLength(), size_t(-1));
+  CHECK(msg.getDeadline() == std::chrono::steady_clock::time_point::max());
+  CHECK_EQUAL(msg.getTraceId(), uint64_t(0));
+  CHECK_EQUAL(msg.getFreshness(), -1L);
+}
+
+TEST(keeps_typed_metadata)
+{
+  MetaMessage msg;
+  msg.setMessageType(MESSAGE_TYPE_RESPONSE);
+  msg.setKeepSession(true);
+  msg.setChunkNumber(7);
+  msg.setTraceId(99);
+  msg.setContent("text/plain", Buffer(std::string("abc")));
+
+  CHECK_EQUAL(msg.getMessageType(), MESSAGE_TYPE_RESPONSE);
+  CHECK(msg.getKeepSession());
+  CHECK_EQUAL(msg.getChunkNumber(), size_t(7));
+  CHECK_EQUAL(msg.getTraceId(), uint64_t(99));
+  CHECK_EQUAL(msg.getContentLength(), size_t(3));
+
+  // Unknown types are ignored
+  msg.setMessageType((MetadataMessageType) 17);
+  CHECK_EQUAL(msg.getMessageType(), MESSAGE_TYPE_RESPONSE);
+}
+
+TEST(keeps_extension_keys)
+{
+  MetaMessage msg;
+  std::string value;
+  CHECK(!msg.getExtension("X-Custom", value));
+
+  msg.setExtension("X-Custom", "1");
+  msg.setExtension("X-Custom", "2");
+  CHECK(msg.getExtension("X-Custom", value));
+  CHECK_EQUAL(value, "2");
+
+  MetaMessage out;
+  out.setMetadata(msg.getMetadata());
+  CHECK(out.getExtension("X-Custom", value));
+}
+
+TEST(resets_messages_given_back_to_the_pool)
+{
+  MetaMessage* raw;
+  {
+    MetaMessagePtr msg = createMetaMessage();
+    msg->setMessageType(MESSAGE_TYPE_REQUEST);
+    msg->setExtension("X-Custom", "1");
+    raw = msg.get();
+  }
+
+  // The same thread gets its last released message back
+  MetaMessagePtr msg = createMetaMessage();
+  CHECK(msg.get() == raw);
+
+  std::string value;
+  CHECK_EQUAL(msg->getMessageType(), MESSAGE_TYPE_UNKNOWN);
+  CHECK(!msg->getExtension("X-Custom", value));
+}
+
+TEST_MAIN()
@@ -0,0 +1,196 @@
+/** Brief: Tests of the object pool, and of its allocations
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "concurrent-blocking-queue.hpp"
+#include "object-pool.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Every allocation made through operator new, in any thread
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size)
+{
+  ++allocations;
+  void* ptr = malloc(size ? size : 1);
+  if(ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+// Each test uses an object type (hence a pool) of its own, which counts
+// how many of its objects were ever allocated (objects are reset by
+// assigning them a temporary one, so constructions are not counted)
+template<int N>
+struct Item
+{
+  static std::atomic<size_t> created;
+
+  int value = 0;
+
+  static void* operator new(size_t size)
+  {
+    ++created;
+    return ::operator new(size);
+  }
+
+  static void operator delete(void* ptr)
+  {
+    ::operator delete(ptr);
+  }
+};
+
+template<int N>
+std::atomic<size_t> Item<N>::created(0);
+
+TEST(reuses_released_objects)
+{
+  typedef Item<0> Object;
+
+  ObjectPool<Object>::Ptr object = ObjectPool<Object>::acquire();
+  Object* address = object.get();
+  object->value = 7;
+  object.reset();
+
+  // Reset to a default-constructed state
+  object = ObjectPool<Object>::acquire();
+  CHECK(object.get() == address);
+  CHECK_EQUAL(object->value, 0);
+}
+
+// Caches of exited threads go back to the pool shared by all threads
+TEST(takes_objects_left_by_other_threads)
+{
+  typedef Item<1> Object;
+  const size_t N = OBJECT_POOL_LOCAL_CAPACITY / 2;
+
+  std::thread([]() {
+                std::vector<ObjectPool<Object>::Ptr> objects;
+                for(size_t i = 0; i < N; ++i) {
+                  objects.push_back(ObjectPool<Object>::acquire());
+                }
+              }).join();
+  CHECK_EQUAL(size_t(Object::created), N);
+
+  std::vector<ObjectPool<Object>::Ptr> objects;
+  for(size_t i = 0; i < N; ++i) {
+    objects.push_back(ObjectPool<Object>::acquire());
+  }
+  CHECK_EQUAL(size_t(Object::created), N);
+}
+
+// Objects acquired by a thread and released by another flow back to the
+// first one through the shared pool, rather than piling up in the cache
+// of the second one
+TEST(returns_objects_freed_on_another_thread)
+{
+  typedef Item<2> Object;
+  const size_t N = 1000;
+  const int ROUNDS = 10;
+
+  std::vector<ObjectPool<Object>::Ptr> objects;
+  for(int round = 0; round < ROUNDS; ++round) {
+    std::thread([&objects]() {
+                  for(size_t i = 0; i < N; ++i) {
+                    objects.push_back(ObjectPool<Object>::acquire());
+                  }
+                }).join();
+    std::thread([&objects]() { objects.clear(); }).join();
+  }
+
+  CHECK_EQUAL(size_t(Object::created), N);
+}
+
+// In steady state, messages handed from a producer to a consumer thread
+// are recycled without any allocation
+TEST(allocates_nothing_in_steady_state)
+{
+  typedef Item<3> Object;
+  const size_t WARM_UP = 10000;
+  const size_t MEASURED = 100000;
+  const size_t CAPACITY = 256;
+  const size_t IN_FLIGHT = CAPACITY + OBJECT_POOL_LOCAL_CAPACITY + 2;
+
+  ConcurrentBlockingQueue<ObjectPool<Object>::Ptr> queue(CAPACITY);
+  std::atomic<size_t> consumed(0);
+  size_t allocated = 0;
+
+  std::thread consumer([&queue, &consumed]() {
+                         try {
+                           for(;;) {
+                             ObjectPool<Object>::Ptr object = queue.pop();
+                             object->value = 1;
+                             object.reset();
+                             ++consumed;
+                           }
+                         } catch(...) {
+                           // Stopped
+                         }
+                       });
+
+  std::thread producer([&queue, &consumed, &allocated]() {
+                         auto produce = [&queue, &consumed](const size_t count) {
+                           size_t target = consumed.load() + count;
+                           for(size_t i = 0; i < count; ++i) {
+                             queue.push(ObjectPool<Object>::acquire());
+                           }
+                           while(consumed.load() < target) {
+                             std::this_thread::yield();
+                           }
+                         };
+
+                         // The pool starts with as many objects as can be in flight
+                         // at once (in the queue, in the cache of the consumer and
+                         // in the hands of either thread)
+                         {
+                           std::vector<ObjectPool<Object>::Ptr> objects;
+                           for(size_t i = 0; i < IN_FLIGHT; ++i) {
+                             objects.push_back(ObjectPool<Object>::acquire());
+                           }
+                         }
+                         produce(WARM_UP);
+
+                         size_t before = allocations.load();
+                         produce(MEASURED);
+                         allocated = allocations.load() - before;
+                         queue.stop();
+                       });
+
+  producer.join();
+  consumer.join();
+
+  CHECK_EQUAL(allocated, size_t(0));
+  CHECK_EQUAL(size_t(Object::created), IN_FLIGHT);
+}
+
+TEST_MAIN()
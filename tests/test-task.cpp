@@ -0,0 +1,188 @@
+/** Brief: Tests of the tasks run by the thread pool, and of their allocations
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "concurrent-blocking-queue.hpp"
+#include "metamessage.hpp"
+#include "thread-pool.hpp"
+
+#include <array>
+#include <cstdlib>
+#include <memory>
+
+// Messages being processed at any time, as bounded by the processing slots
+// of the Core
+#define IN_FLIGHT 64
+
+// Every allocation made through operator new, in any thread
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size)
+{
+  ++allocations;
+  void* ptr = malloc(size ? size : 1);
+  if(ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+// Stands for the Core (or a plugin), which schedules the processing of
+// each message it takes from its queue
+class Processor
+{
+private:
+  ConcurrentBlockingQueue<MetaMessagePtr> _queue;
+  std::atomic<size_t> _processed;
+  size_t _scheduled;
+  ThreadPool _tp;
+
+public:
+  Processor()
+    : _processed(0), _scheduled(0), _tp(2)
+  { }
+
+  void push(MetaMessagePtr&& msg)
+  {
+    _queue.push(std::move(msg));
+  }
+
+  void schedule()
+  {
+    // Wait for a processing slot
+    while(_scheduled - _processed.load() >= IN_FLIGHT) {
+      std::this_thread::yield();
+    }
+    ++_scheduled;
+
+    MetaMessagePtr in = _queue.pop();
+    _tp.schedule([this, in = std::move(in)]() mutable { processMessage(std::move(in)); });
+  }
+
+  void waitFor(const size_t processed)
+  {
+    while(_processed.load() < processed) {
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  void processMessage(MetaMessagePtr msg)
+  {
+    msg->setTraceId(1);
+    ++_processed;
+  }
+};
+
+// Allocations made while running f (no other thread may be running)
+template<typename F>
+static size_t countAllocations(F&& f)
+{
+  size_t before = allocations.load();
+  f();
+  return allocations.load() - before;
+}
+
+TEST(stores_small_callables_inline)
+{
+  MetaMessagePtr msg = createMetaMessage();
+  void* self = &msg;
+
+  size_t count = countAllocations([&]() {
+                                    Task task([self, msg = std::move(msg)]() { CHECK(self != nullptr); });
+                                    Task moved(std::move(task));
+                                    CHECK(!task);
+                                    moved();
+                                    moved = nullptr;
+                                  });
+  CHECK_EQUAL(count, size_t(0));
+}
+
+TEST(stores_large_callables_in_the_heap)
+{
+  std::array<char, 2 * TASK_INLINE_SIZE> large;
+  large.fill('a');
+  auto owner = std::make_shared<int>(0);
+
+  char seen = 0;
+  size_t count = countAllocations([&]() {
+                                    Task task([large, owner, &seen]() { seen = large.back(); });
+                                    Task moved(std::move(task));
+                                    moved();
+                                  });
+  CHECK_EQUAL(count, size_t(1));
+  CHECK_EQUAL(seen, 'a');
+  CHECK_EQUAL(owner.use_count(), long(1));
+}
+
+TEST(runs_move_only_callables)
+{
+  std::unique_ptr<int> value(new int(7));
+  int seen = 0;
+
+  Task task([value = std::move(value), &seen]() { seen = *value; });
+  Task moved;
+  moved = std::move(task);
+  moved();
+  CHECK_EQUAL(seen, 7);
+}
+
+TEST(schedules_messages_without_allocating)
+{
+  Processor processor;
+
+  // Fill the pool of messages with more than will ever be in use at once
+  {
+    std::vector<MetaMessagePtr> msgs;
+    msgs.reserve(4 * IN_FLIGHT + 2 * OBJECT_POOL_LOCAL_CAPACITY);
+    for(size_t i = 0; i < msgs.capacity(); ++i) {
+      msgs.push_back(createMetaMessage());
+    }
+  }
+
+  // Warm up the rings of jobs and the caches of messages of each thread
+  size_t sent = 0;
+  for(int round = 0; round < 2; ++round) {
+    for(int i = 0; i < 10000; ++i, ++sent) {
+      processor.push(createMetaMessage());
+      processor.schedule();
+    }
+    processor.waitFor(sent);
+  }
+
+  size_t before = allocations.load();
+  for(int i = 0; i < 10000; ++i, ++sent) {
+    processor.push(createMetaMessage());
+    processor.schedule();
+  }
+  processor.waitFor(sent);
+
+  CHECK_EQUAL(allocations.load() - before, size_t(0));
+}
+
+TEST_MAIN()
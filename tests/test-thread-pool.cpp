@@ -0,0 +1,171 @@
+/** Brief: Tests of the thread pool
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "thread-pool.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+
+// Waits (up to a few seconds) until the given number of jobs ran
+class Countdown
+{
+private:
+  std::mutex _mutex;
+  std::condition_variable _cond;
+  size_t _count;
+
+public:
+  Countdown(const size_t count)
+    : _count(count)
+  { }
+
+  void done()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(--_count == 0) {
+      _cond.notify_all();
+    }
+  }
+
+  bool wait()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _cond.wait_for(lock, std::chrono::seconds(10), [this]() { return _count == 0; });
+  }
+};
+
+// The pools are declared last, so that their workers are gone before
+// anything their jobs use
+
+TEST(runs_jobs_from_many_threads)
+{
+  Countdown countdown(4 * 10000);
+  std::atomic<size_t> ran(0);
+  ThreadPool pool(4);
+
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 4; ++t) {
+    threads.emplace_back([&]() {
+                           for(int i = 0; i < 10000; ++i) {
+                             pool.schedule([&]() { ++ran; countdown.done(); });
+                           }
+                         });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(countdown.wait());
+  CHECK_EQUAL(ran.load(), size_t(4 * 10000));
+}
+
+TEST(runs_jobs_scheduled_by_jobs)
+{
+  Countdown countdown((1 << 14) - 1);
+  std::function<void(int)> split;
+  ThreadPool pool(4);
+
+  // Every job schedules two more, down to the given depth
+  split = [&](const int depth) {
+    countdown.done();
+    if(depth > 1) {
+      pool.schedule([&split, depth]() { split(depth - 1); });
+      pool.schedule([&split, depth]() { split(depth - 1); });
+    }
+  };
+
+  pool.schedule([&split]() { split(14); });
+  CHECK(countdown.wait());
+}
+
+TEST(runs_external_jobs_in_order)
+{
+  std::mutex gate;
+  std::vector<int> order;
+  Countdown countdown(1000);
+  ThreadPool pool(1);
+
+  // Hold the only worker until all jobs are scheduled
+  gate.lock();
+  pool.schedule([&gate]() { std::lock_guard<std::mutex> lock(gate); });
+  for(int i = 0; i < 1000; ++i) {
+    pool.schedule([&order, &countdown, i]() { order.push_back(i); countdown.done(); });
+  }
+  gate.unlock();
+
+  CHECK(countdown.wait());
+  bool ordered = true;
+  for(int i = 0; i < (int) order.size(); ++i) {
+    ordered = ordered && order[i] == i;
+  }
+  CHECK(ordered);
+}
+
+TEST(does_not_starve_external_jobs)
+{
+  std::atomic<bool> spinning(true);
+  Countdown stopped(1);
+  Countdown external(1);
+  std::function<void()> spin;
+  ThreadPool pool(1);
+
+  // A job that keeps scheduling itself on the only worker
+  spin = [&]() {
+    if(spinning) {
+      pool.schedule([&spin]() { spin(); });
+    } else {
+      stopped.done();
+    }
+  };
+  pool.schedule([&spin]() { spin(); });
+
+  pool.schedule([&]() { external.done(); });
+  CHECK(external.wait());
+
+  spinning = false;
+  CHECK(stopped.wait());
+}
+
+TEST(destroys_pending_jobs_with_the_pool)
+{
+  auto resource = std::make_shared<int>(0);
+  std::atomic<bool> held(true);
+
+  // Let the worker go only once the pool is being destroyed
+  std::thread release([&held]() {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                        held = false;
+                      });
+  {
+    ThreadPool pool(1);
+    pool.schedule([&held]() {
+                    while(held) {
+                      std::this_thread::yield();
+                    }
+                  });
+    for(int i = 0; i < 100; ++i) {
+      pool.schedule([resource]() { ++*resource; });
+    }
+  }
+  release.join();
+
+  CHECK_EQUAL(resource.use_count(), long(1));
+}
+
+TEST_MAIN()
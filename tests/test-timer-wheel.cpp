@@ -0,0 +1,143 @@
+/** Brief: Tests of the timer wheel
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "timer-wheel.hpp"
+
+#include <algorithm>
+#include <map>
+
+// The wheel is driven with made up times, one second per tick, so that
+// nothing depends on the scheduling of the test
+typedef std::chrono::steady_clock Clock;
+
+static std::vector<int> advance(TimerWheel<int>& wheel, const Clock::time_point time)
+{
+  std::vector<int> expired = wheel.advance(time);
+  std::sort(expired.begin(), expired.end());
+  return expired;
+}
+
+TEST(fires_at_the_first_tick_after_the_deadline)
+{
+  Clock::time_point start = Clock::now();
+  TimerWheel<int> wheel(std::chrono::seconds(1), 8);
+
+  wheel.schedule(start + std::chrono::milliseconds(2500), 1);
+  wheel.schedule(start + std::chrono::milliseconds(4500), 2);
+  CHECK_EQUAL(wheel.size(), size_t(2));
+
+  CHECK(advance(wheel, start + std::chrono::milliseconds(2900)).empty());
+  CHECK_EQUAL(advance(wheel, start + std::chrono::milliseconds(3500)), std::vector<int>({1}));
+  CHECK(advance(wheel, start + std::chrono::milliseconds(4900)).empty());
+  CHECK_EQUAL(advance(wheel, start + std::chrono::milliseconds(5500)), std::vector<int>({2}));
+  CHECK_EQUAL(wheel.size(), size_t(0));
+}
+
+TEST(fires_past_deadlines_at_the_next_tick)
+{
+  Clock::time_point start = Clock::now();
+  TimerWheel<int> wheel(std::chrono::seconds(1), 8);
+
+  advance(wheel, start + std::chrono::milliseconds(3500));
+  wheel.schedule(start, 1);
+  CHECK_EQUAL(advance(wheel, start + std::chrono::milliseconds(4500)), std::vector<int>({1}));
+}
+
+TEST(waits_for_the_remaining_turns)
+{
+  Clock::time_point start = Clock::now();
+  TimerWheel<int> wheel(std::chrono::seconds(1), 8);
+
+  // Same slot, one, two and three turns apart
+  wheel.schedule(start + std::chrono::milliseconds(2500), 0);
+  wheel.schedule(start + std::chrono::milliseconds(10500), 1);
+  wheel.schedule(start + std::chrono::milliseconds(18500), 2);
+  wheel.schedule(start + std::chrono::milliseconds(26500), 3);
+
+  std::vector<int> expired;
+  for(int second = 1; second <= 30; ++second) {
+    for(int value : advance(wheel, start + std::chrono::milliseconds(second * 1000 + 500))) {
+      CHECK_EQUAL(second, 3 + 8 * value);
+      expired.push_back(value);
+    }
+  }
+  CHECK_EQUAL(expired, std::vector<int>({0, 1, 2, 3}));
+  CHECK_EQUAL(wheel.size(), size_t(0));
+}
+
+TEST(catches_up_on_missed_ticks)
+{
+  Clock::time_point start = Clock::now();
+  TimerWheel<int> wheel(std::chrono::seconds(1), 8);
+
+  for(int i = 0; i < 20; ++i) {
+    wheel.schedule(start + std::chrono::milliseconds(i * 1000 + 500), i);
+  }
+
+  // More than two turns at once
+  std::vector<int> expired = advance(wheel, start + std::chrono::milliseconds(15500));
+  CHECK_EQUAL(expired.size(), size_t(15));
+  CHECK_EQUAL(expired.back(), 14);
+  CHECK_EQUAL(wheel.size(), size_t(5));
+
+  CHECK_EQUAL(advance(wheel, start + std::chrono::milliseconds(30500)).size(), size_t(5));
+}
+
+// Timers are cancelled by ignoring them when they fire, and re-armed by
+// scheduling them again, as the Core does with the deadlines of requests
+TEST(rearms_expired_timers)
+{
+  Clock::time_point start = Clock::now();
+  TimerWheel<int> wheel(std::chrono::seconds(1), 8);
+
+  std::map<int, Clock::time_point> deadlines;
+  deadlines[1] = start + std::chrono::milliseconds(2500);
+  deadlines[2] = start + std::chrono::milliseconds(2500);
+  for(auto& item : deadlines) {
+    wheel.schedule(item.second, item.first);
+  }
+
+  // 1 is postponed by a turn and a half and 2 is cancelled
+  deadlines[1] += std::chrono::milliseconds(12000);
+  deadlines.erase(2);
+
+  std::vector<int> fired;
+  for(int second = 1; second <= 30; ++second) {
+    Clock::time_point now = start + std::chrono::milliseconds(second * 1000 + 500);
+    for(int value : advance(wheel, now)) {
+      auto it = deadlines.find(value);
+      if(it == deadlines.end()) {
+        continue;
+      }
+
+      if(it->second > now) {
+        wheel.schedule(it->second, value);
+        continue;
+      }
+
+      CHECK_EQUAL(second, 15);
+      fired.push_back(value);
+      deadlines.erase(it);
+    }
+  }
+
+  CHECK_EQUAL(fired, std::vector<int>({1}));
+  CHECK_EQUAL(wheel.size(), size_t(0));
+}
+
+TEST_MAIN()
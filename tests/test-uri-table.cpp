@@ -0,0 +1,139 @@
+/** Brief: Tests of the table of interned URIs
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "uri-table.hpp"
+
+#include <thread>
+
+// The table is shared by the whole program, so each test uses URIs of its
+// own
+
+static void checkSame(const Uri& uri, const Uri& copy)
+{
+  CHECK(copy.isValid());
+  CHECK_EQUAL(copy.toString(), uri.toString());
+  CHECK_EQUAL(copy.hash(), uri.hash());
+  CHECK_EQUAL(copy.isAbsolute(), uri.isAbsolute());
+  CHECK_EQUAL(copy.getSchema(), uri.getSchema());
+  CHECK_EQUAL(copy.getAuthority(), uri.getAuthority());
+  CHECK_EQUAL(copy.getPath(), uri.getPath());
+  CHECK_EQUAL(copy.getQuery(), uri.getQuery());
+  CHECK_EQUAL(copy.getFragment(), uri.getFragment());
+  CHECK(copy == uri);
+}
+
+TEST(round_trips_uris)
+{
+  UriTable& table = UriTable::getInstance();
+
+  std::vector<Uri> uris = {
+    Uri("http://round.example.org/a/b?x=1&y=2#top"),
+    Uri("http://round.example.org"),
+    Uri("ndn:/round/a/b"),
+    Uri("pursuit:ABCD/EF01"),
+    Uri("/round/relative?q"),
+    // Component sizes that take more than one byte in the header
+    Uri("http://round.example.org/" + std::string(300, 'p') + "?" + std::string(200, 'q')),
+    // Too big to share a block
+    Uri("http://round.example.org/" + std::string(10000, 'b')),
+  };
+
+  for(auto& uri : uris) {
+    UriId id = table.intern(uri);
+    CHECK(id != INVALID_URI_ID);
+    checkSame(uri, table.get(id));
+    CHECK_EQUAL(table.getSchema(id), uri.getSchema());
+  }
+}
+
+TEST(keeps_ids_stable)
+{
+  UriTable& table = UriTable::getInstance();
+
+  Uri uri("http://stable.example.org/a/b/c");
+  UriId id = table.intern(uri);
+  CHECK(id != INVALID_URI_ID);
+  CHECK_EQUAL(table.intern(uri), id);
+  CHECK_EQUAL(table.find(uri), id);
+
+  // Same canonical URI, same id
+  CHECK_EQUAL(table.intern(Uri("http://stable.example.org/a/./b//c")), id);
+
+  UriId other = table.intern(Uri("http://stable.example.org/a/b/d"));
+  CHECK(other != INVALID_URI_ID);
+  CHECK(other != id);
+
+  // Ids and URIs stay the same while the table grows
+  size_t size = table.size();
+  for(int i = 0; i < 50000; ++i) {
+    table.intern(Uri("http://stable.example.org/more/" + std::to_string(i)));
+  }
+  CHECK_EQUAL(table.size(), size + 50000);
+  CHECK_EQUAL(table.find(uri), id);
+  CHECK_EQUAL(table.intern(uri), id);
+  checkSame(uri, table.get(id));
+}
+
+TEST(knows_only_interned_uris)
+{
+  UriTable& table = UriTable::getInstance();
+
+  CHECK_EQUAL(table.find(Uri("http://unknown.example.org/")), INVALID_URI_ID);
+  CHECK_EQUAL(table.intern(Uri()), INVALID_URI_ID);
+  CHECK_EQUAL(table.find(Uri()), INVALID_URI_ID);
+
+  CHECK(!table.get(INVALID_URI_ID).isValid());
+  CHECK(!table.get(UINT32_MAX).isValid());
+  CHECK_EQUAL(table.getSchema(UINT32_MAX), "");
+}
+
+TEST(interns_the_same_uris_concurrently)
+{
+  UriTable& table = UriTable::getInstance();
+  const int THREADS = 8;
+  const int URIS = 2000;
+
+  size_t size = table.size();
+
+  std::vector<std::vector<UriId>> ids(THREADS, std::vector<UriId>(URIS));
+  std::vector<std::thread> threads;
+  for(int t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&ids, &table, t]() {
+      // Each thread goes through the URIs from a different starting point
+      for(int n = 0; n < URIS; ++n) {
+        int i = (n + t * URIS / THREADS) % URIS;
+        ids[t][i] = table.intern(Uri("http://concurrent.example.org/" + std::to_string(i)));
+      }
+    });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+
+  CHECK_EQUAL(table.size(), size + URIS);
+  for(int i = 0; i < URIS; ++i) {
+    Uri uri("http://concurrent.example.org/" + std::to_string(i));
+    CHECK(ids[0][i] != INVALID_URI_ID);
+    CHECK_EQUAL(table.find(uri), ids[0][i]);
+    for(int t = 1; t < THREADS; ++t) {
+      CHECK_EQUAL(ids[t][i], ids[0][i]);
+    }
+  }
+}
+
+TEST_MAIN()
@@ -0,0 +1,116 @@
+/** Brief: Tests of the URI parser
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "uri.hpp"
+#include "legacy/uri.hpp"
+
+#include <fstream>
+
+// Links found in real web pages (and in the other networks), one per line
+static std::vector<std::string> readLinks()
+{
+  std::vector<std::string> links;
+  std::ifstream file(DATA_DIR "/links.txt");
+  for(std::string line; std::getline(file, line); ) {
+    links.push_back(line);
+  }
+
+  return links;
+}
+
+static bool same(const Uri& uri, const legacy::Uri& expected)
+{
+  return uri.isValid() == expected.isValid()
+         && uri.isAbsolute() == expected.isAbsolute()
+         && uri.isRelative() == expected.isRelative()
+         && uri.getSchema() == expected.getSchema()
+         && uri.getAuthority() == expected.getAuthority()
+         && uri.getPath() == expected.getPath()
+         && uri.getQuery() == expected.getQuery()
+         && uri.getFragment() == expected.getFragment()
+         && uri.toString() == expected.toString()
+         && uri.toUriEncodedString() == expected.toUriEncodedString();
+}
+
+TEST(parses_links_as_the_regex_parser)
+{
+  std::vector<std::string> links = readLinks();
+  CHECK(links.size() > 100);
+
+  for(auto& link : links) {
+    bool ok = same(Uri(link), legacy::Uri(link));
+    if(!ok) {
+      std::cerr << "  differs: " << link << std::endl;
+    }
+    CHECK(ok);
+  }
+}
+
+TEST(resolves_links_as_the_regex_parser)
+{
+  Uri base("http://www.example.org/dir/sub/page.html?x=1#top");
+  legacy::Uri legacy_base("http://www.example.org/dir/sub/page.html?x=1#top");
+
+  for(auto& link : readLinks()) {
+    bool ok = same(Uri(base, Uri(link)), legacy::Uri(legacy_base, legacy::Uri(link)));
+    if(!ok) {
+      std::cerr << "  differs: " << link << std::endl;
+    }
+    CHECK(ok);
+  }
+}
+
+TEST(splits_components)
+{
+  Uri uri("  http://user@example.org:8080/a/./b/../c//d?q=1%202#frag  ");
+  CHECK(uri.isValid());
+  CHECK(uri.isAbsolute());
+  CHECK_EQUAL(uri.getSchema(), "http");
+  CHECK_EQUAL(uri.getAuthority(), "user@example.org:8080");
+  CHECK_EQUAL(uri.getPath(), "/a/c/d");
+  CHECK_EQUAL(uri.getQuery(), "q=1 2");
+  CHECK_EQUAL(uri.getFragment(), "frag");
+  CHECK_EQUAL(uri.toUriEncodedString(), "http://user@example.org:8080/a/c/d?q%3D1%202#frag");
+}
+
+TEST(parses_relative_references)
+{
+  Uri uri("../img/a.png?v=2");
+  CHECK(uri.isValid());
+  CHECK(uri.isRelative());
+  CHECK_EQUAL(uri.getSchema(), "");
+
+  Uri resolved(Uri("http://example.org/x/y/page.html"), uri);
+  CHECK_EQUAL(resolved.toString(), "http://example.org/x/img/a.png?v=2");
+}
+
+TEST(resolves_leading_parent_segments_against_the_root)
+{
+  Uri uri("http://example.org/../a");
+  CHECK_EQUAL(uri.getPath(), "/a");
+}
+
+TEST(compares_by_canonical_form)
+{
+  CHECK(Uri("http://example.org/a//b") == Uri("http://example.org/a/b"));
+  CHECK(Uri("http://example.org/%7Euser") == Uri("http://example.org/~user"));
+  CHECK(Uri("http://example.org/a") < Uri("http://example.org/b"));
+  CHECK(Uri("http://example.org/a").hash() == Uri("http://example.org//a").hash());
+}
+
+TEST_MAIN()
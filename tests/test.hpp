@@ -0,0 +1,127 @@
+/** Brief: Minimal unit test harness
+ *  Copyright (C) 2016  Carlos Guimaraes <cguimaraes@av.it.pt>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEST__HPP_
+#define TEST__HPP_
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Usage example:
+// '''
+//  #include "test.hpp"
+//
+//  TEST(addition)
+//  {
+//    CHECK(1 + 1 == 2);
+//    CHECK_EQUAL(std::string("a") + "b", "ab");
+//  }
+//
+//  TEST_MAIN()
+// '''
+//
+// Each test file builds into its own program, which runs all of its tests
+// and exits with a non-zero status if any check failed. Failed checks are
+// reported but do not stop the test they are in.
+//
+class TestRegistry
+{
+private:
+  struct Test
+  {
+    std::string name;
+    std::function<void()> run;
+  };
+
+  std::vector<Test> _tests;
+  size_t _failures;
+
+public:
+  static TestRegistry& getInstance()
+  {
+    static TestRegistry instance;
+    return instance;
+  }
+
+  bool add(const std::string& name, std::function<void()> run)
+  {
+    _tests.push_back({name, run});
+    return true;
+  }
+
+  void fail(const char* file, const int line, const std::string& what)
+  {
+    ++_failures;
+    std::cerr << file << ":" << line << ": check failed: " << what << std::endl;
+  }
+
+  int run()
+  {
+    size_t failed = 0;
+    for(auto& test : _tests) {
+      size_t failures = _failures;
+      test.run();
+
+      bool ok = failures == _failures;
+      failed += ok ? 0 : 1;
+      std::cout << (ok ? "[ OK ] " : "[FAIL] ") << test.name << std::endl;
+    }
+
+    std::cout << _tests.size() - failed << "/" << _tests.size() << " tests passed" << std::endl;
+    return failed == 0 ? 0 : 1;
+  }
+
+  TestRegistry(TestRegistry const&) = delete;
+  void operator=(TestRegistry const&) = delete;
+
+private:
+  TestRegistry()
+    : _failures(0)
+  { }
+};
+
+#define TEST(name)                                                           \
+  static void test_##name();                                                 \
+  static bool registered_##name = TestRegistry::getInstance().add(#name, &test_##name); \
+  static void test_##name()
+
+#define CHECK(condition)                                                     \
+  do {                                                                       \
+    if(!(condition)) {                                                       \
+      TestRegistry::getInstance().fail(__FILE__, __LINE__, #condition);      \
+    }                                                                        \
+  } while(0)
+
+#define CHECK_EQUAL(actual, expected)                                        \
+  do {                                                                       \
+    auto _actual = (actual);                                                 \
+    auto _expected = (expected);                                             \
+    if(!(_actual == _expected)) {                                            \
+      TestRegistry::getInstance().fail(__FILE__, __LINE__,                   \
+                                       #actual " == " #expected);            \
+    }                                                                        \
+  } while(0)
+
+#define TEST_MAIN()                                                          \
+  int main()                                                                 \
+  {                                                                          \
+    return TestRegistry::getInstance().run();                                \
+  }
+
+#endif /* TEST__HPP_ */